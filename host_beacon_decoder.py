@@ -0,0 +1,76 @@
+# host_beacon_decoder.py
+# Requires: pip install bleak
+# Passive BLE scan that decodes the ESP32-BLE-Mobile status beacon from the
+# advertising manufacturer data, without connecting to the board.
+#
+# Payload (after the 0xFFFF company ID): type 0xB1, flags, rolling counter
+#   flags bit0 locked, bit1 engine, bit2 warm-up active, bit3 alarm, bit4 RTC ok
+
+import asyncio
+
+from bleak import BleakScanner
+
+COMPANY_ID = 0xFFFF
+BEACON_TYPE = 0xB1
+FLAG_NAMES = [
+    (0x01, "LOCKED"),
+    (0x02, "ENGINE"),
+    (0x04, "WARM"),
+    (0x08, "ALARM"),
+    (0x10, "RTC_OK"),
+]
+
+
+def decode(payload):
+    """Decode manufacturer data bytes (company ID already stripped).
+    Returns dict or None if it is not our beacon."""
+    if len(payload) < 3 or payload[0] != BEACON_TYPE:
+        return None
+    flags = payload[1]
+    return {
+        "flags": flags,
+        "counter": payload[2],
+        "locked": bool(flags & 0x01),
+        "engine": bool(flags & 0x02),
+        "warm": bool(flags & 0x04),
+        "alarm": bool(flags & 0x08),
+        "rtc_ok": bool(flags & 0x10),
+    }
+
+
+def describe(state):
+    names = [name for bit, name in FLAG_NAMES if state["flags"] & bit]
+    return f"#{state['counter']:3d} " + (" ".join(names) if names else "-")
+
+
+async def main():
+    # Last counter per device, so only state changes are printed
+    last = {}
+
+    def on_adv(device, adv):
+        data = adv.manufacturer_data.get(COMPANY_ID)
+        if data is None:
+            return
+        state = decode(data)
+        if state is None:
+            return
+        if last.get(device.address) == state["counter"]:
+            return
+        last[device.address] = state["counter"]
+        print(f"[{device.address}] rssi={adv.rssi} {describe(state)}")
+
+    scanner = BleakScanner(on_adv)
+    await scanner.start()
+    print("Scanning for ESP32 status beacons (Ctrl+C to stop)")
+    try:
+        while True:
+            await asyncio.sleep(1.0)
+    finally:
+        await scanner.stop()
+
+
+if __name__ == "__main__":
+    try:
+        asyncio.run(main())
+    except KeyboardInterrupt:
+        pass
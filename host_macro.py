@@ -0,0 +1,170 @@
+# host_macro.py
+# Compile, verify and disassemble firmware command macros (MacroVM bytecode).
+# Commands are stored by name id, so the table only has to list the names the
+# board knows: save the output of the serial command `macro table` to a file, then:
+#   python host_macro.py compile table.txt "lamp_on; wait 2000; lock; alarm_on"
+#       -> prints the "macro load <n> <hex>" lines; send them with the slot number filled in
+#          (long macros are split into chunks ending in '+', the last one without)
+#   python host_macro.py verify table.txt <hex>
+#   python host_macro.py disasm table.txt <hex>
+# No extra packages needed.
+
+import sys
+
+VERSION = 2
+OP_NONE = 0
+MAX_BYTES = 128
+HEADER = 2
+OP_HEADER = 5
+CHUNK_HEX = 100
+
+
+class MacroError(Exception):
+    pass
+
+
+def load_table(path):
+    names = []
+    with open(path) as f:
+        for line in f:
+            parts = line.split()
+            if len(parts) in (2, 3) and parts[0].isdigit():
+                names.append(parts[1])
+    if not names:
+        raise MacroError(f"no commands in {path} (expected `macro table` output)")
+    return names
+
+
+def name_id(name):
+    # Same as CommandEngine::nameId(): FNV-1a over the lowercase name, folded to 16 bit, never 0
+    h = 2166136261
+    for ch in name.lower().encode():
+        h = ((h ^ ch) * 16777619) & 0xFFFFFFFF
+    return ((h ^ (h >> 16)) & 0xFFFF) or 1
+
+
+def resolve(names, cid):
+    # Same as MacroVM::resolve(): id -> name in this table
+    found = [n for n in names if name_id(n) == cid]
+    if not found:
+        raise MacroError(f"command {cid:04x} not in this firmware")
+    if len(found) > 1:
+        raise MacroError("command id not unique")
+    if found[0].lower() == "macro":
+        raise MacroError("macro cannot call macro")
+    return found[0]
+
+
+def compile_macro(names, text):
+    known = {n.lower() for n in names}
+    out = bytearray([ord("M"), VERSION])
+    last = None
+    for op in text.replace("\n", ";").split(";"):
+        op = op.strip()
+        if not op:
+            continue
+        word, _, arg = op.partition(" ")
+        arg = arg.strip()
+        if word.lower() == "wait":
+            ms = int(arg or 0)
+            if not 1 <= ms <= 65535:
+                raise MacroError("wait must be 1-65535 ms")
+            if last is not None:
+                d = out[last + 3] | (out[last + 4] << 8)
+                if d + ms <= 65535:
+                    d += ms
+                    out[last + 3], out[last + 4] = d & 0xFF, d >> 8
+                    continue
+            last = len(out)
+            out += bytes([OP_NONE & 0xFF, OP_NONE >> 8, 0, ms & 0xFF, ms >> 8])
+            continue
+        if word.lower() not in known:
+            raise MacroError(f"unknown command {word}")
+        cid = name_id(word)
+        resolve(names, cid)
+        a = arg.encode()
+        last = len(out)
+        out += bytes([cid & 0xFF, cid >> 8, len(a), 0, 0]) + a
+        if len(out) > MAX_BYTES:
+            raise MacroError("macro too long")
+    if len(out) == HEADER:
+        raise MacroError("empty macro")
+    verify(names, out)
+    return bytes(out)
+
+
+def verify(names, code):
+    # Same checks as MacroVM::verify()
+    if not HEADER + OP_HEADER <= len(code) <= MAX_BYTES:
+        raise MacroError("bad length")
+    if code[0] != ord("M"):
+        raise MacroError("bad magic")
+    if code[1] != VERSION:
+        raise MacroError("unsupported version, save the macro again")
+    at = HEADER
+    ops = 0
+    while at < len(code):
+        if at + OP_HEADER > len(code):
+            raise MacroError("truncated op")
+        cid, arg_len = code[at] | (code[at + 1] << 8), code[at + 2]
+        if cid == OP_NONE:
+            if arg_len:
+                raise MacroError("delay op with argument")
+        else:
+            resolve(names, cid)
+        at += OP_HEADER
+        if at + arg_len > len(code):
+            raise MacroError("truncated argument")
+        if any(b < 0x20 or b > 0x7E for b in code[at:at + arg_len]):
+            raise MacroError("argument not printable")
+        at += arg_len
+        ops += 1
+    return ops
+
+
+def ops(names, code):
+    at = HEADER
+    while at < len(code):
+        cid, arg_len = code[at] | (code[at + 1] << 8), code[at + 2]
+        delay = code[at + 3] | (code[at + 4] << 8)
+        arg = code[at + OP_HEADER:at + OP_HEADER + arg_len].decode()
+        yield (None if cid == OP_NONE else resolve(names, cid)), arg, delay
+        at += OP_HEADER + arg_len
+
+
+def disasm(names, code):
+    for name, arg, delay in ops(names, code):
+        if name is None:
+            print(f"  wait {delay}")
+        else:
+            print(f"  {name} {arg}".rstrip() + (f"; wait {delay}" if delay else ""))
+
+
+def main():
+    if len(sys.argv) < 4:
+        print("usage: host_macro.py compile|verify|disasm <table.txt> <text|hex>")
+        sys.exit(1)
+    mode, table, payload = sys.argv[1], sys.argv[2], sys.argv[3]
+    names = load_table(table)
+    try:
+        if mode == "compile":
+            code = compile_macro(names, payload)
+            disasm(names, code)
+            # fits the firmware's 128 byte command line
+            h = code.hex()
+            chunks = [h[i:i + CHUNK_HEX] for i in range(0, len(h), CHUNK_HEX)]
+            for i, c in enumerate(chunks):
+                print(f"macro load <n> {c}{'+' if i < len(chunks) - 1 else ''}")
+        elif mode == "verify":
+            print(f"ok, {verify(names, bytes.fromhex(payload))} ops")
+        elif mode == "disasm":
+            disasm(names, bytes.fromhex(payload))
+        else:
+            raise MacroError(f"unknown mode {mode}")
+    except (MacroError, ValueError) as e:
+        print(f"error: {e}")
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -1,6 +1,7 @@
 # host_time_responder.py
 # Requires: pip install pyserial
-# Listens for GETTIME on any serial USB port and replies with HOSTTIME YYYY-MM-DD HH:MM:SS
+# Listens for GETTIME on any serial USB port and replies with HOSTTIME YYYY-MM-DD HH:MM:SS.mmm
+# (the milliseconds let the firmware measure RTC drift, see `drift`)
 
 import serial
 import serial.tools.list_ports
@@ -9,6 +10,8 @@ from datetime import datetime
 
 BAUD = 115200
 SCAN_INTERVAL = 2.0
+# Sync again while the board stays connected, so the firmware gets drift samples (>= 6 h apart)
+RESYNC_INTERVAL = 6 * 3600 + 60
 
 
 def handle_port(port):
@@ -19,6 +22,7 @@ def handle_port(port):
         return
     try:
         synced = False
+        synced_at = 0.0
         while True:
             try:
                 line = s.readline().decode(errors='ignore').strip()
@@ -29,13 +33,16 @@ def handle_port(port):
                 continue
             print(f"[{port.device}] RX: {line}")
             # Reply when device explicitly asks for time, or when it prints RTC output
+            if synced and time.monotonic() - synced_at > RESYNC_INTERVAL:
+                synced = False
             if not synced and (line == "GETTIME" or line.startswith("RTC:")):
-                now = datetime.now().strftime('%Y-%m-%d %H:%M:%S')
+                now = datetime.now().strftime('%Y-%m-%d %H:%M:%S.%f')[:-3]
                 reply = f"HOSTTIME {now}\n"
                 try:
                     s.write(reply.encode())
                     print(f"[{port.device}] TX: {reply.strip()}")
                     synced = True
+                    synced_at = time.monotonic()
                 except Exception as e:
                     print(f"Write failed: {e}")
                     break
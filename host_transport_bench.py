@@ -0,0 +1,90 @@
+# host_transport_bench.py
+# Round-trip benchmark of the firmware command engine over any transport.
+# Sends "ping" and waits for "PONG", the same way for every link:
+#   python host_transport_bench.py serial COM5            (USB serial)
+#   python host_transport_bench.py serial /dev/rfcomm0    (Bluetooth SPP)
+#   python host_transport_bench.py ble ESP32-BLE-Mobile   (BLE, name or MAC)
+# Optional third argument: number of round trips (default 100).
+# Requires: pip install pyserial bleak
+
+import asyncio
+import statistics
+import sys
+import time
+
+BAUD = 115200
+CHAR_UUID = "abcdefab-1234-5678-1234-abcdefabcdef"
+TIMEOUT = 2.0
+
+
+def report(name, samples, lost):
+    if not samples:
+        print(f"{name}: no replies ({lost} lost)")
+        return
+    samples.sort()
+    p95 = samples[int(len(samples) * 0.95) - 1] if len(samples) >= 20 else samples[-1]
+    print(f"{name}: n={len(samples)} lost={lost} "
+          f"min={samples[0]:.1f}ms avg={statistics.mean(samples):.1f}ms "
+          f"p95={p95:.1f}ms max={samples[-1]:.1f}ms")
+
+
+def bench_serial(port, count):
+    import serial
+    s = serial.Serial(port, BAUD, timeout=TIMEOUT)
+    time.sleep(0.5)
+    s.reset_input_buffer()
+    samples, lost = [], 0
+    for _ in range(count):
+        t0 = time.perf_counter()
+        s.write(b"ping\n")
+        # skip log lines until the reply (or timeout)
+        while True:
+            line = s.readline().decode(errors="ignore").strip()
+            if line == "PONG":
+                samples.append((time.perf_counter() - t0) * 1000.0)
+                break
+            if not line:
+                lost += 1
+                break
+    s.close()
+    report(f"serial {port}", samples, lost)
+
+
+async def bench_ble(target, count):
+    from bleak import BleakClient, BleakScanner
+    dev = await BleakScanner.find_device_by_filter(
+        lambda d, a: d.name == target or d.address.lower() == target.lower(), timeout=10.0)
+    if dev is None:
+        print(f"BLE device {target} not found")
+        return
+    replies = asyncio.Queue()
+    samples, lost = [], 0
+    async with BleakClient(dev) as client:
+        await client.start_notify(CHAR_UUID, lambda _, data: replies.put_nowait(bytes(data)))
+        for _ in range(count):
+            t0 = time.perf_counter()
+            await client.write_gatt_char(CHAR_UUID, b"ping", response=False)
+            try:
+                while True:
+                    data = await asyncio.wait_for(replies.get(), TIMEOUT)
+                    if data == b"PONG":
+                        samples.append((time.perf_counter() - t0) * 1000.0)
+                        break
+            except asyncio.TimeoutError:
+                lost += 1
+    report(f"ble {target}", samples, lost)
+
+
+def main():
+    if len(sys.argv) < 3 or sys.argv[1] not in ("serial", "ble"):
+        print("usage: host_transport_bench.py serial|ble <port|name> [count]")
+        sys.exit(1)
+    count = int(sys.argv[3]) if len(sys.argv) > 3 else 100
+    if sys.argv[1] == "serial":
+        bench_serial(sys.argv[2], count)
+    else:
+        asyncio.run(bench_ble(sys.argv[2], count))
+
+
+if __name__ == "__main__":
+    main()
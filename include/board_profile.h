@@ -0,0 +1,109 @@
+// board_profile.h
+// Board profile type: every GPIO the firmware uses, with its role and active
+// level. Masks, init tables and conflict checks are derived from a profile at
+// compile time (see pin_config.h for the profiles themselves).
+#ifndef BOARD_PROFILE_H
+#define BOARD_PROFILE_H
+
+#include <stdint.h>
+
+// Every output pin of the board, owned by OutputArbiter
+enum Output : uint8_t {
+  OUT_ACC, OUT_IG, OUT_STARTER, OUT_LAMP, OUT_ALARM,
+  OUT_LOCK, OUT_UNLOCK, OUT_HAZARD, OUT_PESAWAT,
+  OUT_LED_CONN, OUT_LED_POWER,
+  OUT_COUNT
+};
+
+// Every input pin of the board
+enum Input : uint8_t {
+  IN_REMOTE_A, IN_REMOTE_B, IN_REMOTE_C, IN_REMOTE_D,
+  IN_BUTTON,
+  IN_RTC_INT,   // DS3231 INT/SQW (alarm 1), open drain, wake source
+  IN_COUNT
+};
+
+enum class PinRole : uint8_t { Output, Input, InputPullup, I2C };
+
+struct BoardPin {
+  uint8_t gpio;
+  PinRole role;
+  bool activeHigh;
+  const char* name;
+};
+
+struct BoardProfile {
+  const char* name;
+  BoardPin out[OUT_COUNT];   // indexed by Output
+  BoardPin in[IN_COUNT];     // indexed by Input
+  BoardPin sda, scl;
+};
+
+/* ===== Compile-time derivations / checks ===== */
+
+// Bit of a GPIO inside its bank register (GPIO0-31 / GPIO32-39)
+constexpr uint32_t gpioBit(uint8_t gpio) { return 1UL << (gpio & 31); }
+constexpr uint8_t gpioBank(uint8_t gpio) { return gpio >= 32 ? 1 : 0; }
+
+// Output bits of one bank whose idle (inactive) level is HIGH or LOW
+constexpr uint32_t boardIdleMask(const BoardProfile& b, uint8_t bank, bool idleHigh) {
+  uint32_t m = 0;
+  for (uint8_t i = 0; i < OUT_COUNT; i++) {
+    if (gpioBank(b.out[i].gpio) == bank && b.out[i].activeHigh != idleHigh) m |= gpioBit(b.out[i].gpio);
+  }
+  return m;
+}
+
+constexpr uint32_t boardOutputMask(const BoardProfile& b, uint8_t bank) {
+  return boardIdleMask(b, bank, false) | boardIdleMask(b, bank, true);
+}
+
+// No GPIO may be assigned twice
+constexpr bool boardPinsUnique(const BoardProfile& b) {
+  uint8_t pins[OUT_COUNT + IN_COUNT + 2] = {};
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < OUT_COUNT; i++) pins[n++] = b.out[i].gpio;
+  for (uint8_t i = 0; i < IN_COUNT; i++) pins[n++] = b.in[i].gpio;
+  pins[n++] = b.sda.gpio;
+  pins[n++] = b.scl.gpio;
+  for (uint8_t i = 0; i < n; i++) {
+    for (uint8_t j = i + 1; j < n; j++) {
+      if (pins[i] == pins[j]) return false;
+    }
+  }
+  return true;
+}
+
+// ESP32: GPIO6-11 are the SPI flash, GPIO34-39 are input-only without pull-ups
+constexpr bool gpioUsable(uint8_t gpio) { return gpio < 40 && (gpio < 6 || gpio > 11); }
+constexpr bool gpioInputOnly(uint8_t gpio) { return gpio >= 34; }
+// RTC IO: readable by the ULP and usable as ext0/ext1 wake in deep sleep
+constexpr bool gpioRtcCapable(uint8_t gpio) {
+  return gpio == 0 || gpio == 2 || gpio == 4 || (gpio >= 12 && gpio <= 15) || (gpio >= 25 && gpio <= 27) ||
+         (gpio >= 32 && gpio <= 39);
+}
+
+// Parking (deep sleep) watches the remote inputs and the RTC alarm line
+constexpr bool boardParkInputsValid(const BoardProfile& b) {
+  for (uint8_t i = IN_REMOTE_A; i <= IN_REMOTE_D; i++) {
+    if (!gpioRtcCapable(b.in[i].gpio)) return false;
+  }
+  return gpioRtcCapable(b.in[IN_RTC_INT].gpio);
+}
+
+constexpr bool boardRolesValid(const BoardProfile& b) {
+  for (uint8_t i = 0; i < OUT_COUNT; i++) {
+    const BoardPin& p = b.out[i];
+    if (p.role != PinRole::Output || !gpioUsable(p.gpio) || gpioInputOnly(p.gpio)) return false;
+  }
+  for (uint8_t i = 0; i < IN_COUNT; i++) {
+    const BoardPin& p = b.in[i];
+    if (!gpioUsable(p.gpio)) return false;
+    if (p.role == PinRole::InputPullup && gpioInputOnly(p.gpio)) return false;
+    if (p.role != PinRole::Input && p.role != PinRole::InputPullup) return false;
+  }
+  return b.sda.role == PinRole::I2C && b.scl.role == PinRole::I2C &&
+         !gpioInputOnly(b.sda.gpio) && !gpioInputOnly(b.scl.gpio);
+}
+
+#endif // BOARD_PROFILE_H
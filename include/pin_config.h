@@ -1,32 +1,112 @@
 // pin_config.h
-// Centralized pin definitions taken from README_BLE.md
+// Centralized pin definitions taken from README_BLE.md, as board profiles.
+// Pick a profile per platformio.ini environment with -DBOARD_PROFILE_<NAME>;
+// the default is the DOIT devkit wiring.
 #ifndef PIN_CONFIG_H
 #define PIN_CONFIG_H
 
-// Standard/engine LEDs and controls
-#define PIN_ACC       25
-#define PIN_IG        26
-#define PIN_STARTER   27
-
-// Central lock, connect LED, hazard, pesawat
-#define LED_PIN       2
-#define PIN_LOCK      4
-#define PIN_UNLOCK    16
-#define PIN_HAZZARD   17
-#define PIN_PESAWAT   23
-
-// Lamp / Alarm pins
-#define PIN_LAMP      32
-// Alarm output pin (used for ALARM_ON / ALARM_OFF). Default set to 33, change if needed.
-#define PIN_ALARM     33
-
-// Indicator LED for physical button/power (avoid using SCL/GPIO21/22)
-#define PIN_LED_POWER 13
-
-// Remote control inputs (433MHz RX580)
-#define LEDIN_A       34
-#define LEDIN_B       35
-#define LEDIN_C       36
-#define LEDIN_D       39
+#include "board_profile.h"
+
+#define OUT_PIN(gpio, activeHigh, name) { gpio, PinRole::Output, activeHigh, name }
+
+// DOIT ESP32 devkit v1, all outputs active HIGH
+inline constexpr BoardProfile DEVKIT_V1_PROFILE = {
+  "devkit-v1",
+  {
+    // Standard/engine LEDs and controls
+    OUT_PIN(25, true, "acc"),
+    OUT_PIN(26, true, "ig"),
+    OUT_PIN(27, true, "starter"),
+    // Lamp / Alarm (GPIO32-39 bank)
+    OUT_PIN(32, true, "lamp"),
+    OUT_PIN(33, true, "alarm"),
+    // Central lock, hazard, pesawat
+    OUT_PIN(4,  true, "lock"),
+    OUT_PIN(16, true, "unlock"),
+    OUT_PIN(17, true, "hazard"),
+    OUT_PIN(23, true, "pesawat"),
+    // Connect LED (BLE central connected) and button/power indicator
+    // (avoid SCL/GPIO21/22 for the indicator)
+    OUT_PIN(2,  true, "led_conn"),
+    OUT_PIN(13, true, "led_power"),
+  },
+  {
+    // Remote control inputs (433MHz RX580), input-only pins
+    { 34, PinRole::Input, true, "remote_a" },
+    { 35, PinRole::Input, true, "remote_b" },
+    { 36, PinRole::Input, true, "remote_c" },
+    { 39, PinRole::Input, true, "remote_d" },
+    // Physical start button to GND
+    { 18, PinRole::InputPullup, false, "button" },
+    // DS3231 INT/SQW, open drain to GND; RTC GPIO so it can also wake deep sleep
+    { 14, PinRole::InputPullup, false, "rtc_int" },
+  },
+  // DS3231 RTC
+  { 21, PinRole::I2C, true, "sda" },
+  { 22, PinRole::I2C, true, "scl" },
+};
+
+// Same wiring driving an active-LOW relay module on the engine/lamp/alarm outputs
+inline constexpr BoardProfile RELAY_LOW_PROFILE = {
+  "devkit-v1-relay-low",
+  {
+    OUT_PIN(25, false, "acc"),
+    OUT_PIN(26, false, "ig"),
+    OUT_PIN(27, false, "starter"),
+    OUT_PIN(32, false, "lamp"),
+    OUT_PIN(33, false, "alarm"),
+    OUT_PIN(4,  true, "lock"),
+    OUT_PIN(16, true, "unlock"),
+    OUT_PIN(17, true, "hazard"),
+    OUT_PIN(23, true, "pesawat"),
+    OUT_PIN(2,  true, "led_conn"),
+    OUT_PIN(13, true, "led_power"),
+  },
+  {
+    DEVKIT_V1_PROFILE.in[IN_REMOTE_A], DEVKIT_V1_PROFILE.in[IN_REMOTE_B],
+    DEVKIT_V1_PROFILE.in[IN_REMOTE_C], DEVKIT_V1_PROFILE.in[IN_REMOTE_D],
+    DEVKIT_V1_PROFILE.in[IN_BUTTON], DEVKIT_V1_PROFILE.in[IN_RTC_INT],
+  },
+  DEVKIT_V1_PROFILE.sda,
+  DEVKIT_V1_PROFILE.scl,
+};
+
+#undef OUT_PIN
+
+#if defined(BOARD_PROFILE_RELAY_LOW)
+inline constexpr const BoardProfile& BOARD = RELAY_LOW_PROFILE;
+#else
+inline constexpr const BoardProfile& BOARD = DEVKIT_V1_PROFILE;
+#endif
+
+static_assert(boardPinsUnique(BOARD), "board profile: a GPIO is assigned twice");
+static_assert(boardRolesValid(BOARD), "board profile: pin role not possible on that GPIO (flash pin, input-only, no pull-up)");
+static_assert(boardParkInputsValid(BOARD), "board profile: remote inputs and rtc_int must be RTC GPIOs (deep-sleep wake)");
+
+// Register masks for the output layer (OutputArbiter / boardInitPins)
+inline constexpr uint32_t BOARD_OUT_MASK_LO = boardOutputMask(BOARD, 0);
+inline constexpr uint32_t BOARD_OUT_MASK_HI = boardOutputMask(BOARD, 1);
+static_assert(BOARD_OUT_MASK_HI <= 0xFF, "board profile: out1 register covers GPIO32-39 only");
+
+// Named pins used throughout the firmware
+inline constexpr uint8_t PIN_ACC       = BOARD.out[OUT_ACC].gpio;
+inline constexpr uint8_t PIN_IG        = BOARD.out[OUT_IG].gpio;
+inline constexpr uint8_t PIN_STARTER   = BOARD.out[OUT_STARTER].gpio;
+inline constexpr uint8_t PIN_LAMP      = BOARD.out[OUT_LAMP].gpio;
+inline constexpr uint8_t PIN_ALARM     = BOARD.out[OUT_ALARM].gpio;
+inline constexpr uint8_t PIN_LOCK      = BOARD.out[OUT_LOCK].gpio;
+inline constexpr uint8_t PIN_UNLOCK    = BOARD.out[OUT_UNLOCK].gpio;
+inline constexpr uint8_t PIN_HAZZARD   = BOARD.out[OUT_HAZARD].gpio;
+inline constexpr uint8_t PIN_PESAWAT   = BOARD.out[OUT_PESAWAT].gpio;
+inline constexpr uint8_t LED_PIN       = BOARD.out[OUT_LED_CONN].gpio;
+inline constexpr uint8_t PIN_LED_POWER = BOARD.out[OUT_LED_POWER].gpio;
+inline constexpr uint8_t LEDIN_A       = BOARD.in[IN_REMOTE_A].gpio;
+inline constexpr uint8_t LEDIN_B       = BOARD.in[IN_REMOTE_B].gpio;
+inline constexpr uint8_t LEDIN_C       = BOARD.in[IN_REMOTE_C].gpio;
+inline constexpr uint8_t LEDIN_D       = BOARD.in[IN_REMOTE_D].gpio;
+inline constexpr uint8_t PIN_BUTTON    = BOARD.in[IN_BUTTON].gpio;
+inline constexpr uint8_t PIN_RTC_INT   = BOARD.in[IN_RTC_INT].gpio;
+inline constexpr uint8_t PIN_SDA       = BOARD.sda.gpio;
+inline constexpr uint8_t PIN_SCL       = BOARD.scl.gpio;
 
 #endif // PIN_CONFIG_H
@@ -0,0 +1,52 @@
+#include "AdvPayload.h"
+#include <stdlib.h>
+#include <string.h>
+
+void AdvPayload::begin(const char* deviceName, const char* serviceUuid) {
+  strncpy(name, deviceName, sizeof(name) - 1);
+  name[sizeof(name) - 1] = '\0';
+  // 128-bit service UUID as it goes over the air (little endian)
+  const char* u = serviceUuid;
+  for (int i = 15; i >= 0; i--) {
+    while (*u == '-') u++;
+    char hex[3] = {u[0], u[1], 0};
+    uuidLE[i] = (uint8_t)strtoul(hex, nullptr, 16);
+    u += 2;
+  }
+  build();
+}
+
+bool AdvPayload::setBeacon(uint8_t f) {
+  if (f == flags) return false;
+  flags = f;
+  counter++;
+  changes++;
+  build();
+  return true;
+}
+
+void AdvPayload::build() {
+  size_t n = 0;
+  advData[n++] = 2;    advData[n++] = 0x01; advData[n++] = 0x06; // LE general discoverable, no BR/EDR
+  advData[n++] = 17;   advData[n++] = 0x07;                      // complete list of 128-bit UUIDs
+  memcpy(advData + n, uuidLE, 16); n += 16;
+  advData[n++] = 6;    advData[n++] = 0xFF;                      // manufacturer specific data
+  advData[n++] = COMPANY_ID & 0xFF;
+  advData[n++] = COMPANY_ID >> 8;
+  advData[n++] = BEACON_TYPE;
+  advData[n++] = flags;
+  advData[n++] = counter;
+  advLen = n;
+
+  n = 0;
+  size_t nameLen = strlen(name);
+  scanData[n++] = nameLen + 1; scanData[n++] = 0x09;            // complete local name
+  memcpy(scanData + n, name, nameLen); n += nameLen;
+  // PENTING UNTUK ANDROID / MIT APP INVENTOR: preferred connection interval
+  // 0x12..0x40 (x1.25 ms), same hint the default advertising data carried
+  scanData[n++] = 5;   scanData[n++] = 0x12;
+  scanData[n++] = 0x12; scanData[n++] = 0x00;
+  scanData[n++] = 0x40; scanData[n++] = 0x00;
+  scanLen = n;
+  buildCount++;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Status bits broadcast in the advertising manufacturer data (see BLEModule::setBeaconState)
+enum BeaconFlag : uint8_t {
+  BEACON_LOCKED = 0x01,
+  BEACON_ENGINE = 0x02,
+  BEACON_WARM   = 0x04,
+  BEACON_ALARM  = 0x08,
+  BEACON_RTC_OK = 0x10
+};
+
+// Raw advertising and scan response payloads, built in place. The status
+// beacon has to sit in the advertising PDU itself so a passive scan (no scan
+// request) sees it: flags (3) + 128-bit service UUID (18) + manufacturer
+// data (7) = 28 of 31 bytes. Name and the preferred connection interval hint
+// go into the scan response.
+// No stack calls here (host tests): BLEModule pushes the buffers to the
+// backend whenever setBeacon() reports a rebuild.
+class AdvPayload {
+public:
+  // Manufacturer data header: 0xFFFF is the Bluetooth SIG "no company / testing"
+  // ID, 0xB1 marks the payload format version so the app can ignore others.
+  static const uint16_t COMPANY_ID = 0xFFFF;
+  static const uint8_t BEACON_TYPE = 0xB1;
+  static const size_t MAX_LEN = 31;
+
+  // Device name and service UUID ("12345678-1234-..."); builds both payloads
+  void begin(const char* name, const char* serviceUuid);
+  // Beacon flags (BeaconFlag bits). Only a change bumps the rolling counter
+  // and rebuilds the payload; returns true when the stack has to get it again.
+  bool setBeacon(uint8_t flags);
+
+  const uint8_t* adv() const { return advData; }
+  size_t advLength() const { return advLen; }
+  const uint8_t* scan() const { return scanData; }
+  size_t scanLength() const { return scanLen; }
+  uint8_t beaconFlags() const { return flags; }
+  uint8_t beaconCounter() const { return counter; }
+  // Flag changes, and payload builds including the first one
+  uint32_t updates() const { return changes; }
+  uint32_t builds() const { return buildCount; }
+
+private:
+  char name[24] = "";
+  uint8_t uuidLE[16] = {};
+  uint8_t advData[MAX_LEN] = {};
+  size_t advLen = 0;
+  uint8_t scanData[MAX_LEN] = {};
+  size_t scanLen = 0;
+  uint8_t flags = 0;
+  uint8_t counter = 0;
+  uint32_t changes = 0;
+  uint32_t buildCount = 0;
+
+  void build();
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <Arduino.h>
+#include <string>
+
+// GATT layout shared by every backend (full 128-bit UUIDs for App Inventor)
+#define BLE_SERVICE_UUID "12345678-1234-1234-1234-123456789abc"
+#define BLE_CHAR_UUID    "abcdefab-1234-5678-1234-abcdefabcdef"
+
+// Bluetooth SIG Current Time Service on the phone (read as GATT client)
+#define CTS_SERVICE_UUID16      0x1805
+#define CTS_CURRENT_TIME_UUID16 0x2A2B
+
+// Stack-specific part of BLEModule: GATT server, advertising, bonding.
+// Exactly one implementation is compiled in, chosen by the build environment:
+// Bluedroid (default) or NimBLE when BLE_BACKEND_NIMBLE is defined.
+class BLEBackend {
+public:
+  // Events delivered from the BT host task
+  class Listener {
+  public:
+    virtual ~Listener() {}
+    virtual void onBackendConnect(bool bonded) = 0;
+    virtual void onBackendDisconnect() = 0;
+    // data points into the stack's attribute buffer, valid during the call
+    virtual void onBackendWrite(const char* data, size_t len) = 0;
+  };
+
+  // One read of the phone's Current Time characteristic
+  struct TimeSample {
+    uint8_t value[10];       // Exact Time 256 + adjust reason, as received
+    uint8_t len;
+    unsigned long sentMs;    // millis() when the read request went out
+    unsigned long rxMs;      // millis() when the response came back
+  };
+
+  virtual ~BLEBackend() {}
+  virtual const char* name() const = 0;
+  virtual void begin(const char* deviceName, Listener* listener) = 0;
+  // Replace the raw advertising PDU payload and scan response (AD structures,
+  // max 31 bytes each). Data is copied by the stack; no restart needed.
+  virtual void setAdvData(const uint8_t* adv, size_t advLen, const uint8_t* scanRsp, size_t scanLen) = 0;
+  // intervalUnits in 0.625 ms. With bondedOnly, only bonded phones may
+  // connect; returns true if that whitelist filter is actually active.
+  virtual bool startAdvertising(uint16_t intervalUnits, bool bondedOnly) = 0;
+  virtual void stopAdvertising() = 0;
+  virtual void notify(const uint8_t* data, size_t len) = 0;
+  virtual bool connected() = 0;
+  virtual int bondCount() = 0;
+  virtual void clearBonds() = 0;
+  virtual std::string address() = 0;
+  // Link to the connected phone is encrypted (iOS only serves CTS then)
+  virtual bool encrypted() = 0;
+  // GATT client on the current connection: find the phone's Current Time
+  // Service and read Current Time count times, spacingMs apart. Blocking
+  // (discovery + reads): call from a task, never from the BT callbacks.
+  // Returns the samples read, 0 if the phone has no CTS or disconnected.
+  virtual uint8_t readPeerTime(TimeSample* out, uint8_t count, uint16_t spacingMs) = 0;
+
+  // The backend selected at build time
+  static BLEBackend& instance();
+};
@@ -0,0 +1,202 @@
+#include "BLEBackendBluedroid.h"
+
+#ifndef BLE_BACKEND_NIMBLE
+
+#include <BLE2902.h>
+
+// Matches the default CONFIG_BT_SMP_MAX_BONDS of the Arduino ESP32 core
+static const int MAX_BONDS = 15;
+static esp_ble_bond_dev_t bondList[MAX_BONDS];
+
+BLEBackend& BLEBackend::instance() {
+  static BLEBackendBluedroid backend;
+  return backend;
+}
+
+void BLEBackendBluedroid::begin(const char* deviceName, Listener* l) {
+  listener = l;
+
+  BLEDevice::init(deviceName);
+
+  // ===== Security / bonding =====
+  // Just Works pairing with bonding: keys are persisted in NVS by Bluedroid,
+  // so a returning phone re-encrypts with the stored LTK instead of pairing again.
+  BLEDevice::setEncryptionLevel(ESP_BLE_SEC_ENCRYPT_NO_MITM);
+  BLEDevice::setSecurityCallbacks(new SecurityCallbacks(this));
+  BLESecurity* pSecurity = new BLESecurity();
+  pSecurity->setAuthenticationMode(ESP_LE_AUTH_REQ_SC_BOND);
+  pSecurity->setCapability(ESP_IO_CAP_NONE);
+  pSecurity->setInitEncryptionKey(ESP_BLE_ENC_KEY_MASK | ESP_BLE_ID_KEY_MASK);
+  pSecurity->setRespEncryptionKey(ESP_BLE_ENC_KEY_MASK | ESP_BLE_ID_KEY_MASK);
+
+  pServer = BLEDevice::createServer();
+  pServer->setCallbacks(new ServerCallbacks(this));
+
+  // The attribute table below is created in a fixed order so its handles stay
+  // identical across boots; bonded phones can keep their cached GATT database.
+  BLEService* pService = pServer->createService(BLEUUID(BLE_SERVICE_UUID));
+
+  pCharacteristic = pService->createCharacteristic(
+    BLEUUID(BLE_CHAR_UUID),
+    BLECharacteristic::PROPERTY_READ |
+    BLECharacteristic::PROPERTY_WRITE |
+    BLECharacteristic::PROPERTY_WRITE_NR |
+    BLECharacteristic::PROPERTY_NOTIFY
+  );
+
+  pCharacteristic->addDescriptor(new BLE2902());
+  pCharacteristic->setCallbacks(new CharCallbacks(this));
+  pCharacteristic->setValue("READY");
+
+  pService->start();
+
+  pAdvertising = BLEDevice::getAdvertising();
+}
+
+void BLEBackendBluedroid::setAdvData(const uint8_t* adv, size_t advLen, const uint8_t* scanRsp, size_t scanLen) {
+  if (!pAdvertising) return;
+  if (!customAdvSet) {
+    // First time through the library wrapper: marks the data as custom so
+    // BLEAdvertising::start() no longer builds its own payload.
+    BLEAdvertisementData advData;
+    advData.addData(std::string((const char*)adv, advLen));
+    pAdvertising->setAdvertisementData(advData);
+    BLEAdvertisementData scanData;
+    scanData.addData(std::string((const char*)scanRsp, scanLen));
+    pAdvertising->setScanResponseData(scanData);
+    customAdvSet = true;
+    return;
+  }
+  // Later updates go straight to the GAP API from the caller's buffers
+  esp_ble_gap_config_adv_data_raw((uint8_t*)adv, advLen);
+  esp_ble_gap_config_scan_rsp_data_raw((uint8_t*)scanRsp, scanLen);
+}
+
+bool BLEBackendBluedroid::startAdvertising(uint16_t intervalUnits, bool bondedOnly) {
+  if (!pAdvertising) return false;
+  pAdvertising->setMinInterval(intervalUnits);
+  pAdvertising->setMaxInterval(intervalUnits);
+  bool filter = bondedOnly && loadWhitelist();
+  pAdvertising->setScanFilter(false, filter);
+  pAdvertising->start();
+  return filter;
+}
+
+void BLEBackendBluedroid::stopAdvertising() {
+  if (pAdvertising) pAdvertising->stop();
+}
+
+void BLEBackendBluedroid::notify(const uint8_t* data, size_t len) {
+  if (!pCharacteristic || !connected()) return;
+  pCharacteristic->setValue((uint8_t*)data, len);
+  pCharacteristic->notify();
+}
+
+bool BLEBackendBluedroid::connected() {
+  if (!pServer) return false;
+  return pServer->getConnectedCount() > 0;
+}
+
+int BLEBackendBluedroid::bondCount() {
+  return esp_ble_get_bond_device_num();
+}
+
+std::string BLEBackendBluedroid::address() {
+  return BLEDevice::getAddress().toString();
+}
+
+// Fill bondList from the persisted bond table; returns the entry count
+int BLEBackendBluedroid::loadBondList() {
+  int n = esp_ble_get_bond_device_num();
+  if (n <= 0) return 0;
+  if (n > MAX_BONDS) n = MAX_BONDS;
+  if (esp_ble_get_bond_device_list(&n, bondList) != ESP_OK) return 0;
+  return n;
+}
+
+// Rebuild the controller whitelist from the persisted bond table.
+// Returns false when there is no bonded phone to restrict to.
+bool BLEBackendBluedroid::loadWhitelist() {
+  esp_ble_gap_clear_whitelist();
+  int n = loadBondList();
+  for (int i = 0; i < n; i++) {
+    esp_ble_gap_update_whitelist(true, bondList[i].bond_key.pid_key.static_addr,
+                                 (esp_ble_wl_addr_type_t)bondList[i].bond_key.pid_key.addr_type);
+  }
+  return n > 0;
+}
+
+bool BLEBackendBluedroid::isBonded(const esp_bd_addr_t bda) {
+  int n = loadBondList();
+  for (int i = 0; i < n; i++) {
+    if (memcmp(bondList[i].bd_addr, bda, sizeof(esp_bd_addr_t)) == 0) return true;
+  }
+  return false;
+}
+
+void BLEBackendBluedroid::clearBonds() {
+  int n = loadBondList();
+  for (int i = 0; i < n; i++) esp_ble_remove_bond_device(bondList[i].bd_addr);
+  esp_ble_gap_clear_whitelist();
+  Serial.printf("BLE: %d bond(s) removed\n", n);
+}
+
+uint8_t BLEBackendBluedroid::readPeerTime(TimeSample* out, uint8_t count, uint16_t spacingMs) {
+  if (!connected()) return 0;
+  if (!pClient) pClient = BLEDevice::createClient();
+  // The phone is already connected to our server: this only opens a GATT
+  // client channel on the same link, no second connection
+  if (!pClient->isConnected() && !pClient->connect(BLEAddress(peerBda))) return 0;
+  BLERemoteService* svc = pClient->getService(BLEUUID((uint16_t)CTS_SERVICE_UUID16));
+  BLERemoteCharacteristic* ch = svc ? svc->getCharacteristic(BLEUUID((uint16_t)CTS_CURRENT_TIME_UUID16)) : nullptr;
+  if (!ch || !ch->canRead()) return 0;
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < count && connected(); i++) {
+    if (i) vTaskDelay(pdMS_TO_TICKS(spacingMs));
+    TimeSample& s = out[n];
+    s.sentMs = millis();
+    std::string v = ch->readValue();
+    s.rxMs = millis();
+    if (v.empty()) break;
+    s.len = (uint8_t)(v.size() < sizeof(s.value) ? v.size() : sizeof(s.value));
+    memcpy(s.value, v.data(), s.len);
+    n++;
+  }
+  return n;
+}
+
+/* ===== ServerCallbacks ===== */
+
+void BLEBackendBluedroid::ServerCallbacks::onConnect(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) {
+  bool bonded = parent->isBonded(param->connect.remote_bda);
+  memcpy(parent->peerBda, param->connect.remote_bda, sizeof(esp_bd_addr_t));
+  parent->linkEncrypted = false;
+  // Start encryption right away: bonded phones resume with the stored keys,
+  // new phones pair (Just Works) and get added to the bond table.
+  esp_ble_set_encryption(param->connect.remote_bda, ESP_BLE_SEC_ENCRYPT_NO_MITM);
+  if (parent->listener) parent->listener->onBackendConnect(bonded);
+}
+
+void BLEBackendBluedroid::ServerCallbacks::onDisconnect(BLEServer* pServer) {
+  parent->linkEncrypted = false;
+  if (parent->listener) parent->listener->onBackendDisconnect();
+}
+
+/* ===== CharCallbacks ===== */
+
+void BLEBackendBluedroid::CharCallbacks::onWrite(BLECharacteristic* pChar) {
+  if (parent->listener) parent->listener->onBackendWrite((const char*)pChar->getData(), pChar->getLength());
+}
+
+/* ===== SecurityCallbacks ===== */
+
+void BLEBackendBluedroid::SecurityCallbacks::onAuthenticationComplete(esp_ble_auth_cmpl_t cmpl) {
+  parent->linkEncrypted = cmpl.success;
+  if (cmpl.success) {
+    Serial.println("BLE: link encrypted (bonded)");
+  } else {
+    Serial.printf("BLE: pairing failed, reason=0x%x\n", cmpl.fail_reason);
+  }
+}
+
+#endif // BLE_BACKEND_NIMBLE
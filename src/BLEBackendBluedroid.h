@@ -0,0 +1,73 @@
+#pragma once
+
+#ifndef BLE_BACKEND_NIMBLE
+
+#include "BLEBackend.h"
+#include <BLEDevice.h>
+#include <BLEUtils.h>
+#include <BLEServer.h>
+#include <BLESecurity.h>
+#include <BLEClient.h>
+
+// Default backend: Arduino ESP32 BLE library on top of Bluedroid
+class BLEBackendBluedroid : public BLEBackend {
+public:
+  const char* name() const override { return "bluedroid"; }
+  void begin(const char* deviceName, Listener* listener) override;
+  void setAdvData(const uint8_t* adv, size_t advLen, const uint8_t* scanRsp, size_t scanLen) override;
+  bool startAdvertising(uint16_t intervalUnits, bool bondedOnly) override;
+  void stopAdvertising() override;
+  void notify(const uint8_t* data, size_t len) override;
+  bool connected() override;
+  int bondCount() override;
+  void clearBonds() override;
+  std::string address() override;
+  bool encrypted() override { return linkEncrypted; }
+  uint8_t readPeerTime(TimeSample* out, uint8_t count, uint16_t spacingMs) override;
+
+private:
+  BLEServer* pServer = nullptr;
+  BLECharacteristic* pCharacteristic = nullptr;
+  BLEAdvertising* pAdvertising = nullptr; // ⬅️ INI WAJIB
+  Listener* listener = nullptr;
+  bool customAdvSet = false;
+  // Connected phone, for the GATT client (CTS)
+  BLEClient* pClient = nullptr;
+  esp_bd_addr_t peerBda = {0};
+  volatile bool linkEncrypted = false;
+
+  int loadBondList();
+  bool loadWhitelist();
+  bool isBonded(const esp_bd_addr_t bda);
+
+  class ServerCallbacks : public BLEServerCallbacks {
+  public:
+    ServerCallbacks(BLEBackendBluedroid* parent) : parent(parent) {}
+    void onConnect(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) override;
+    void onDisconnect(BLEServer* pServer) override;
+  private:
+    BLEBackendBluedroid* parent;
+  };
+
+  class CharCallbacks : public BLECharacteristicCallbacks {
+  public:
+    CharCallbacks(BLEBackendBluedroid* parent) : parent(parent) {}
+    void onWrite(BLECharacteristic* pChar) override;
+  private:
+    BLEBackendBluedroid* parent;
+  };
+
+  class SecurityCallbacks : public BLESecurityCallbacks {
+  public:
+    SecurityCallbacks(BLEBackendBluedroid* parent) : parent(parent) {}
+    uint32_t onPassKeyRequest() override { return 0; }
+    void onPassKeyNotify(uint32_t) override {}
+    bool onSecurityRequest() override { return true; }
+    bool onConfirmPIN(uint32_t) override { return true; }
+    void onAuthenticationComplete(esp_ble_auth_cmpl_t cmpl) override;
+  private:
+    BLEBackendBluedroid* parent;
+  };
+};
+
+#endif // BLE_BACKEND_NIMBLE
@@ -0,0 +1,238 @@
+#include "BLEBackendNimBLE.h"
+
+#ifdef BLE_BACKEND_NIMBLE
+
+// Upper bound for one GATT client procedure (discovery or read)
+static const TickType_t GATT_OP_TIMEOUT = pdMS_TO_TICKS(3000);
+
+BLEBackend& BLEBackend::instance() {
+  static BLEBackendNimBLE backend;
+  return backend;
+}
+
+void BLEBackendNimBLE::begin(const char* deviceName, Listener* l) {
+  listener = l;
+
+  NimBLEDevice::init(deviceName);
+
+  // ===== Security / bonding =====
+  // Just Works + bonding + LE secure connections; NimBLE persists the keys in NVS
+  NimBLEDevice::setSecurityAuth(true, false, true);
+  NimBLEDevice::setSecurityIOCap(BLE_HS_IO_NO_INPUT_OUTPUT);
+  NimBLEDevice::setSecurityInitKey(BLE_SM_PAIR_KEY_DIST_ENC | BLE_SM_PAIR_KEY_DIST_ID);
+  NimBLEDevice::setSecurityRespKey(BLE_SM_PAIR_KEY_DIST_ENC | BLE_SM_PAIR_KEY_DIST_ID);
+
+  pServer = NimBLEDevice::createServer();
+  pServer->setCallbacks(new ServerCallbacks(this));
+  // Advertising restart is owned by BLEModule's policy, not the stack
+  pServer->advertiseOnDisconnect(false);
+
+  // Fixed creation order -> stable handles for bonded phones' GATT cache.
+  // NimBLE adds the 0x2902 descriptor for NOTIFY by itself.
+  NimBLEService* pService = pServer->createService(BLE_SERVICE_UUID);
+
+  pCharacteristic = pService->createCharacteristic(
+    BLE_CHAR_UUID,
+    NIMBLE_PROPERTY::READ |
+    NIMBLE_PROPERTY::WRITE |
+    NIMBLE_PROPERTY::WRITE_NR |
+    NIMBLE_PROPERTY::NOTIFY
+  );
+
+  pCharacteristic->setCallbacks(new CharCallbacks(this));
+  pCharacteristic->setValue("READY");
+
+  pService->start();
+
+  pAdvertising = NimBLEDevice::getAdvertising();
+  pAdvertising->setScanResponse(true);
+}
+
+void BLEBackendNimBLE::setAdvData(const uint8_t* adv, size_t advLen, const uint8_t* scanRsp, size_t scanLen) {
+  if (!pAdvertising) return;
+  if (!customAdvSet) {
+    // First time through the library wrapper so start() keeps our payload
+    NimBLEAdvertisementData advData;
+    advData.addData(std::string((const char*)adv, advLen));
+    pAdvertising->setAdvertisementData(advData);
+    NimBLEAdvertisementData scanData;
+    scanData.addData(std::string((const char*)scanRsp, scanLen));
+    pAdvertising->setScanResponseData(scanData);
+    customAdvSet = true;
+    return;
+  }
+  ble_gap_adv_set_data(adv, advLen);
+  ble_gap_adv_rsp_set_data(scanRsp, scanLen);
+}
+
+bool BLEBackendNimBLE::startAdvertising(uint16_t intervalUnits, bool bondedOnly) {
+  if (!pAdvertising) return false;
+  pAdvertising->setMinInterval(intervalUnits);
+  pAdvertising->setMaxInterval(intervalUnits);
+  bool filter = bondedOnly && loadWhitelist();
+  pAdvertising->setScanFilter(false, filter);
+  pAdvertising->start();
+  return filter;
+}
+
+void BLEBackendNimBLE::stopAdvertising() {
+  if (pAdvertising) pAdvertising->stop();
+}
+
+void BLEBackendNimBLE::notify(const uint8_t* data, size_t len) {
+  if (!pCharacteristic || !connected()) return;
+  pCharacteristic->setValue(data, len);
+  pCharacteristic->notify();
+}
+
+bool BLEBackendNimBLE::connected() {
+  if (!pServer) return false;
+  return pServer->getConnectedCount() > 0;
+}
+
+int BLEBackendNimBLE::bondCount() {
+  return NimBLEDevice::getNumBonds();
+}
+
+std::string BLEBackendNimBLE::address() {
+  return NimBLEDevice::getAddress().toString();
+}
+
+void BLEBackendNimBLE::clearWhitelist() {
+  for (int i = (int)NimBLEDevice::getWhiteListCount() - 1; i >= 0; i--) {
+    NimBLEDevice::whiteListRemove(NimBLEDevice::getWhiteListAddress(i));
+  }
+}
+
+// Rebuild the whitelist from the persisted bond table.
+// Returns false when there is no bonded phone to restrict to.
+bool BLEBackendNimBLE::loadWhitelist() {
+  clearWhitelist();
+  int n = NimBLEDevice::getNumBonds();
+  for (int i = 0; i < n; i++) {
+    NimBLEDevice::whiteListAdd(NimBLEDevice::getBondedAddress(i));
+  }
+  return n > 0;
+}
+
+void BLEBackendNimBLE::clearBonds() {
+  int n = NimBLEDevice::getNumBonds();
+  NimBLEDevice::deleteAllBonds();
+  clearWhitelist();
+  Serial.printf("BLE: %d bond(s) removed\n", n);
+}
+
+// CTS through the host's GATT client API on the server connection handle;
+// NimBLEClient would want to own the connection.
+uint8_t BLEBackendNimBLE::readPeerTime(TimeSample* out, uint8_t count, uint16_t spacingMs) {
+  if (!op.done) op.done = xSemaphoreCreateBinary();
+  uint16_t conn = connHandle;
+  if (conn == 0xFFFF) return 0;
+
+  static const ble_uuid16_t svcUuid = BLE_UUID16_INIT(CTS_SERVICE_UUID16);
+  static const ble_uuid16_t chrUuid = BLE_UUID16_INIT(CTS_CURRENT_TIME_UUID16);
+  op.start = op.end = op.valHandle = 0;
+  resetOp();
+  if (ble_gattc_disc_svc_by_uuid(conn, &svcUuid.u, onService, &op) != 0 || !waitOp() || !op.start) return 0;
+  resetOp();
+  if (ble_gattc_disc_chrs_by_uuid(conn, op.start, op.end, &chrUuid.u, onChar, &op) != 0 || !waitOp() ||
+      !op.valHandle) {
+    return 0;
+  }
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < count && connHandle == conn; i++) {
+    if (i) vTaskDelay(pdMS_TO_TICKS(spacingMs));
+    TimeSample& s = out[n];
+    op.len = 0;
+    resetOp();
+    s.sentMs = millis();
+    if (ble_gattc_read(conn, op.valHandle, onRead, &op) != 0 || !waitOp()) break;
+    s.rxMs = millis();
+    s.len = op.len;
+    memcpy(s.value, op.value, op.len);
+    n++;
+  }
+  return n;
+}
+
+// Before starting a procedure: the callback may run before the start call returns
+void BLEBackendNimBLE::resetOp() {
+  op.status = -1;
+  xSemaphoreTake(op.done, 0);
+}
+
+// True when the procedure finished without error
+bool BLEBackendNimBLE::waitOp() {
+  if (xSemaphoreTake(op.done, GATT_OP_TIMEOUT) != pdTRUE) return false;
+  return op.status == 0;
+}
+
+int BLEBackendNimBLE::onService(uint16_t, const ble_gatt_error* err, const ble_gatt_svc* svc, void* arg) {
+  GattOp* o = static_cast<GattOp*>(arg);
+  if (err->status == 0) {
+    o->start = svc->start_handle;
+    o->end = svc->end_handle;
+    return 0;
+  }
+  o->status = err->status == BLE_HS_EDONE ? 0 : err->status;
+  xSemaphoreGive(o->done);
+  return 0;
+}
+
+int BLEBackendNimBLE::onChar(uint16_t, const ble_gatt_error* err, const ble_gatt_chr* chr, void* arg) {
+  GattOp* o = static_cast<GattOp*>(arg);
+  if (err->status == 0) {
+    if (chr->properties & BLE_GATT_CHR_PROP_READ) o->valHandle = chr->val_handle;
+    return 0;
+  }
+  o->status = err->status == BLE_HS_EDONE ? 0 : err->status;
+  xSemaphoreGive(o->done);
+  return 0;
+}
+
+int BLEBackendNimBLE::onRead(uint16_t, const ble_gatt_error* err, ble_gatt_attr* attr, void* arg) {
+  GattOp* o = static_cast<GattOp*>(arg);
+  if (err->status == 0) {
+    uint16_t len = 0;
+    ble_hs_mbuf_to_flat(attr->om, o->value, sizeof(o->value), &len);
+    o->len = (uint8_t)len;
+  }
+  o->status = err->status;
+  xSemaphoreGive(o->done);
+  return 0;
+}
+
+/* ===== ServerCallbacks ===== */
+
+void BLEBackendNimBLE::ServerCallbacks::onConnect(NimBLEServer* pServer, ble_gap_conn_desc* desc) {
+  bool bonded = NimBLEDevice::isBonded(NimBLEAddress(desc->peer_id_addr));
+  parent->connHandle = desc->conn_handle;
+  parent->linkEncrypted = false;
+  // Resume encryption with stored keys, or pair a new phone (Just Works)
+  NimBLEDevice::startSecurity(desc->conn_handle);
+  if (parent->listener) parent->listener->onBackendConnect(bonded);
+}
+
+void BLEBackendNimBLE::ServerCallbacks::onDisconnect(NimBLEServer* pServer) {
+  parent->connHandle = 0xFFFF;
+  parent->linkEncrypted = false;
+  if (parent->listener) parent->listener->onBackendDisconnect();
+}
+
+void BLEBackendNimBLE::ServerCallbacks::onAuthenticationComplete(ble_gap_conn_desc* desc) {
+  parent->linkEncrypted = desc->sec_state.encrypted;
+  if (desc->sec_state.encrypted) {
+    Serial.println("BLE: link encrypted (bonded)");
+  } else {
+    Serial.println("BLE: pairing failed");
+  }
+}
+
+/* ===== CharCallbacks ===== */
+
+void BLEBackendNimBLE::CharCallbacks::onWrite(NimBLECharacteristic* pChar) {
+  NimBLEAttValue val = pChar->getValue();
+  if (parent->listener) parent->listener->onBackendWrite((const char*)val.data(), val.length());
+}
+
+#endif // BLE_BACKEND_NIMBLE
@@ -0,0 +1,75 @@
+#pragma once
+
+#ifdef BLE_BACKEND_NIMBLE
+
+#include "BLEBackend.h"
+#include <NimBLEDevice.h>
+
+// Lightweight backend on NimBLE-Arduino 1.4.x (h2zero/NimBLE-Arduino).
+// Same GATT layout, advertising and bonding behaviour as the Bluedroid one.
+class BLEBackendNimBLE : public BLEBackend {
+public:
+  const char* name() const override { return "nimble"; }
+  void begin(const char* deviceName, Listener* listener) override;
+  void setAdvData(const uint8_t* adv, size_t advLen, const uint8_t* scanRsp, size_t scanLen) override;
+  bool startAdvertising(uint16_t intervalUnits, bool bondedOnly) override;
+  void stopAdvertising() override;
+  void notify(const uint8_t* data, size_t len) override;
+  bool connected() override;
+  int bondCount() override;
+  void clearBonds() override;
+  std::string address() override;
+  bool encrypted() override { return linkEncrypted; }
+  uint8_t readPeerTime(TimeSample* out, uint8_t count, uint16_t spacingMs) override;
+
+private:
+  NimBLEServer* pServer = nullptr;
+  NimBLECharacteristic* pCharacteristic = nullptr;
+  NimBLEAdvertising* pAdvertising = nullptr;
+  Listener* listener = nullptr;
+  bool customAdvSet = false;
+  // Connected phone, for the GATT client (CTS)
+  volatile uint16_t connHandle = 0xFFFF;
+  volatile bool linkEncrypted = false;
+
+  // One GATT client procedure in flight: the host task callbacks fill it and
+  // give `done`. Kept in the object (not on the caller's stack) because a
+  // late callback after a timeout still writes here.
+  struct GattOp {
+    SemaphoreHandle_t done;
+    volatile int status;
+    uint16_t start, end, valHandle;
+    uint8_t value[10];
+    uint8_t len;
+  };
+  GattOp op = {};
+
+  void resetOp();
+  bool waitOp();
+  static int onService(uint16_t conn, const ble_gatt_error* err, const ble_gatt_svc* svc, void* arg);
+  static int onChar(uint16_t conn, const ble_gatt_error* err, const ble_gatt_chr* chr, void* arg);
+  static int onRead(uint16_t conn, const ble_gatt_error* err, ble_gatt_attr* attr, void* arg);
+
+  void clearWhitelist();
+  bool loadWhitelist();
+
+  class ServerCallbacks : public NimBLEServerCallbacks {
+  public:
+    ServerCallbacks(BLEBackendNimBLE* parent) : parent(parent) {}
+    void onConnect(NimBLEServer* pServer, ble_gap_conn_desc* desc) override;
+    void onDisconnect(NimBLEServer* pServer) override;
+    void onAuthenticationComplete(ble_gap_conn_desc* desc) override;
+  private:
+    BLEBackendNimBLE* parent;
+  };
+
+  class CharCallbacks : public NimBLECharacteristicCallbacks {
+  public:
+    CharCallbacks(BLEBackendNimBLE* parent) : parent(parent) {}
+    void onWrite(NimBLECharacteristic* pChar) override;
+  private:
+    BLEBackendNimBLE* parent;
+  };
+};
+
+#endif // BLE_BACKEND_NIMBLE
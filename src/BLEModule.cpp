@@ -1,93 +1,228 @@
 #include "BLEModule.h"
-#include <BLE2902.h>
 
-static const char* SERVICE_UUID = "12345678-1234-1234-1234-123456789abc";
-static const char* CHAR_UUID    = "abcdefab-1234-5678-1234-abcdefabcdef";
+// Radio-on time of one legacy advertising event on 3 channels (ADV_IND +
+// scan request/response window), used only for the duty-cycle estimate.
+static const uint32_t ADV_EVENT_RADIO_US = 1500;
+// Average of the 0..10 ms random advDelay the controller adds per event
+static const uint32_t ADV_DELAY_AVG_US = 5000;
 
-BLEModule::BLEModule() {}
+BLEModule::BLEModule() : backend(BLEBackend::instance()) {}
 
 void BLEModule::begin(const char* deviceName, WriteHandler onWrite, ConnHandler onConn) {
   writeHandler = onWrite;
   connHandler = onConn;
+  payload.begin(deviceName, BLE_SERVICE_UUID);
 
-  BLEDevice::init(deviceName);
+  backend.begin(deviceName, this);
+  cts.begin(backend);
+  started = true;
 
-  pServer = BLEDevice::createServer();
-  pServer->setCallbacks(new ServerCallbacks(this));
+  // ===== Advertising =====
+  applyAdvData();
+
+  // Boot burst: fast advertising so the phone finds us quickly after power-up
+  advFastUntil = millis() + advPolicy.burstMs;
+  setAdvMode(ADV_FAST);
+  startAdvertising(false);
+  ready = true;
+  Serial.printf("BLE: %s backend, advertising started (%d bonded)\n", backend.name(), backend.bondCount());
+}
 
-  BLEService* pService = pServer->createService(BLEUUID(SERVICE_UUID));
+void BLEModule::applyAdvData() {
+  if (!started) return;
+  backend.setAdvData(payload.adv(), payload.advLength(), payload.scan(), payload.scanLength());
+}
 
-  pCharacteristic = pService->createCharacteristic(
-    BLEUUID(CHAR_UUID),
-    BLECharacteristic::PROPERTY_READ |
-    BLECharacteristic::PROPERTY_WRITE |
-    BLECharacteristic::PROPERTY_WRITE_NR |
-    BLECharacteristic::PROPERTY_NOTIFY
-  );
+void BLEModule::setBeaconState(uint8_t flags) {
+  if (!ready) return;
+  // Advertising data can be replaced while advertising; no restart needed
+  if (payload.setBeacon(flags)) applyAdvData();
+}
 
-  pCharacteristic->addDescriptor(new BLE2902());
-  pCharacteristic->setCallbacks(new CharCallbacks(this));
-  pCharacteristic->setValue("READY");
+void BLEModule::setAdvPolicy(uint16_t fastIntervalMs, uint16_t slowIntervalMs, uint32_t burstMs) {
+  advPolicy.fastIntervalMs = fastIntervalMs;
+  advPolicy.slowIntervalMs = slowIntervalMs;
+  advPolicy.burstMs = burstMs;
+}
 
-  pService->start();
+void BLEModule::advBurst() {
+  if (!ready || connected()) return;
+  advFastUntil = millis() + advPolicy.burstMs;
+  if (advMode == ADV_SLOW) {
+    backend.stopAdvertising();
+    setAdvMode(ADV_FAST);
+    startAdvertising(false);
+  }
+}
 
-  // ===== Advertising =====
-  pAdvertising = BLEDevice::getAdvertising();
-  pAdvertising->addServiceUUID(BLEUUID(SERVICE_UUID));
-  pAdvertising->setScanResponse(true);
+void BLEModule::update() {
+  if (!ready || connected()) return;
+  unsigned long now = millis();
+  // Bonded-only window expired without a reconnect: open up for new phones
+  if (whitelistAdv && (long)(now - whitelistAdvUntil) >= 0) {
+    backend.stopAdvertising();
+    startAdvertising(false);
+    Serial.println("BLE: bonded window expired, open advertising");
+  }
+  // Burst over and nothing happened: back off to the slow interval
+  if (advMode == ADV_FAST && (long)(now - advFastUntil) >= 0) {
+    backend.stopAdvertising();
+    setAdvMode(ADV_SLOW);
+    startAdvertising(false);
+    Serial.printf("BLE: idle, slow advertising (%u ms)\n", advPolicy.slowIntervalMs);
+  }
+}
 
-  // PENTING UNTUK ANDROID / MIT APP INVENTOR
-  pAdvertising->setMinPreferred(0x06);
-  pAdvertising->setMinPreferred(0x12);
+// Close the time accounting of the current mode and enter a new one
+void BLEModule::setAdvMode(AdvMode m) {
+  unsigned long now = millis();
+  advModeMs[advMode] += now - advModeSince;
+  advModeSince = now;
+  advMode = m;
+}
+
+uint16_t BLEModule::advIntervalMs(AdvMode m) const {
+  return m == ADV_SLOW ? advPolicy.slowIntervalMs : advPolicy.fastIntervalMs;
+}
 
-  pAdvertising->start();
-  Serial.println("BLE: advertising started");
+void BLEModule::startAdvertising(bool bondedOnly) {
+  if (!started) return;
+  // Interval in 0.625 ms units, clamped to the BLE range 20 ms .. 10.24 s
+  uint32_t units = (uint32_t)advIntervalMs(advMode) * 8 / 5;
+  if (units < 0x20) units = 0x20;
+  if (units > 0x4000) units = 0x4000;
+  bool filter = backend.startAdvertising((uint16_t)units, bondedOnly);
+  whitelistAdv = filter;
+  if (filter) whitelistAdvUntil = millis() + BONDED_ADV_WINDOW_MS;
 }
 
-void BLEModule::notify(const std::string& value) {
-  if (!pCharacteristic || !connected()) return;
-  pCharacteristic->setValue(value);
-  pCharacteristic->notify();
+void BLEModule::clearBonds() {
+  if (ready) backend.clearBonds();
+}
+
+void BLEModule::notify(const char* data, size_t len) {
+  if (ready) backend.notify((const uint8_t*)data, len);
 }
 
 bool BLEModule::connected() {
-  if (!pServer) return false;
-  return pServer->getConnectedCount() > 0;
+  return ready && backend.connected();
 }
 
-/* ===== ServerCallbacks ===== */
+const char* BLEModule::backendName() const {
+  return backend.name();
+}
 
-void BLEModule::ServerCallbacks::onConnect(BLEServer* pServer) {
-  if (parent && parent->connHandler) {
-    parent->connHandler(true);
+std::string BLEModule::address() {
+  return backend.address();
+}
+
+void BLEModule::addSample(LatencyStat& st, uint32_t ms) {
+  st.count++;
+  st.sumMs += ms;
+  if (ms > st.maxMs) st.maxMs = ms;
+}
+
+void BLEModule::printStat(Print& out, const char* label, const LatencyStat& st) {
+  if (st.count == 0) {
+    out.printf("  %-22s n=0\n", label);
+    return;
   }
-  Serial.println("BLE: central connected");
+  out.printf("  %-22s n=%lu avg=%lums max=%lums\n", label,
+                (unsigned long)st.count, (unsigned long)(st.sumMs / st.count), (unsigned long)st.maxMs);
 }
 
-void BLEModule::ServerCallbacks::onDisconnect(BLEServer* pServer) {
-  if (parent && parent->connHandler) {
-    parent->connHandler(false);
+void BLEModule::printAdvStats(Print& out) {
+  static const char* names[ADV_MODE_COUNT] = {"suspended", "fast", "slow"};
+  unsigned long now = millis();
+  unsigned long ms[ADV_MODE_COUNT];
+  unsigned long total = 0;
+  for (int m = 0; m < ADV_MODE_COUNT; m++) {
+    ms[m] = advModeMs[m] + (m == advMode ? now - advModeSince : 0);
+    total += ms[m];
   }
+  if (total == 0) total = 1;
+
+  out.printf("ADV policy: fast=%u ms slow=%u ms burst=%lu ms, now %s\n",
+                advPolicy.fastIntervalMs, advPolicy.slowIntervalMs,
+                (unsigned long)advPolicy.burstMs, names[advMode]);
+  float overall = 0;
+  for (int m = 0; m < ADV_MODE_COUNT; m++) {
+    // While connected the radio follows the connection interval, not advertising
+    float duty = 0;
+    if (m != ADV_SUSPENDED) {
+      duty = 100.0f * ADV_EVENT_RADIO_US / ((float)advIntervalMs((AdvMode)m) * 1000.0f + ADV_DELAY_AVG_US);
+    }
+    overall += duty * ms[m] / total;
+    out.printf("  %-9s time=%5.1f%% duty~%.2f%%", names[m], 100.0f * ms[m] / total, duty);
+    if (m != ADV_SUSPENDED) {
+      const LatencyStat& d = advDiscovery[m];
+      out.printf(" connects=%lu discovery avg=%lums max=%lums",
+                    (unsigned long)d.count, d.count ? (unsigned long)(d.sumMs / d.count) : 0UL,
+                    (unsigned long)d.maxMs);
+    }
+    out.println();
+  }
+  out.printf("  overall duty~%.2f%%\n", overall);
+  out.printf("  beacon flags=0x%02x counter=%u updates=%lu\n",
+                payload.beaconFlags(), payload.beaconCounter(), (unsigned long)payload.updates());
+}
 
-  Serial.println("BLE: central disconnected, restarting advertising");
-  // 🔥 INI KUNCI RECONNECT - gunakan objek advertising yang dibuat di parent
-  if (parent && parent->pAdvertising) {
-    // small pause to ensure stack is ready
-    delay(20);
-    parent->pAdvertising->start();
-  } else {
-    // fallback
-    pServer->getAdvertising()->start();
+void BLEModule::printStats(Print& out) {
+  out.printf("BLE stats (%s, bonds=%d, free heap=%lu):\n", backend.name(), backend.bondCount(),
+                (unsigned long)ESP.getFreeHeap());
+  printStat(out, "reconnect bonded", reconnectBonded);
+  printStat(out, "reconnect unbonded", reconnectUnbonded);
+  printStat(out, "1st cmd bonded", firstCmdBonded);
+  printStat(out, "1st cmd unbonded", firstCmdUnbonded);
+}
+
+/* ===== Backend events ===== */
+
+void BLEModule::onBackendConnect(bool bonded) {
+  unsigned long now = millis();
+  peerBonded = bonded;
+  whitelistAdv = false;
+  // Advertising stops on connect; the time since it (re)started is the discovery latency
+  if (advMode != ADV_SUSPENDED) {
+    addSample(advDiscovery[advMode], now - advModeSince);
+    setAdvMode(ADV_SUSPENDED);
   }
+  connectAt = now;
+  firstWritePending = true;
+  if (disconnectAt != 0) {
+    addSample(bonded ? reconnectBonded : reconnectUnbonded, now - disconnectAt);
+  }
+
+  if (connHandler) {
+    connHandler(true);
+  }
+  cts.onConnect();
+  Serial.printf("BLE: central connected (%s)\n", bonded ? "bonded" : "new");
 }
 
-/* ===== CharCallbacks ===== */
+void BLEModule::onBackendDisconnect() {
+  disconnectAt = millis();
+  firstWritePending = false;
+  if (connHandler) {
+    connHandler(false);
+  }
+
+  Serial.println("BLE: central disconnected, restarting advertising");
+  // 🔥 INI KUNCI RECONNECT - langsung advertise lagi, utamakan HP yang sudah bonded
+  advFastUntil = millis() + advPolicy.burstMs;
+  setAdvMode(ADV_FAST);
+  startAdvertising(true);
+}
 
-void BLEModule::CharCallbacks::onWrite(BLECharacteristic* pChar) {
-  std::string val = pChar->getValue();
+void BLEModule::onBackendWrite(const char* data, size_t len) {
+  if (firstWritePending) {
+    firstWritePending = false;
+    addSample(peerBonded ? firstCmdBonded : firstCmdUnbonded, millis() - connectAt);
+  }
   Serial.print("BLE: characteristic onWrite: ");
-  Serial.println(val.c_str());
-  if (parent && parent->writeHandler) {
-    parent->writeHandler(val);
+  Serial.write((const uint8_t*)data, len);
+  Serial.println();
+  if (writeHandler) {
+    writeHandler(data, len);
   }
 }
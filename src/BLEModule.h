@@ -2,42 +2,114 @@
 
 #include <Arduino.h>
 #include <functional>
-#include <BLEDevice.h>
-#include <BLEUtils.h>
-#include <BLEServer.h>
+#include "BLEBackend.h"
+#include "CurrentTimeClient.h"
+#include "AdvPayload.h"
 
-class BLEModule {
+class BLEModule : private BLEBackend::Listener {
 public:
-  using WriteHandler = std::function<void(const std::string&)>;
+  using WriteHandler = std::function<void(const char* data, size_t len)>;
   using ConnHandler = std::function<void(bool)>;
 
   BLEModule();
+  // Brings the stack up (hundreds of ms); may run in a boot task while loop()
+  // already calls the rest, which does nothing until isReady()
   void begin(const char* deviceName, WriteHandler onWrite, ConnHandler onConn);
-  void notify(const std::string& value);
+  bool isReady() const { return ready; }
+  // Dipanggil dari loop(): menutup jendela advertising khusus perangkat bonded
+  void update();
+  void notify(const char* data, size_t len);
+  void notify(const char* text) { notify(text, strlen(text)); }
   bool connected();
+  // Stack in use ("bluedroid" / "nimble") and own BLE MAC address
+  const char* backendName() const;
+  std::string address();
+
+  // Advertising policy: fast interval for burstMs after boot / disconnect /
+  // activity, then slow interval until the next burst. Call before begin().
+  void setAdvPolicy(uint16_t fastIntervalMs, uint16_t slowIntervalMs, uint32_t burstMs);
+  // User activity (button, remote): switch back to fast advertising
+  void advBurst();
+
+  // Connectionless status beacon: flags are BeaconFlag bits. The advertising
+  // payload is rebuilt (and the rolling counter bumped) only when they change.
+  // Manufacturer data: company 0xFFFF (LE), type 0xB1, flags, counter
+  void setBeaconState(uint8_t flags);
+
+  // Reconnect latency statistics (bonded vs unbonded peers)
+  void printStats(Print& out = Serial);
+  // Time, estimated radio duty cycle and discovery latency per advertising mode
+  void printAdvStats(Print& out = Serial);
+  // Remove all bonded phones from the persisted bond table
+  void clearBonds();
+
+  // Phone clock over the Current Time Service, read after each connection
+  // (see CurrentTimeClient). loop() gets one result per attempt.
+  bool takePeerTime(PeerTime& t) { return cts.take(t); }
+  void setPeerTimeSync(bool on) { cts.setEnabled(on); }
+  bool peerTimeSync() const { return cts.isEnabled(); }
+  void printPeerTimeStats(Print& out = Serial) { cts.print(out); }
 
 private:
-  BLEServer* pServer = nullptr;
-  BLECharacteristic* pCharacteristic = nullptr;
-  BLEAdvertising* pAdvertising = nullptr; // ⬅️ INI WAJIB
+  // After a disconnect, advertising only accepts bonded phones (whitelist)
+  // for this window, then falls back to open advertising for new phones.
+  static const unsigned long BONDED_ADV_WINDOW_MS = 2000;
 
-  WriteHandler writeHandler;
-  ConnHandler connHandler;
+  enum AdvMode { ADV_SUSPENDED, ADV_FAST, ADV_SLOW, ADV_MODE_COUNT };
 
-  class ServerCallbacks : public BLEServerCallbacks {
-  public:
-    ServerCallbacks(BLEModule* parent) : parent(parent) {}
-    void onConnect(BLEServer* pServer) override;
-    void onDisconnect(BLEServer* pServer) override;
-  private:
-    BLEModule* parent;
+  struct AdvPolicy {
+    uint16_t fastIntervalMs;
+    uint16_t slowIntervalMs;
+    uint32_t burstMs;
   };
 
-  class CharCallbacks : public BLECharacteristicCallbacks {
-  public:
-    CharCallbacks(BLEModule* parent) : parent(parent) {}
-    void onWrite(BLECharacteristic* pChar) override;
-  private:
-    BLEModule* parent;
+  struct LatencyStat {
+    uint32_t count;
+    uint32_t sumMs;
+    uint32_t maxMs;
   };
+
+  BLEBackend& backend;
+  CurrentTimeClient cts;
+  bool started = false;
+  // Set at the end of begin(); gates the calls coming from loop()
+  volatile bool ready = false;
+
+  WriteHandler writeHandler;
+  ConnHandler connHandler;
+
+  AdvPolicy advPolicy = {30, 1000, 30000};
+
+  // Advertising / scan response payloads with the status beacon
+  AdvPayload payload;
+
+  // Written from BT callbacks, read from loop()
+  volatile AdvMode advMode = ADV_SUSPENDED;
+  volatile unsigned long advModeSince = 0;
+  volatile unsigned long advFastUntil = 0;
+  unsigned long advModeMs[ADV_MODE_COUNT] = {0, 0, 0};
+  LatencyStat advDiscovery[ADV_MODE_COUNT] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+  volatile bool whitelistAdv = false;
+  volatile unsigned long whitelistAdvUntil = 0;
+  volatile unsigned long disconnectAt = 0;
+  volatile unsigned long connectAt = 0;
+  volatile bool firstWritePending = false;
+  volatile bool peerBonded = false;
+
+  LatencyStat reconnectBonded = {0, 0, 0};
+  LatencyStat reconnectUnbonded = {0, 0, 0};
+  LatencyStat firstCmdBonded = {0, 0, 0};
+  LatencyStat firstCmdUnbonded = {0, 0, 0};
+
+  void applyAdvData();
+  void setAdvMode(AdvMode m);
+  void startAdvertising(bool bondedOnly);
+  uint16_t advIntervalMs(AdvMode m) const;
+  static void addSample(LatencyStat& st, uint32_t ms);
+  static void printStat(Print& out, const char* label, const LatencyStat& st);
+
+  // BLEBackend::Listener (called from the BT host task)
+  void onBackendConnect(bool bonded) override;
+  void onBackendDisconnect() override;
+  void onBackendWrite(const char* data, size_t len) override;
 };
@@ -0,0 +1,39 @@
+#include "BoardPins.h"
+#include <Arduino.h>
+#include <driver/gpio.h>
+#include <driver/rtc_io.h>
+#include "soc/gpio_struct.h"
+
+static void writeIdleLevels() {
+  GPIO.out_w1ts = boardIdleMask(BOARD, 0, true);
+  GPIO.out_w1tc = boardIdleMask(BOARD, 0, false);
+  GPIO.out1_w1ts.val = boardIdleMask(BOARD, 1, true);
+  GPIO.out1_w1tc.val = boardIdleMask(BOARD, 1, false);
+}
+
+void boardInitPins() {
+  // Idle levels into the output latches first so no pin glitches active
+  writeIdleLevels();
+  for (const BoardPin& p : BOARD.out) {
+    pinMode(p.gpio, OUTPUT);
+    // Held since parking: released now that the latch has the same level
+    gpio_hold_dis((gpio_num_t)p.gpio);
+  }
+  gpio_deep_sleep_hold_dis();
+  for (const BoardPin& p : BOARD.in) {
+    if (gpioRtcCapable(p.gpio)) rtc_gpio_deinit((gpio_num_t)p.gpio);
+    pinMode(p.gpio, p.role == PinRole::InputPullup ? INPUT_PULLUP : INPUT);
+  }
+  Serial.printf("Board profile: %s (outputs 0x%08lx / 0x%02lx)\n", BOARD.name,
+                (unsigned long)BOARD_OUT_MASK_LO, (unsigned long)BOARD_OUT_MASK_HI);
+}
+
+void boardHoldIdle() {
+  writeIdleLevels();
+  for (const BoardPin& p : BOARD.out) {
+    // pinMode routes the pad back from LEDC to the GPIO latch
+    pinMode(p.gpio, OUTPUT);
+    gpio_hold_en((gpio_num_t)p.gpio);
+  }
+  gpio_deep_sleep_hold_en();
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include "pin_config.h"
+
+// Configure every pin of the selected board profile in one pass: outputs
+// start at their inactive level, inputs get their pull-up where the profile
+// asks for one. Call first thing in setup(). Also undoes what parking left
+// behind (output pad holds, inputs in RTC IO mode).
+void boardInitPins();
+
+// Before deep sleep: every output back on the GPIO matrix at its inactive
+// level and held there (pad hold), so no relay floats on while the digital
+// core is powered down.
+void boardHoldIdle();
@@ -0,0 +1,27 @@
+#include "BootTrace.h"
+
+static const char* const PHASE_NAMES[BOOT_PHASE_COUNT] = {
+  "setup", "outputs", "settings", "inputs", "first tick", "rtc", "advertising", "done", "first input",
+};
+
+void BootTrace::mark(BootPhase p) {
+  if (at[p]) return;
+  uint32_t t = (uint32_t)micros();
+  at[p] = t ? t : 1;
+}
+
+void BootTrace::print(Print& out) const {
+  out.println("Boot phases (ms since app start):");
+  for (uint8_t i = 0; i < BOOT_PHASE_COUNT; i++) {
+    if (!at[i]) {
+      out.printf("  %-12s -\n", PHASE_NAMES[i]);
+      continue;
+    }
+    out.printf("  %-12s %5lu.%lu\n", PHASE_NAMES[i], (unsigned long)(at[i] / 1000), (unsigned long)(at[i] % 1000 / 100));
+  }
+  if (at[BOOT_LOOP]) {
+    out.printf("Time to input handling: %lu ms", (unsigned long)(at[BOOT_LOOP] / 1000));
+    if (at[BOOT_ADVERTISING]) out.printf(", to advertising: %lu ms", (unsigned long)(at[BOOT_ADVERTISING] / 1000));
+    out.println();
+  }
+}
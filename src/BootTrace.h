@@ -0,0 +1,31 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Boot phases, roughly in the order they complete
+enum BootPhase : uint8_t {
+  BOOT_SETUP,        // setup() entered
+  BOOT_OUTPUTS,      // every pin at its inactive level, OutputArbiter ready
+  BOOT_SETTINGS,     // NVS settings loaded
+  BOOT_INPUTS,       // door, remote, button and warm-up handlers started
+  BOOT_LOOP,         // first loop() tick: inputs are polled from here on
+  BOOT_RTC,          // RTC read, schedule built (first tick, deferred)
+  BOOT_ADVERTISING,  // BLE stack up and advertising (background task)
+  BOOT_DONE,         // every deferred stage finished
+  BOOT_FIRST_INPUT,  // first remote / button event handled
+  BOOT_PHASE_COUNT
+};
+
+// Timestamps of the boot phases in micros() (since the app started, so the
+// ROM and second-stage bootloader time before it is not included).
+// mark() may be called from any task; the first mark of a phase counts.
+class BootTrace {
+public:
+  void mark(BootPhase p);
+  bool reached(BootPhase p) const { return at[p] != 0; }
+  uint32_t us(BootPhase p) const { return at[p]; }
+  void print(Print& out) const;
+
+private:
+  volatile uint32_t at[BOOT_PHASE_COUNT] = {};
+};
@@ -1,40 +1,220 @@
 #pragma once
 #include <Arduino.h>
-#include <functional>
+#include "pin_config.h"
+#include "OutputArbiter.h"
+#include "PatternPlayer.h"
+#include "Sequencer.h"
 
+extern OutputArbiter outputs;
+extern PatternPlayer patterns;
+extern Sequencer sequencer;
+
+// Physical start button + LED_POWER indicator (OUT_LED_POWER).
+// Start sequence (Sequencer routine): ACC, 1 s, IG, 1 s, starter 1 s, then a
+// countdown during which a press cranks again; at its end the engine counts
+// as running.
+// Hooks is a type with static handlers, bound at compile time:
+//   struct ButtonHooks {
+//     static void onPress();           // every debounced press, before it is handled
+//     static void onReset();           // press while the engine runs
+//     static void setEngine(bool on);  // engine state decided by the start sequence
+//   };
+template <typename Hooks>
 class ButtonTombol {
 public:
-  ButtonTombol(uint8_t buttonPin = 18, uint8_t ledPin = 22);
+  ButtonTombol(uint8_t buttonPin = PIN_BUTTON);
   void begin();
   void update();
-  void setResetCallback(std::function<void()> cb) { _onReset = cb; }
-  void setEngineSetter(std::function<void(bool)> cb) { _setEngine = cb; }
-  void setEngineStatus(bool v);
+  void setEngineStatus(bool v) { _engineOn = v; }
   // Set countdown window after starter attempt (ms). Default 15000 (15s)
   void setCountdownMs(unsigned long ms) { _countdownMs = ms; }
   // Trigger start sequence externally (e.g. from BLE/remote). Behaves like initial button press.
   void triggerStart();
+  // Stop a running start sequence (reset_all); outputs are cleared by the caller
+  void cancelStart();
+  // Start sequence, countdown or manual crank in progress
+  bool busy() const { return _state != IDLE || _manualStarterHold; }
 private:
   enum State { IDLE, ACC_WAIT, IG_WAIT, STARTER_ACTIVE, COUNTDOWN };
-  uint8_t _btnPin, _ledPin;
+  uint8_t _btnPin;
   int _lastState;
   int _lastRead;
   // debounce
   unsigned long _lastDebounceTime;
   const unsigned long _debounceMs = 50;
-  unsigned long _stateUntil;
   unsigned long _countdownUntil;
   unsigned long _countdownMs;
   State _state;
   bool _starterRunning;
   bool _manualStarterHold;
   bool _engineOn;
-  std::function<void()> _onReset;
-  std::function<void(bool)> _setEngine;
-  
-  // LED blink helper
-  unsigned long _ledToggleAt;
-  bool _ledHigh;
-  void setLedBlink(unsigned long highMs, unsigned long lowMs);
-  unsigned long _ledHighMs, _ledLowMs;
+  Sequencer::Handle _startSeq;
+  Sequencer::Handle _crankSeq;
+
+  void beginStart();
+  void crankAgain();
+  static void startRoutine(Seq& s);
+  static void crankRoutine(Seq& s);
+
+  // LED_POWER blink (PATTERN_LED_IDLE / PATTERN_LED_FAST)
+  void setLed(const Pattern& p) { patterns.play(OUT_LED_POWER, SRC_BUTTON, p); }
 };
+
+template <typename Hooks>
+ButtonTombol<Hooks>::ButtonTombol(uint8_t buttonPin)
+  : _btnPin(buttonPin), _lastState(LOW), _countdownUntil(0),
+    _countdownMs(15000UL), _state(IDLE), _starterRunning(false), _manualStarterHold(false), _engineOn(false),
+    _startSeq(Sequencer::NONE), _crankSeq(Sequencer::NONE) {
+}
+
+template <typename Hooks>
+void ButtonTombol<Hooks>::begin() {
+  // Internal pull-up (board profile, boardInitPins()); wire button to GND
+  _lastRead = digitalRead(_btnPin);
+  _lastState = _lastRead;
+  _lastDebounceTime = millis();
+  // start idle slow blink
+  setLed(PATTERN_LED_IDLE);
+}
+
+template <typename Hooks>
+void ButtonTombol<Hooks>::startRoutine(Seq& s) {
+  ButtonTombol* self = (ButtonTombol*)s.ctx;
+  SEQ_BEGIN(s);
+  outputs.request(OUT_ACC, SRC_BUTTON, true);
+  Hooks::setEngine(false);
+  self->_state = ACC_WAIT;
+  self->setLed(PATTERN_LED_IDLE);
+  SEQ_SLEEP(s, 1000);
+  outputs.request(OUT_IG, SRC_BUTTON, true);
+  self->_state = IG_WAIT;
+  SEQ_SLEEP(s, 1000);
+  // starter pulse (ended by the pulse timer, not by this routine)
+  outputs.pulse(OUT_STARTER, SRC_BUTTON, 1000);
+  self->_starterRunning = true;
+  self->_state = STARTER_ACTIVE;
+  self->setLed(PATTERN_LED_FAST);
+  SEQ_SLEEP(s, 1000);
+  outputs.release(OUT_STARTER, SRC_BUTTON);
+  self->_starterRunning = false;
+  // countdown was started on the first press; presses during it extend it
+  self->_state = COUNTDOWN;
+  while ((long)(millis() - self->_countdownUntil) < 0) {
+    SEQ_SLEEP_UNTIL(s, self->_countdownUntil);
+  }
+  // assume engine started
+  self->_startSeq = Sequencer::NONE;
+  Hooks::setEngine(true);
+  self->_engineOn = true;
+  self->_state = IDLE;
+  self->setLed(PATTERN_LED_IDLE);
+  SEQ_END(s);
+}
+
+// Extra crank from the countdown: 1 s starter pulse, then back to COUNTDOWN
+template <typename Hooks>
+void ButtonTombol<Hooks>::crankRoutine(Seq& s) {
+  ButtonTombol* self = (ButtonTombol*)s.ctx;
+  SEQ_BEGIN(s);
+  outputs.pulse(OUT_STARTER, SRC_BUTTON, 1000);
+  self->_starterRunning = true;
+  self->_state = STARTER_ACTIVE;
+  self->setLed(PATTERN_LED_FAST);
+  SEQ_SLEEP(s, 1000);
+  outputs.release(OUT_STARTER, SRC_BUTTON);
+  self->_starterRunning = false;
+  self->_state = COUNTDOWN;
+  self->_crankSeq = Sequencer::NONE;
+  SEQ_END(s);
+}
+
+template <typename Hooks>
+void ButtonTombol<Hooks>::beginStart() {
+  // overall countdown starts now
+  _countdownUntil = millis() + _countdownMs;
+  _startSeq = sequencer.spawn(startRoutine, this, "start");
+}
+
+template <typename Hooks>
+void ButtonTombol<Hooks>::crankAgain() {
+  _countdownUntil = millis() + _countdownMs;
+  _crankSeq = sequencer.spawn(crankRoutine, this, "crank");
+}
+
+template <typename Hooks>
+void ButtonTombol<Hooks>::cancelStart() {
+  sequencer.cancel(_crankSeq);
+  sequencer.cancel(_startSeq);
+  _crankSeq = _startSeq = Sequencer::NONE;
+  _starterRunning = false;
+  _manualStarterHold = false;
+  if (_state != IDLE) {
+    _state = IDLE;
+    setLed(PATTERN_LED_IDLE);
+  }
+}
+
+template <typename Hooks>
+void ButtonTombol<Hooks>::triggerStart() {
+  // If engine already on, behave like press -> reset
+  if (_engineOn) {
+    Hooks::onReset();
+    return;
+  }
+  if (_state == IDLE) {
+    beginStart();
+  } else if (_state == COUNTDOWN) {
+    // restart starter attempt immediately (1s pulse, ended by the pulse timer)
+    crankAgain();
+  }
+}
+
+template <typename Hooks>
+void ButtonTombol<Hooks>::update() {
+  unsigned long now = millis();
+  int v = digitalRead(_btnPin);
+
+  // Debounce logic (INPUT_PULLUP): pressed when reading == LOW
+  if (v != _lastRead) {
+    _lastDebounceTime = now;
+    _lastRead = v;
+  }
+  if (now - _lastDebounceTime > _debounceMs) {
+    // stable state changed
+    if (v != _lastState) {
+      // falling edge (press)
+      if (_lastState == HIGH && v == LOW) {
+        Hooks::onPress();
+        if (_engineOn) {
+          Hooks::onReset();
+        } else {
+          if (_state == IDLE) {
+            beginStart();
+          } else if (_state == COUNTDOWN) {
+            // enter manual hold mode: starter on while held
+            outputs.request(OUT_STARTER, SRC_BUTTON, true);
+            _manualStarterHold = true;
+            _starterRunning = true;
+            // reset countdown window
+            _countdownUntil = now + _countdownMs;
+            setLed(PATTERN_LED_FAST);
+          }
+        }
+      }
+      // rising edge (release)
+      else if (_lastState == LOW && v == HIGH) {
+        // if manual hold was active, release starter
+        if (_manualStarterHold && _state == COUNTDOWN) {
+          outputs.release(OUT_STARTER, SRC_BUTTON);
+          _manualStarterHold = false;
+          _starterRunning = false;
+          // keep countdown running, LED remain fast
+          setLed(PATTERN_LED_FAST);
+        }
+      }
+      _lastState = v;
+    }
+  }
+
+  // Start sequence timing runs in startRoutine / crankRoutine (Sequencer)
+}
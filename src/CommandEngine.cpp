@@ -0,0 +1,68 @@
+#include "CommandEngine.h"
+#include <ctype.h>
+
+void CommandEngine::dispatch(char* line, size_t len, Transport& from) {
+  // trim leading/trailing whitespace (also the '\r' of CRLF terminals)
+  while (len > 0 && isspace((unsigned char)line[len - 1])) len--;
+  line[len] = '\0';
+  while (*line && isspace((unsigned char)*line)) line++;
+  if (*line == '\0') return;
+  lines++;
+
+  char* arg = line;
+  while (*arg && !isspace((unsigned char)*arg)) arg++;
+  size_t wordLen = arg - line;
+  while (*arg && isspace((unsigned char)*arg)) arg++;
+
+  Serial.printf("Cmd [%s]: %s\n", from.name(), line);
+
+  int i = indexOf(line, wordLen);
+  if (i >= 0) {
+    table[i].fn(arg, from);
+    return;
+  }
+
+  // Unknown: echo the command uppercased with '_' -> ' '
+  from.print("UNKNOWN ");
+  for (const char* p = line; *p; p++) {
+    from.write(*p == '_' ? ' ' : (uint8_t)toupper((unsigned char)*p));
+  }
+  from.println();
+  Serial.println("Action: UNKNOWN command");
+}
+
+void CommandEngine::printHelp(Print& out) const {
+  out.print("Commands:");
+  for (size_t i = 0; i < count; i++) {
+    out.print(i == 0 ? " " : ", ");
+    out.print(table[i].name);
+  }
+  out.println();
+}
+
+int CommandEngine::indexOf(const char* word, size_t len) const {
+  for (size_t i = 0; i < count; i++) {
+    const char* name = table[i].name;
+    if (strlen(name) == len && strncasecmp(name, word, len) == 0) return (int)i;
+  }
+  return -1;
+}
+
+uint16_t CommandEngine::nameId(const char* name, size_t len) {
+  uint32_t h = 2166136261UL;
+  for (size_t i = 0; i < len; i++) {
+    h = (h ^ (uint8_t)tolower((unsigned char)name[i])) * 16777619UL;
+  }
+  uint16_t id = (uint16_t)(h ^ (h >> 16));
+  return id ? id : 1;
+}
+
+int CommandEngine::indexOfId(uint16_t id) const {
+  int found = -1;
+  for (size_t i = 0; i < count; i++) {
+    if (nameId(table[i].name, strlen(table[i].name)) != id) continue;
+    if (found >= 0) return -2;
+    found = (int)i;
+  }
+  return found;
+}
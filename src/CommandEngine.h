@@ -0,0 +1,42 @@
+#pragma once
+
+#include <Arduino.h>
+#include "Transport.h"
+
+// Single command parser shared by every transport (BLE, USB serial, SPP).
+// Lines are parsed in place in the transport's receive buffer: the command
+// word is matched case-insensitively and the argument is handed to the
+// handler as a trimmed, NUL-terminated pointer into that same buffer.
+class CommandEngine {
+public:
+  using Handler = void (*)(char* arg, Transport& from);
+  struct Command {
+    const char* name;
+    Handler fn;
+  };
+
+  CommandEngine(const Command* table, size_t count) : table(table), count(count) {}
+  // line must have room for a terminator at line[len]
+  void dispatch(char* line, size_t len, Transport& from);
+  void printHelp(Print& out) const;
+  // Lines dispatched so far (activity for the parking timeout)
+  uint32_t dispatched() const { return lines; }
+
+  // Table access for stored macros (MacroVM)
+  size_t size() const { return count; }
+  const char* nameAt(size_t i) const { return table[i].name; }
+  // Index of the command word (case-insensitive), -1 if unknown
+  int indexOf(const char* word, size_t len) const;
+  void run(size_t i, char* arg, Transport& from) const { table[i].fn(arg, from); }
+  // Id of a command name in stored macros: FNV-1a of the lowercase name,
+  // folded to 16 bit, never 0. Does not depend on the table order, so adding
+  // a command leaves the ids of the others alone.
+  static uint16_t nameId(const char* name, size_t len);
+  // Index of the command with that id; -1 if none, -2 if two names share it
+  int indexOfId(uint16_t id) const;
+
+private:
+  const Command* table;
+  size_t count;
+  uint32_t lines = 0;
+};
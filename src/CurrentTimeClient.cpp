@@ -0,0 +1,113 @@
+#include "CurrentTimeClient.h"
+#include "TimeCodec.h"
+
+void CurrentTimeClient::begin(BLEBackend& b) {
+  backend = &b;
+  if (!task) {
+    xTaskCreatePinnedToCore(taskMain, "cts", 4096, this, 1, &task, 1);
+  }
+}
+
+void CurrentTimeClient::onConnect() {
+  if (!enabled || !task || state != IDLE) return;
+  connectMs = millis();
+  state = RUNNING;
+  xTaskNotifyGive(task);
+}
+
+bool CurrentTimeClient::take(PeerTime& out) {
+  if (state != DONE) return false;
+  out = result;
+  last = result;
+  state = IDLE;
+  return true;
+}
+
+void CurrentTimeClient::taskMain(void* arg) {
+  CurrentTimeClient* self = static_cast<CurrentTimeClient*>(arg);
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    self->run();
+  }
+}
+
+void CurrentTimeClient::run() {
+  while (!backend->encrypted() && backend->connected() && millis() - connectMs < ENCRYPT_WAIT_MS) {
+    vTaskDelay(pdMS_TO_TICKS(20));
+  }
+  PeerTime r = {};
+  r.samples = backend->readPeerTime(samples, SAMPLES, SPACING_MS);
+  r.ok = r.samples > 0 && estimate(samples, r.samples, r);
+  r.readyMs = millis() - connectMs;
+  attempts++;
+  if (r.ok) valid++;
+  else if (r.samples == 0) noService++;
+  else rejected++;
+  result = r;
+  state = DONE;
+}
+
+// Exact Time 256: year (LE), month, day, hours, minutes, seconds, day of week, Fractions256
+bool CurrentTimeClient::decode(const BLEBackend::TimeSample& s, int64_t& ms, bool& fraction) {
+  if (s.len < 9) return false;
+  const uint8_t* v = s.value;
+  CivilTime c = {};
+  c.year = (uint16_t)(v[0] | (v[1] << 8));
+  c.month = v[2];
+  c.day = v[3];
+  c.hour = v[4];
+  c.minute = v[5];
+  c.second = v[6];
+  if (c.year < 2000 || c.year > 2099 || c.month < 1 || c.month > 12 || c.day < 1 ||
+      c.day > TimeCodec::daysInMonth(c.year, c.month) || c.hour > 23 || c.minute > 59 || c.second > 59) {
+    return false;
+  }
+  fraction = v[8] != 0;
+  ms = (int64_t)TimeCodec::fromCivil(c) * 1000 + v[8] * 1000 / 256;
+  return true;
+}
+
+bool CurrentTimeClient::estimate(const BLEBackend::TimeSample* s, uint8_t n, PeerTime& out) {
+  int64_t t[SAMPLES];
+  bool fraction = false;
+  for (uint8_t i = 0; i < n; i++) {
+    bool f = false;
+    if (!decode(s[i], t[i], f)) return false;
+    fraction |= f;
+  }
+  const int64_t q = fraction ? 4 : 1000;
+  unsigned long base = s[0].sentMs;
+  int64_t lo = INT64_MIN, hi = INT64_MAX;
+  out.rttMinMs = 0xFFFF;
+  out.rttMaxMs = 0;
+  for (uint8_t i = 0; i < n; i++) {
+    int64_t sent = (int64_t)(s[i].sentMs - base), rx = (int64_t)(s[i].rxMs - base);
+    uint16_t rtt = (uint16_t)(rx - sent > 0xFFFF ? 0xFFFF : rx - sent);
+    if (rtt < out.rttMinMs) out.rttMinMs = rtt;
+    if (rtt > out.rttMaxMs) out.rttMaxMs = rtt;
+    if (t[i] - rx > lo) lo = t[i] - rx;
+    if (t[i] + q - sent < hi) hi = t[i] + q - sent;
+  }
+  // Empty intersection: the phone clock stepped during the burst
+  if (lo > hi) return false;
+  int64_t off = lo + (hi - lo) / 2;
+  out.sec = (uint32_t)(off / 1000);
+  out.ms = (uint16_t)(off % 1000);
+  out.atMs = base;
+  out.errMs = (uint16_t)((hi - lo) / 2 > 0xFFFF ? 0xFFFF : (hi - lo) / 2);
+  return true;
+}
+
+void CurrentTimeClient::print(Print& out) {
+  out.printf("CTS client: %s, attempts=%lu valid=%lu no-CTS=%lu rejected=%lu%s\n", enabled ? "on" : "off",
+             (unsigned long)attempts, (unsigned long)valid, (unsigned long)noService, (unsigned long)rejected,
+             state == RUNNING ? " (reading)" : "");
+  if (!attempts) return;
+  if (last.ok) {
+    out.printf("  last: %u samples, rtt %u-%u ms, +-%u ms, result %lu ms after connect\n", last.samples,
+               last.rttMinMs, last.rttMaxMs, last.errMs, last.readyMs);
+  } else {
+    out.printf("  last: %s, %lu ms after connect\n", last.samples ? "inconsistent samples" : "no Current Time Service",
+               last.readyMs);
+  }
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "BLEBackend.h"
+
+// Result of one CTS attempt, picked up by loop()
+struct PeerTime {
+  bool ok;                 // false: no CTS (samples == 0) or inconsistent samples
+  uint32_t sec;            // phone local time at millis() == atMs
+  uint16_t ms;
+  unsigned long atMs;
+  uint16_t errMs;          // half width of the offset interval
+  uint8_t samples;
+  uint16_t rttMinMs, rttMaxMs;
+  unsigned long readyMs;   // connect -> result
+};
+
+// Reads the connected phone's Bluetooth Current Time Service (0x1805, iOS
+// exposes it; most Android phones do not) as a GATT client on the existing
+// link, once per connection. Runs in its own task, since discovery and reads
+// block for a few hundred ms; loop() collects the result with take().
+// Offset estimate, NTP style: a read sent at s and answered at r, returning
+// phone time T truncated to the resolution q (1/256 s, or 1 s when the phone
+// leaves Fractions256 at 0), bounds phone - millis() to [T - r, T + q - s].
+// Intersecting SAMPLES of these intervals, spread over a bit more than a
+// second, removes most of the link latency and catches the phone's second
+// rollover even when it only reports whole seconds.
+class CurrentTimeClient {
+public:
+  static const uint8_t SAMPLES = 8;
+  static const uint16_t SPACING_MS = 150;
+  // iOS only answers on an encrypted link; pairing / key resume runs first
+  static const unsigned long ENCRYPT_WAIT_MS = 5000;
+
+  void begin(BLEBackend& backend);
+  void setEnabled(bool on) { enabled = on; }
+  bool isEnabled() const { return enabled; }
+  // BT task, on connect: start an attempt on this link
+  void onConnect();
+  // True once per finished attempt
+  bool take(PeerTime& out);
+  void print(Print& out);
+
+private:
+  enum : uint8_t { IDLE, RUNNING, DONE };
+  BLEBackend* backend = nullptr;
+  TaskHandle_t task = nullptr;
+  volatile uint8_t state = IDLE;
+  volatile bool enabled = true;
+  unsigned long connectMs = 0;
+  BLEBackend::TimeSample samples[SAMPLES];
+  PeerTime result = {};
+  PeerTime last = {};
+  uint32_t attempts = 0, valid = 0, noService = 0, rejected = 0;
+
+  static void taskMain(void* arg);
+  void run();
+  static bool decode(const BLEBackend::TimeSample& s, int64_t& ms, bool& fraction);
+  static bool estimate(const BLEBackend::TimeSample* s, uint8_t n, PeerTime& out);
+};
@@ -0,0 +1,210 @@
+#include "DS3231Driver.h"
+#include "TimeCodec.h"
+
+static uint8_t fromBcd(uint8_t v) { return (uint8_t)((v >> 4) * 10 + (v & 0x0F)); }
+static uint8_t toBcd(uint8_t v) { return (uint8_t)(((v / 10) << 4) | (v % 10)); }
+
+bool DS3231Driver::begin(int sda, int scl) {
+  Wire.begin(sda, scl, BUS_HZ);
+  if (!task) {
+    xTaskCreatePinnedToCore(taskMain, "ds3231", 3072, this, 2, &task, 1);
+  }
+  uint8_t v;
+  return readReg(0x0F, v);
+}
+
+void DS3231Driver::taskMain(void* arg) {
+  DS3231Driver* self = static_cast<DS3231Driver*>(arg);
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    self->run();
+  }
+}
+
+void DS3231Driver::run() {
+  Ds3231Sample s = {};
+  if (job != DS_JOB_READ && jobAtMs) {
+    long wait = (long)(jobAtMs - millis());
+    if (wait > 1) vTaskDelay(pdMS_TO_TICKS(wait - 1));
+    while ((long)(jobAtMs - millis()) > 0) {
+      // rest of the last tick
+    }
+  }
+  if (job == DS_JOB_SET) {
+    s.ok = setTime(jobTime);
+  } else if (job == DS_JOB_ALARM) {
+    s.ok = setAlarm1(jobTime);
+  } else if (job == DS_JOB_AGING) {
+    s.ok = setAging((int8_t)(uint8_t)jobTime);
+  } else if (job == DS_JOB_READ) {
+    burstRead(s);
+  } else {
+    // Edge: poll the seconds register every ms; the tick happened between
+    // the last poll that saw the old value and the first one with the new
+    uint8_t first, sec;
+    unsigned long start = millis(), prev = start;
+    bool ok = readSeconds(first);
+    while (ok) {
+      vTaskDelay(1);
+      unsigned long at = millis();
+      ok = readSeconds(sec);
+      edgePolls++;
+      if (ok && sec != first) {
+        s.edgeMs = at - (at - prev) / 2;
+        if (at - start > edgeWaitMsMax) edgeWaitMsMax = at - start;
+        break;
+      }
+      if (at - start > EDGE_TIMEOUT_MS) {
+        // no tick: oscillator stopped
+        edgeTimeouts++;
+        ok = false;
+      }
+      prev = at;
+    }
+    if (ok) burstRead(s);
+  }
+  result = s;
+  state = DONE;
+}
+
+bool DS3231Driver::start(Ds3231Job j, uint32_t setTime, unsigned long atMs) {
+  if (state != IDLE || !task) return false;
+  job = j;
+  jobTime = setTime;
+  jobAtMs = atMs;
+  state = RUNNING;
+  xTaskNotifyGive(task);
+  return true;
+}
+
+bool DS3231Driver::collect(Ds3231Sample& s) {
+  if (state != DONE) return false;
+  s = result;
+  state = IDLE;
+  return true;
+}
+
+bool DS3231Driver::read(Ds3231Sample& s) {
+  s = Ds3231Sample{};
+  return burstRead(s);
+}
+
+bool DS3231Driver::readReg(uint8_t reg, uint8_t& v) {
+  return readRegs(reg, &v, 1, pollStat);
+}
+
+bool DS3231Driver::writeReg(uint8_t reg, uint8_t v) {
+  return writeRegs(reg, &v, 1);
+}
+
+bool DS3231Driver::burstRead(Ds3231Sample& s) {
+  uint8_t r[BURST_LEN];
+  s.ok = readRegs(0x00, r, BURST_LEN, burstStat);
+  if (!s.ok) return false;
+  s.status = r[0x0F];
+  s.aging = (int8_t)r[0x10];
+  s.tempQ = (int16_t)((int8_t)r[0x11] * 4 + (r[0x12] >> 6));
+  uint8_t hour = (r[2] & 0x40) ? (uint8_t)(fromBcd(r[2] & 0x1F) % 12 + ((r[2] & 0x20) ? 12 : 0))
+                               : fromBcd(r[2] & 0x3F);
+  CivilTime c = {};
+  c.year = (uint16_t)(2000 + fromBcd(r[6]) + ((r[5] & 0x80) ? 100 : 0));
+  c.month = fromBcd(r[5] & 0x1F);
+  c.day = fromBcd(r[4] & 0x3F);
+  c.hour = hour;
+  c.minute = fromBcd(r[1] & 0x7F);
+  c.second = fromBcd(r[0] & 0x7F);
+  bool valid = c.month >= 1 && c.month <= 12 && c.day >= 1 && c.day <= TimeCodec::daysInMonth(c.year, c.month) &&
+               c.hour < 24 && c.minute < 60 && c.second < 60;
+  s.time = valid ? TimeCodec::fromCivil(c) : 0;
+  return true;
+}
+
+bool DS3231Driver::readSeconds(uint8_t& v) {
+  return readRegs(0x00, &v, 1, pollStat);
+}
+
+bool DS3231Driver::setTime(uint32_t t) {
+  CivilTime c = TimeCodec::toCivil(t);
+  uint8_t r[7];
+  r[0] = toBcd(c.second);
+  r[1] = toBcd(c.minute);
+  r[2] = toBcd(c.hour);                              // 24 h mode
+  r[3] = (uint8_t)(c.weekday ? c.weekday : 7);        // 1 = Monday .. 7 = Sunday
+  r[4] = toBcd(c.day);
+  r[5] = (uint8_t)(toBcd(c.month) | (c.year >= 2100 ? 0x80 : 0));
+  r[6] = toBcd((uint8_t)(c.year % 100));
+  if (!writeRegs(0x00, r, sizeof(r))) return false;
+  uint8_t st;
+  if (!readReg(0x0F, st)) return false;
+  return !(st & 0x80) || writeReg(0x0F, (uint8_t)(st & ~0x80));
+}
+
+// Alarm 1 on date + hour + minute + second (A1M1-A1M4 = 0, DY/DT = 0): INT/SQW
+// goes low at t and stays low until A1F is cleared. Only the day of the month
+// is compared, so t must lie less than a month ahead.
+bool DS3231Driver::setAlarm1(uint32_t t) {
+  uint8_t ctrl, st;
+  if (!readReg(0x0E, ctrl) || !readReg(0x0F, st)) return false;
+  if (t) {
+    CivilTime c = TimeCodec::toCivil(t);
+    uint8_t r[4] = {toBcd(c.second), toBcd(c.minute), toBcd(c.hour), toBcd(c.day)};
+    if (!writeRegs(0x07, r, sizeof(r))) return false;
+    ctrl |= 0x05;                         // INTCN + A1IE
+  } else {
+    ctrl = (uint8_t)((ctrl | 0x04) & ~0x01);
+  }
+  return writeReg(0x0F, (uint8_t)(st & ~0x01)) && writeReg(0x0E, ctrl);
+}
+
+// Aging applies from the next temperature conversion (every 64 s); start one
+// now unless the chip is already converting (BSY)
+bool DS3231Driver::setAging(int8_t v) {
+  uint8_t ctrl, st;
+  if (!writeReg(0x10, (uint8_t)v)) return false;
+  if (!readReg(0x0E, ctrl) || !readReg(0x0F, st)) return false;
+  return (st & 0x04) || writeReg(0x0E, (uint8_t)(ctrl | 0x20));
+}
+
+bool DS3231Driver::readRegs(uint8_t reg, uint8_t* buf, uint8_t n, Stat& st) {
+  unsigned long t0 = micros();
+  Wire.beginTransmission(ADDR);
+  Wire.write(reg);
+  bool ok = Wire.endTransmission(false) == 0 && Wire.requestFrom(ADDR, n) == n;
+  if (ok) {
+    for (uint8_t i = 0; i < n; i++) buf[i] = (uint8_t)Wire.read();
+  }
+  account(st, micros() - t0, ok);
+  return ok;
+}
+
+bool DS3231Driver::writeRegs(uint8_t reg, const uint8_t* buf, uint8_t n) {
+  unsigned long t0 = micros();
+  Wire.beginTransmission(ADDR);
+  Wire.write(reg);
+  Wire.write(buf, n);
+  bool ok = Wire.endTransmission() == 0;
+  account(writeStat, micros() - t0, ok);
+  return ok;
+}
+
+void DS3231Driver::account(Stat& st, unsigned long us, bool ok) {
+  st.count++;
+  if (!ok) st.errors++;
+  st.lastUs = us;
+  st.totalUs += us;
+  if (us > st.maxUs) st.maxUs = us;
+}
+
+void DS3231Driver::printStats(Print& out) {
+  static const char* const NAMES[3] = {"burst", "poll", "write"};
+  Stat* stats[3] = {&burstStat, &pollStat, &writeStat};
+  out.printf("DS3231 @ %lu kHz, I2C task %s\n", (unsigned long)(BUS_HZ / 1000), state == IDLE ? "idle" : "busy");
+  for (uint8_t i = 0; i < 3; i++) {
+    const Stat& st = *stats[i];
+    out.printf("  %-5s n=%lu err=%lu last=%lu us avg=%lu us max=%lu us\n", NAMES[i], (unsigned long)st.count,
+               (unsigned long)st.errors, (unsigned long)st.lastUs,
+               (unsigned long)(st.count ? st.totalUs / st.count : 0), (unsigned long)st.maxUs);
+  }
+  out.printf("  edge polls=%lu timeouts=%lu longest wait=%lu ms\n", (unsigned long)edgePolls,
+             (unsigned long)edgeTimeouts, (unsigned long)edgeWaitMsMax);
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <Arduino.h>
+#include <Wire.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// One burst read of registers 0x00-0x12: time, control/status, aging, temperature
+struct Ds3231Sample {
+  uint32_t time;         // local Unix seconds, 0 if the time registers are not a valid date
+  uint8_t status;        // 0x0F (bit7 OSF = oscillator stopped / lost power, bit2 BSY)
+  int8_t aging;          // 0x10
+  int16_t tempQ;         // 0x11/0x12, 0.25 C
+  unsigned long edgeMs;  // DS_JOB_EDGE: millis() at which `time` began
+  bool ok;               // transaction completed
+};
+
+enum Ds3231Job : uint8_t {
+  DS_JOB_READ,   // burst read
+  DS_JOB_EDGE,   // from a given millis(), poll the seconds register until it ticks, then burst read
+  DS_JOB_SET,    // at a given millis(), write the time registers (restarts the divider) and clear OSF
+  DS_JOB_ALARM,  // program alarm 1 for a given time (0 = off) and clear its flag A1F
+  DS_JOB_AGING,  // write the aging offset and start a temperature conversion so it applies
+};
+
+// DS3231 on Wire at 400 kHz without RTClib. All registers the firmware needs
+// come from one 19-byte burst (0x00-0x12) instead of separate now()/
+// lostPower()/temperature transactions.
+// Tick path is asynchronous: start() hands a job to a small I2C task (core 1,
+// above loop()), collect() picks the result up on a later tick, so bus time
+// never sits inside TickModules. The blocking calls (read/readReg/writeReg)
+// are for begin() only: every read-modify-write of the control registers
+// (alarm, aging/conversion) is a job, so two of them never interleave on the
+// bus, and after boot the metrics have one writer.
+// Each transaction is timed (micros) for `rtcstat`.
+class DS3231Driver {
+public:
+  static const uint8_t ADDR = 0x68;
+  static const uint32_t BUS_HZ = 400000;
+  static const uint8_t BURST_LEN = 0x13;
+  static const unsigned long EDGE_TIMEOUT_MS = 1500;
+
+  bool begin(int sda, int scl);
+
+  // Blocking
+  bool read(Ds3231Sample& s);
+  bool readReg(uint8_t reg, uint8_t& v);
+  bool writeReg(uint8_t reg, uint8_t v);
+
+  // Asynchronous: false while a job is still running. DS_JOB_SET writes
+  // setTime when millis() reaches atMs (the task sleeps until then, so the
+  // write is not tied to the loop tick); DS_JOB_EDGE starts polling at atMs
+  // (0 = now), just before the expected tick. DS_JOB_ALARM takes the alarm
+  // time in setTime, DS_JOB_AGING the offset as (uint8_t)int8_t.
+  bool start(Ds3231Job job, uint32_t setTime = 0, unsigned long atMs = 0);
+  bool busy() const { return state != IDLE; }
+  // True once per finished job; s is filled for READ/EDGE (SET/ALARM/AGING: s.ok only)
+  bool collect(Ds3231Sample& s);
+
+  void printStats(Print& out);
+
+private:
+  enum : uint8_t { IDLE, RUNNING, DONE };
+  TaskHandle_t task = nullptr;
+  volatile uint8_t state = IDLE;
+  Ds3231Job job = DS_JOB_READ;
+  uint32_t jobTime = 0;
+  unsigned long jobAtMs = 0;
+  Ds3231Sample result = {};
+
+  // Transaction metrics (written by whichever side ran the transaction)
+  struct Stat {
+    volatile uint32_t count, errors, lastUs, maxUs;
+    volatile uint64_t totalUs;
+  };
+  Stat burstStat = {}, pollStat = {}, writeStat = {};
+  volatile uint32_t edgePolls = 0, edgeTimeouts = 0, edgeWaitMsMax = 0;
+
+  static void taskMain(void* arg);
+  void run();
+  bool burstRead(Ds3231Sample& s);
+  bool readSeconds(uint8_t& v);
+  bool setTime(uint32_t t);
+  bool setAlarm1(uint32_t t);
+  bool setAging(int8_t v);
+  bool readRegs(uint8_t reg, uint8_t* buf, uint8_t n, Stat& st);
+  bool writeRegs(uint8_t reg, const uint8_t* buf, uint8_t n);
+  static void account(Stat& st, unsigned long us, bool ok);
+};
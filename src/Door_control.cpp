@@ -1,50 +1,46 @@
 #include "Door_control.h"
 #include "pin_config.h"
 #include "BLEModule.h"
+#include "OutputArbiter.h"
+#include "PatternPlayer.h"
 #include <Arduino.h>
 
 extern BLEModule ble;
+extern OutputArbiter outputs;
+extern PatternPlayer patterns;
 
 DoorControl::DoorControl()
-  : locked(false), pulseActive(false), pulsePin(-1), pulseEnd(0), pesawatOn(false), pesawatStateHigh(false), pesawatNextToggle(0), hazardActive(false), hazardLockedMode(false), hazardStep(0), hazardNext(0), hazardAlarmMode(false), alarmOn(false), alarmStateHigh(false), alarmNextToggle(0) {}
+  : locked(false), pulseActive(false), pulseOut(OUT_COUNT), alarmOn(false) {}
 
 void DoorControl::begin() {
-  pinMode(PIN_LOCK, OUTPUT);
-  pinMode(PIN_UNLOCK, OUTPUT);
-  pinMode(PIN_HAZZARD, OUTPUT);
-  pinMode(PIN_PESAWAT, OUTPUT);
-  digitalWrite(PIN_LOCK, LOW);
-  digitalWrite(PIN_UNLOCK, LOW);
-  digitalWrite(PIN_HAZZARD, LOW);
-  digitalWrite(PIN_PESAWAT, LOW);
+  // Output pins are configured by OutputArbiter::begin()
 }
 
 void DoorControl::lockPulse() {
   if (locked || pulseActive) {
-    ble.notify(std::string("IGNORED LOCK"));
+    ble.notify("IGNORED LOCK");
     Serial.println("Ignored LOCK (already locked or busy)");
   } else {
-    digitalWrite(PIN_UNLOCK, LOW);
-    digitalWrite(PIN_LOCK, HIGH);
+    outputs.release(OUT_UNLOCK, SRC_DOOR);
+    // 600 ms solenoid pulse, ended by the OutputArbiter pulse timer
+    outputs.pulse(OUT_LOCK, SRC_DOOR, 600);
     pulseActive = true;
-    pulsePin = PIN_LOCK;
-    pulseEnd = millis() + 600;
-    ble.notify(std::string("LOCK"));
+    pulseOut = OUT_LOCK;
+    ble.notify("LOCK");
     Serial.println("Action: LOCK started (600ms pulse)");
   }
 }
 
 void DoorControl::unlockPulse() {
   if (!locked || pulseActive) {
-    ble.notify(std::string("IGNORED UNLOCK"));
+    ble.notify("IGNORED UNLOCK");
     Serial.println("Ignored UNLOCK (already unlocked or busy)");
   } else {
-    digitalWrite(PIN_LOCK, LOW);
-    digitalWrite(PIN_UNLOCK, HIGH);
+    outputs.release(OUT_LOCK, SRC_DOOR);
+    outputs.pulse(OUT_UNLOCK, SRC_DOOR, 600);
     pulseActive = true;
-    pulsePin = PIN_UNLOCK;
-    pulseEnd = millis() + 600;
-    ble.notify(std::string("UNLOCK"));
+    pulseOut = OUT_UNLOCK;
+    ble.notify("UNLOCK");
     Serial.println("Action: UNLOCK started (600ms pulse)");
   }
 }
@@ -56,155 +52,70 @@ void DoorControl::toggleAlarm() {
 void DoorControl::setAlarm(bool on) {
   alarmOn = on;
   if (on) {
-    hazardAlarmMode = true;
-    hazardActive = true;
-    hazardStep = 0;
-    hazardNext = millis();
-    ble.notify(std::string("ALARM ON"));
+    patterns.play(OUT_HAZARD, SRC_DOOR, PATTERN_ALARM);
+    patterns.play(OUT_ALARM, SRC_DOOR, PATTERN_ALARM);
+    ble.notify("ALARM ON");
     Serial.println("Action: ALARM ON");
   } else {
-    hazardAlarmMode = false;
-    hazardActive = false;
-    digitalWrite(PIN_HAZZARD, LOW);
-    ble.notify(std::string("ALARM OFF"));
+    patterns.stop(OUT_HAZARD);
+    patterns.stop(OUT_ALARM);
+    ble.notify("ALARM OFF");
     Serial.println("Action: ALARM OFF");
   }
 }
 
+// Hazard confirmation flash; the alarm blink keeps the hazard output while on
+void DoorControl::flashHazard(const Pattern& p) {
+  if (alarmOn) return;
+  patterns.stop(OUT_HAZARD);
+  patterns.play(OUT_HAZARD, SRC_DOOR, p);
+}
+
 void DoorControl::update() {
-  // Complete any active pulse and set locked/unlocked state
-  if (pulseActive && millis() >= pulseEnd) {
-    digitalWrite(pulsePin, LOW);
+  // Pulse ended (pin already off by the timer): set locked/unlocked state
+  if (pulseActive && !outputs.isPulsing(pulseOut)) {
     pulseActive = false;
-    if (pulsePin == PIN_LOCK) {
+    if (pulseOut == OUT_LOCK) {
       locked = true;
       Serial.println("Locked: true");
-      ble.notify(std::string("LOCKED"));
-      hazardActive = false;
-      hazardLockedMode = true;
-      hazardStep = 0;
-      hazardNext = millis();
-      hazardActive = true;
-      pesawatOn = true;
-      pesawatStateHigh = true;
-      digitalWrite(PIN_PESAWAT, HIGH);
-      pesawatNextToggle = millis() + 300;
-    } else if (pulsePin == PIN_UNLOCK) {
+      ble.notify("LOCKED");
+      flashHazard(PATTERN_LOCK_HAZARD);
+      patterns.play(OUT_PESAWAT, SRC_DOOR, PATTERN_PESAWAT);
+    } else if (pulseOut == OUT_UNLOCK) {
       locked = false;
       Serial.println("Locked: false (unlocked)");
-      ble.notify(std::string("UNLOCKED"));
-      hazardActive = false;
-      hazardLockedMode = false;
-      hazardStep = 0;
-      hazardNext = millis();
-      hazardActive = true;
-      pesawatOn = false;
-      pesawatStateHigh = false;
-      digitalWrite(PIN_PESAWAT, LOW);
-    }
-    pulsePin = -1;
-  }
-
-  // Alarm blinking (non-blocking)
-  if (alarmOn && millis() >= alarmNextToggle) {
-    if (alarmStateHigh) {
-      digitalWrite(PIN_ALARM, LOW);
-      alarmStateHigh = false;
-      alarmNextToggle = millis() + 200;
-    } else {
-      digitalWrite(PIN_ALARM, HIGH);
-      alarmStateHigh = true;
-      alarmNextToggle = millis() + 200;
-    }
-  }
-
-  // Pesawat blinking (while pesawatOn)
-  if (pesawatOn && millis() >= pesawatNextToggle) {
-    if (pesawatStateHigh) {
-      digitalWrite(PIN_PESAWAT, LOW);
-      pesawatStateHigh = false;
-      pesawatNextToggle = millis() + 3000;
-    } else {
-      digitalWrite(PIN_PESAWAT, HIGH);
-      pesawatStateHigh = true;
-      pesawatNextToggle = millis() + 100;
-    }
-  }
-
-  // Hazard light control (non-blocking state machine)
-  if (hazardActive && millis() >= hazardNext) {
-    if (hazardAlarmMode) {
-      if (hazardStep == 0) {
-        digitalWrite(PIN_HAZZARD, HIGH);
-        hazardStep = 1;
-        hazardNext = millis() + 200;
-      } else {
-        digitalWrite(PIN_HAZZARD, LOW);
-        hazardStep = 0;
-        hazardNext = millis() + 200;
-      }
-    } else if (hazardLockedMode) {
-      switch (hazardStep) {
-        case 0:
-          digitalWrite(PIN_HAZZARD, HIGH);
-          hazardNext = millis() + 400;
-          hazardStep++;
-          break;
-        case 1:
-          digitalWrite(PIN_HAZZARD, LOW);
-          hazardNext = millis() + 200;
-          hazardStep++;
-          break;
-        case 2:
-          digitalWrite(PIN_HAZZARD, HIGH);
-          hazardNext = millis() + 400;
-          hazardStep++;
-          break;
-        default:
-          digitalWrite(PIN_HAZZARD, LOW);
-          hazardActive = false;
-          break;
-      }
-    } else {
-      if (hazardStep == 0) {
-        digitalWrite(PIN_HAZZARD, HIGH);
-        hazardNext = millis() + 1000;
-        hazardStep++;
-      } else {
-        digitalWrite(PIN_HAZZARD, LOW);
-        hazardActive = false;
-      }
+      ble.notify("UNLOCKED");
+      flashHazard(PATTERN_UNLOCK_HAZARD);
+      patterns.stop(OUT_PESAWAT);
     }
+    pulseOut = OUT_COUNT;
   }
+  // Hazard, alarm and pesawat blinking run in PatternPlayer
 }
 
 void DoorControl::cancelAll() {
   pulseActive = false;
-  pulsePin = -1;
-  hazardActive = false;
-  hazardAlarmMode = false;
   alarmOn = false;
-  digitalWrite(PIN_HAZZARD, LOW);
-  digitalWrite(PIN_PESAWAT, LOW);
+  if (pulseOut != OUT_COUNT) outputs.release(pulseOut, SRC_DOOR);
+  pulseOut = OUT_COUNT;
+  patterns.stop(OUT_ALARM);
+  patterns.stop(OUT_HAZARD);
+  patterns.stop(OUT_PESAWAT);
+}
+
+void DoorControl::restore(bool wasLocked, bool wasAlarmOn) {
+  locked = wasLocked;
+  if (wasAlarmOn) setAlarm(true);
 }
 
 bool DoorControl::isLocked() const { return locked; }
+bool DoorControl::isAlarmOn() const { return alarmOn; }
 
 void DoorControl::setEngineState(bool on) {
-  if (on) {
-    pesawatOn = false;
-    pesawatStateHigh = false;
-    digitalWrite(PIN_PESAWAT, LOW);
+  // Pesawat heartbeat only while locked with the engine off
+  if (!on && locked) {
+    patterns.play(OUT_PESAWAT, SRC_DOOR, PATTERN_PESAWAT);
   } else {
-    if (locked) {
-      pesawatOn = true;
-      pesawatStateHigh = true;
-      digitalWrite(PIN_PESAWAT, HIGH);
-      pesawatNextToggle = millis() + 300;
-    } else {
-      pesawatOn = false;
-      pesawatStateHigh = false;
-      digitalWrite(PIN_PESAWAT, LOW);
-    }
+    patterns.stop(OUT_PESAWAT);
   }
 }
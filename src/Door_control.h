@@ -1,6 +1,8 @@
 #pragma once
 #include <Arduino.h>
 #include <functional>
+#include "OutputArbiter.h"
+#include "Patterns.h"
 
 class DoorControl {
 public:
@@ -13,21 +15,14 @@ public:
   void setAlarm(bool on);
   void setEngineState(bool on);
   void cancelAll();
+  // Warm reset recovery: lock / alarm state without pulsing the solenoids
+  void restore(bool locked, bool alarmOn);
   bool isLocked() const;
+  bool isAlarmOn() const;
 private:
   bool locked;
   bool pulseActive;
-  int pulsePin;
-  unsigned long pulseEnd;
-  bool pesawatOn;
-  bool pesawatStateHigh;
-  unsigned long pesawatNextToggle;
-  bool hazardActive;
-  bool hazardLockedMode;
-  int hazardStep;
-  unsigned long hazardNext;
-  bool hazardAlarmMode;
+  Output pulseOut;
   bool alarmOn;
-  bool alarmStateHigh;
-  unsigned long alarmNextToggle;
+  void flashHazard(const Pattern& p);
 };
@@ -0,0 +1,90 @@
+#include "HeapMonitor.h"
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Arduino core: handle of the task running setup()/loop()
+extern TaskHandle_t loopTaskHandle;
+
+// Shared with the malloc wrappers, which may run in any task
+static volatile bool heapArmed = false;
+static volatile bool heapTrap = false;
+static volatile uint32_t allocsLoop = 0;
+static volatile uint32_t allocsOther = 0;
+static volatile uint32_t bytesAfterSetup = 0;
+static void* volatile lastLoopCaller = nullptr;
+static volatile uint32_t lastLoopSize = 0;
+
+#ifdef STATIC_ALLOC_MODE
+
+static inline void noteAlloc(size_t size, void* caller) {
+  if (!heapArmed) return;
+  __atomic_fetch_add(&bytesAfterSetup, (uint32_t)size, __ATOMIC_RELAXED);
+  if (xTaskGetCurrentTaskHandle() == loopTaskHandle) {
+    __atomic_fetch_add(&allocsLoop, 1, __ATOMIC_RELAXED);
+    lastLoopCaller = caller;
+    lastLoopSize = size;
+    if (heapTrap) abort();
+  } else {
+    __atomic_fetch_add(&allocsOther, 1, __ATOMIC_RELAXED);
+  }
+}
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+  noteAlloc(size, __builtin_return_address(0));
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t n, size_t size) {
+  noteAlloc(n * size, __builtin_return_address(0));
+  return __real_calloc(n, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+  noteAlloc(size, __builtin_return_address(0));
+  return __real_realloc(ptr, size);
+}
+}
+
+#endif // STATIC_ALLOC_MODE
+
+void HeapMonitor::arm() {
+  sample();
+  heapArmed = true;
+}
+
+void HeapMonitor::sample() {
+  uint32_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  uint32_t freeNow = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  if (largest < minLargestBlock) minLargestBlock = largest;
+  if (freeNow < minFree) minFree = freeNow;
+}
+
+void HeapMonitor::setTrap(bool on) {
+  heapTrap = on;
+}
+
+void HeapMonitor::print(Print& out) {
+  sample();
+  out.printf("Heap: free=%lu min_free=%lu (idf %lu) largest=%lu min_largest=%lu\n",
+             (unsigned long)heap_caps_get_free_size(MALLOC_CAP_8BIT),
+             (unsigned long)minFree,
+             (unsigned long)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+             (unsigned long)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT),
+             (unsigned long)minLargestBlock);
+#ifdef STATIC_ALLOC_MODE
+  out.printf("Allocs after setup: loop=%lu other tasks=%lu bytes=%lu trap=%s\n",
+             (unsigned long)allocsLoop, (unsigned long)allocsOther,
+             (unsigned long)bytesAfterSetup, heapTrap ? "on" : "off");
+  if (allocsLoop) {
+    out.printf("Last loop alloc: %lu bytes from %p\n", (unsigned long)lastLoopSize, lastLoopCaller);
+  }
+#else
+  out.println("Allocation counting off (build env esp32doit-devkit-v1-static)");
+#endif
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Heap health for long uptimes: tracks the lowest free heap and the smallest
+// largest-free-block seen (fragmentation), and, when built with
+// STATIC_ALLOC_MODE (malloc/calloc/realloc wrapped at link time, see
+// platformio.ini), counts every allocation made after setup().
+// Allocations from the loop task can optionally abort() so the panic
+// backtrace points at the offending call site.
+class HeapMonitor {
+public:
+  // Call once boot is complete (setup() and the deferred stages): allocations before this are expected
+  void arm();
+  // Call periodically from loop() to refresh the low-water marks
+  void sample();
+  void setTrap(bool on);
+  void print(Print& out);
+
+private:
+  uint32_t minLargestBlock = UINT32_MAX;
+  uint32_t minFree = UINT32_MAX;
+};
@@ -0,0 +1,88 @@
+#include "HotState.h"
+#include <esp_attr.h>
+#include <esp_system.h>
+
+static const uint32_t HOT_MAGIC = 0x484F5431;  // "HOT1"
+
+struct HotSlot {
+  uint32_t magic;
+  uint32_t seq;
+  HotState state;
+  uint32_t sum;   // FNV-1a of the fields above
+};
+
+static RTC_NOINIT_ATTR HotSlot hotSlots[2];
+
+static uint32_t slotSum(const HotSlot& s) {
+  const uint8_t* p = (const uint8_t*)&s;
+  uint32_t h = 2166136261UL;
+  for (size_t i = 0; i < offsetof(HotSlot, sum); i++) {
+    h ^= p[i];
+    h *= 16777619UL;
+  }
+  return h;
+}
+
+static bool slotValid(const HotSlot& s) {
+  return s.magic == HOT_MAGIC && s.sum == slotSum(s);
+}
+
+bool HotStateStore::load(HotState& out) {
+  unsigned long t0 = micros();
+  bool v0 = slotValid(hotSlots[0]), v1 = slotValid(hotSlots[1]);
+  esp_reset_reason_t why = esp_reset_reason();
+  restored = false;
+  if (why == ESP_RST_POWERON) {
+    loadResult = "power-on reset, defaults";
+  } else if (!v0 && !v1) {
+    loadResult = "no valid snapshot, defaults";
+  } else {
+    // Newer valid slot; the sequence continues from it
+    const HotSlot& s = (v0 && (!v1 || (int32_t)(hotSlots[0].seq - hotSlots[1].seq) > 0)) ? hotSlots[0] : hotSlots[1];
+    out = s.state;
+    seq = s.seq;
+    lastSaved = s.state;
+    haveLast = true;
+    restored = true;
+    loadResult = "restored";
+  }
+  loadUs = micros() - t0;
+  return restored;
+}
+
+void HotStateStore::save(const HotState& s) {
+  if (haveLast && memcmp(&s, &lastSaved, sizeof(s)) == 0) return;
+  seq++;
+  HotSlot& slot = hotSlots[seq & 1];
+  slot.magic = 0;
+  slot.seq = seq;
+  slot.state = s;
+  slot.sum = slotSum(HotSlot{HOT_MAGIC, seq, s, 0});
+  slot.magic = HOT_MAGIC;
+  lastSaved = s;
+  haveLast = true;
+  writes++;
+}
+
+static const char* resetName(esp_reset_reason_t r) {
+  switch (r) {
+    case ESP_RST_POWERON:  return "power-on";
+    case ESP_RST_SW:       return "restart";
+    case ESP_RST_PANIC:    return "panic";
+    case ESP_RST_INT_WDT:
+    case ESP_RST_TASK_WDT:
+    case ESP_RST_WDT:      return "watchdog";
+    case ESP_RST_DEEPSLEEP: return "deep sleep";
+    case ESP_RST_BROWNOUT: return "brownout";
+    default:               return "other";
+  }
+}
+
+void HotStateStore::print(Print& out) const {
+  out.printf("Hot state: boot %s (%lu us), reset: %s, %lu writes, seq %lu\n", loadResult,
+             (unsigned long)loadUs, resetName(esp_reset_reason()), (unsigned long)writes, (unsigned long)seq);
+  if (!haveLast) return;
+  out.printf("  locked=%u alarm=%u engine=%u pesawat=%u acc=%u ig=%u warm=%lu s\n", lastSaved.locked,
+             lastSaved.alarmOn, lastSaved.engineOn, lastSaved.pesawat, lastSaved.acc, lastSaved.ig,
+             (unsigned long)lastSaved.warmLeftS);
+}
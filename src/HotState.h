@@ -0,0 +1,40 @@
+#pragma once
+
+#include <Arduino.h>
+
+// State that has to survive a warm reset (brownout, watchdog, panic, restart)
+struct HotState {
+  uint8_t locked;
+  uint8_t alarmOn;
+  uint8_t engineOn;
+  uint8_t pesawat;      // locked indicator blinking
+  uint8_t acc;          // ignition relays holding a running engine
+  uint8_t ig;
+  uint16_t reserved;
+  uint32_t warmLeftS;   // warm-up remaining, 0 = none
+  uint32_t rtcEpoch;    // RTC time while a warm-up runs, 0 = none / not set
+};
+
+// HotState mirrored in RTC slow memory (RTC_NOINIT_ATTR): plain RAM writes,
+// no flash, and the content survives every reset except power-on, so
+// setup() can restore it before touching NVS or BLE.
+// Two slots written alternately, each with a magic, a sequence number and an
+// FNV-1a checksum: a reset in the middle of a write leaves the other slot valid,
+// and the random content after power-up is rejected.
+class HotStateStore {
+public:
+  // At the top of setup(): true with the state from before the reset
+  bool load(HotState& out);
+  // Once per tick: written only when the state changed
+  void save(const HotState& s);
+  void print(Print& out) const;
+
+private:
+  HotState lastSaved = {};
+  bool haveLast = false;
+  uint32_t seq = 0;
+  uint32_t writes = 0;
+  bool restored = false;
+  const char* loadResult = "not loaded";
+  uint32_t loadUs = 0;
+};
@@ -0,0 +1,48 @@
+#include "LedcModulator.h"
+#include "driver/ledc.h"
+
+static const uint8_t WAVE_BITS = 16;
+static const uint8_t PWM_BITS = 10;
+
+int8_t LedcModulator::take() {
+  uint8_t slot = 0;
+  while (slot < SLOTS && (used & (1 << slot))) slot++;
+  if (slot == SLOTS) return NONE;
+  used |= (1 << slot);
+  return (int8_t)(slot * 2);
+}
+
+int8_t LedcModulator::acquireWave(uint32_t periodUs, uint32_t highUs, bool activeHigh) {
+  if (periodUs < WAVE_MIN_US || periodUs > WAVE_MAX_US || highUs >= periodUs) return NONE;
+  int8_t channel = take();
+  if (channel == NONE) return NONE;
+  uint8_t slot = channel / 2;
+  ledc_mode_t mode = (ledc_mode_t)(channel / 8);
+  ledc_timer_t timer = (ledc_timer_t)(slot % 4);
+  // Arduino sets up the channel/timer pair, then the divider is set directly:
+  // period = 2^16 ticks * (div / 256) us at 1 MHz REF_TICK  ->  div = periodUs / 256
+  ledcSetup(channel, 1000, WAVE_BITS);
+  ledc_timer_set(mode, timer, periodUs >> 8, WAVE_BITS, LEDC_REF_TICK);
+  ledc_timer_rst(mode, timer);
+  uint32_t duty = (uint32_t)(((uint64_t)highUs << WAVE_BITS) / periodUs);
+  // Active-low pin: same waveform, phase shifted (inactive part first)
+  ledcWrite(channel, activeHigh ? duty : (1UL << WAVE_BITS) - duty);
+  return channel;
+}
+
+int8_t LedcModulator::acquirePwm(uint32_t freqHz, uint8_t dutyPct, bool activeHigh) {
+  if (dutyPct < 1 || dutyPct > 99) return NONE;
+  int8_t channel = take();
+  if (channel == NONE) return NONE;
+  // APB clock, 10 bit: fine enough for percent steps, up to ~78 kHz
+  ledcSetup(channel, freqHz, PWM_BITS);
+  uint32_t duty = ((uint32_t)dutyPct << PWM_BITS) / 100;
+  ledcWrite(channel, activeHigh ? duty : (1UL << PWM_BITS) - duty);
+  return channel;
+}
+
+void LedcModulator::release(int8_t channel) {
+  if (channel < 0) return;
+  ledcWrite(channel, 0);
+  used &= ~(1 << (channel / 2));
+}
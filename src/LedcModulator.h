@@ -0,0 +1,28 @@
+#pragma once
+#include <Arduino.h>
+
+// LEDC channels lent to outputs so the peripheral produces the ON waveform
+// instead of the CPU (see OutputArbiter::setModulation()). Only the even
+// Arduino channels are used, so every slot has its own LEDC timer.
+// One instance (`ledc` in main.cpp) is shared by PatternPlayer and OutputArbiter.
+class LedcModulator {
+public:
+  static const int8_t NONE = -1;
+  static const uint8_t SLOTS = 8;
+  // Shortest / longest period of a wave (16-bit duty, 1 MHz REF_TICK, 10.8 divider)
+  static const uint32_t WAVE_MIN_US = 65536;
+  static const uint32_t WAVE_MAX_US = 67000000;
+
+  // Periodic wave: active for highUs, then inactive for the rest of periodUs.
+  // Returns the Arduino LEDC channel, or NONE if out of range / no slot free.
+  int8_t acquireWave(uint32_t periodUs, uint32_t highUs, bool activeHigh);
+  // Fixed-frequency PWM, active for dutyPct (1-99) percent of each period
+  // (OutputArbiter hold drive). Returns the channel or NONE.
+  int8_t acquirePwm(uint32_t freqHz, uint8_t dutyPct, bool activeHigh);
+  void release(int8_t channel);
+  uint8_t inUse() const { return __builtin_popcount(used); }
+
+private:
+  uint8_t used = 0;   // bit per slot
+  int8_t take();      // claim a free slot, returns its channel or NONE
+};
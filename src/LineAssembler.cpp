@@ -0,0 +1,37 @@
+#include "LineAssembler.h"
+
+LineAssembler::LineAssembler() : len(0), ready(false), overflowed(false) {
+  buf[0] = '\0';
+}
+
+void LineAssembler::reset() {
+  len = 0;
+  ready = false;
+  overflowed = false;
+  buf[0] = '\0';
+}
+
+LineAssembler::Result LineAssembler::feed(char c) {
+  // previous line has been consumed by the caller
+  if (ready) {
+    len = 0;
+    ready = false;
+  }
+  if (c == '\n') {
+    if (overflowed) {
+      overflowed = false;
+      len = 0;
+      return OVERFLOW;
+    }
+    buf[len] = '\0';
+    ready = true;
+    return LINE;
+  }
+  if (overflowed) return NONE;
+  if (len < CMD_LINE_MAX) {
+    buf[len++] = c;
+  } else {
+    overflowed = true;
+  }
+  return NONE;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stddef.h>
+
+// Longest accepted command line (bytes, without terminator). Override with
+// -DCMD_LINE_MAX=<n> in build_flags.
+#ifndef CMD_LINE_MAX
+#define CMD_LINE_MAX 128
+#endif
+
+// Incremental '\n'-terminated line builder in a fixed buffer. Bytes are fed
+// one at a time as they arrive, so it never waits for the rest of a line.
+// A line longer than CMD_LINE_MAX is dropped as a whole and reported once.
+class LineAssembler {
+public:
+  enum Result { NONE, LINE, OVERFLOW };
+
+  LineAssembler();
+  Result feed(char c);
+  // Valid after feed() returned LINE, until the next feed()
+  char* line() { return buf; }
+  size_t length() const { return len; }
+  void reset();
+
+private:
+  char buf[CMD_LINE_MAX + 1];
+  size_t len;
+  bool ready;
+  bool overflowed;
+};
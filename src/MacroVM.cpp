@@ -0,0 +1,204 @@
+#include "MacroVM.h"
+#include <ctype.h>
+
+static const char MAGIC = 'M';
+
+// Commands a macro may not contain (no macro starting macros)
+static bool forbidden(const char* name) { return strcasecmp(name, "macro") == 0; }
+
+static uint16_t u16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+
+const char* MacroVM::resolve(uint16_t id, int& index) const {
+  index = engine->indexOfId(id);
+  if (index == -1) return "command not in this firmware";
+  if (index < 0) return "command id not unique";
+  if (forbidden(engine->nameAt(index))) return "macro cannot call macro";
+  return nullptr;
+}
+
+const char* MacroVM::compile(const char* text, uint8_t* out, size_t& len) const {
+  if (!engine) return "no command table";
+  out[0] = MAGIC;
+  out[1] = VERSION;
+  len = HEADER;
+  size_t last = 0;            // offset of the previous op, 0 = none
+  const char* p = text;
+  while (*p) {
+    // one op: up to ';' or newline
+    const char* end = p;
+    while (*end && *end != ';' && *end != '\n') end++;
+    const char* w = p;
+    while (w < end && isspace((unsigned char)*w)) w++;
+    const char* e = end;
+    while (e > w && isspace((unsigned char)e[-1])) e--;
+    p = *end ? end + 1 : end;
+    if (w == e) continue;
+
+    const char* a = w;
+    while (a < e && !isspace((unsigned char)*a)) a++;
+    size_t wordLen = a - w;
+    while (a < e && isspace((unsigned char)*a)) a++;
+    size_t argLen = e - a;
+
+    if (wordLen == 4 && strncasecmp(w, "wait", 4) == 0) {
+      long ms = atol(a);
+      if (ms < 1 || ms > 65535) return "wait must be 1-65535 ms";
+      // Fold into the previous op's delay when it fits
+      if (last) {
+        uint32_t d = u16(out + last + 3);
+        if (d + ms <= 65535) {
+          d += ms;
+          out[last + 3] = d & 0xFF;
+          out[last + 4] = d >> 8;
+          continue;
+        }
+      }
+      if (len + OP_HEADER > MAX_BYTES) return "macro too long";
+      last = len;
+      out[len++] = OP_NONE & 0xFF;
+      out[len++] = OP_NONE >> 8;
+      out[len++] = 0;
+      out[len++] = ms & 0xFF;
+      out[len++] = ms >> 8;
+      continue;
+    }
+
+    if (engine->indexOf(w, wordLen) < 0) return "unknown command";
+    uint16_t id = CommandEngine::nameId(w, wordLen);
+    int idx;
+    const char* err = resolve(id, idx);
+    if (err) return err;
+    if (argLen > 255 || len + OP_HEADER + argLen > MAX_BYTES) return "macro too long";
+    last = len;
+    out[len++] = id & 0xFF;
+    out[len++] = id >> 8;
+    out[len++] = (uint8_t)argLen;
+    out[len++] = 0;
+    out[len++] = 0;
+    memcpy(out + len, a, argLen);
+    len += argLen;
+  }
+  if (len == HEADER) return "empty macro";
+  return verify(out, len);
+}
+
+const char* MacroVM::verify(const uint8_t* c, size_t len) const {
+  if (!engine) return "no command table";
+  if (len < HEADER + OP_HEADER || len > MAX_BYTES) return "bad length";
+  if (c[0] != MAGIC) return "bad magic";
+  if (c[1] != VERSION) return "unsupported version, save the macro again";
+  size_t at = HEADER;
+  while (at < len) {
+    if (at + OP_HEADER > len) return "truncated op";
+    uint16_t id = u16(c + at);
+    uint8_t argLen = c[at + 2];
+    if (id == OP_NONE) {
+      if (argLen) return "delay op with argument";
+    } else {
+      int idx;
+      const char* err = resolve(id, idx);
+      if (err) return err;
+    }
+    at += OP_HEADER;
+    if (at + argLen > len) return "truncated argument";
+    for (size_t i = 0; i < argLen; i++) {
+      if (c[at + i] < 0x20 || c[at + i] > 0x7E) return "argument not printable";
+    }
+    at += argLen;
+  }
+  return nullptr;
+}
+
+const char* MacroVM::start(const uint8_t* c, size_t len, uint8_t n) {
+  const char* err = verify(c, len);
+  if (err) {
+    rejected++;
+    return err;
+  }
+  stop();
+  memcpy(code, c, len);
+  codeLen = len;
+  // Ids -> table indices once, the tick only indexes
+  uint8_t ops = 0;
+  for (size_t at = HEADER; at < len; at += OP_HEADER + code[at + 2]) {
+    int idx = 0;
+    uint16_t id = u16(code + at);
+    if (id != OP_NONE) resolve(id, idx);
+    cmds[ops++] = (uint8_t)idx;
+  }
+  op = 0;
+  pc = HEADER;
+  slot = n;
+  wakeAt = millis();
+  runs++;
+  Serial.printf("Macro %u started (%u bytes)\n", slot, (unsigned)len);
+  return nullptr;
+}
+
+void MacroVM::stop() {
+  if (!pc) return;
+  pc = 0;
+  Serial.printf("Macro %u stopped\n", slot);
+}
+
+void MacroVM::update() {
+  if (!pc || (long)(millis() - wakeAt) < 0) return;
+  char arg[256];
+  for (uint8_t n = 0; n < OPS_PER_TICK && pc; n++) {
+    bool delayOnly = u16(code + pc) == OP_NONE;
+    uint8_t cmd = cmds[op++];
+    uint8_t argLen = code[pc + 2];
+    uint16_t delayMs = u16(code + pc + 3);
+    memcpy(arg, code + pc + OP_HEADER, argLen);
+    arg[argLen] = '\0';
+    pc += OP_HEADER + argLen;
+    if (pc >= codeLen) pc = 0;
+    opsRun++;
+    if (!delayOnly) {
+      Serial.printf("Macro %u: %s %s\n", slot, engine->nameAt(cmd), arg);
+      engine->run(cmd, arg, log);
+    }
+    if (!pc) {
+      Serial.printf("Macro %u done\n", slot);
+      return;
+    }
+    if (delayMs) {
+      wakeAt = millis() + delayMs;
+      return;
+    }
+  }
+}
+
+void MacroVM::disasm(const uint8_t* c, size_t len, Print& out) const {
+  if (verify(c, len)) {
+    out.println("  (invalid)");
+    return;
+  }
+  size_t at = HEADER;
+  while (at < len) {
+    uint16_t id = u16(c + at);
+    uint8_t argLen = c[at + 2];
+    uint16_t delayMs = u16(c + at + 3);
+    if (id == OP_NONE) {
+      out.printf("  wait %u\n", delayMs);
+    } else {
+      out.printf("  %s%s%.*s", engine->nameAt(engine->indexOfId(id)), argLen ? " " : "", argLen,
+                 (const char*)c + at + OP_HEADER);
+      if (delayMs) out.printf("; wait %u", delayMs);
+      out.println();
+    }
+    at += OP_HEADER + argLen;
+  }
+}
+
+void MacroVM::print(Print& out) const {
+  if (pc) {
+    long left = (long)(wakeAt - millis());
+    out.printf("Macro %u running, op at %u/%u, next in %ld ms\n", slot, (unsigned)pc, (unsigned)codeLen,
+               left > 0 ? left : 0L);
+  } else {
+    out.println("No macro running");
+  }
+  out.printf("Runs=%lu ops=%lu rejected=%lu\n", (unsigned long)runs, (unsigned long)opsRun,
+             (unsigned long)rejected);
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <Arduino.h>
+#include "CommandEngine.h"
+#include "Transport.h"
+
+// Stored command macros: a short list of (command, arg, delay) ops executed
+// on the control tick, so a sequence like "lamp_on; wait 2000; lock;
+// alarm_on" needs one BLE write and keeps running if the phone disconnects.
+//
+// Bytecode (little endian):
+//   header  'M', version
+//   op      cmd (u16: CommandEngine::nameId, OP_NONE = delay only),
+//           argLen (u8), delay after the command in ms (u16), arg bytes
+// Commands are referred to by name id, resolved to table indices when the
+// macro starts: a firmware that adds or reorders commands still runs it,
+// only a macro using a command that is gone fails verification.
+class MacroVM {
+public:
+  static const uint8_t VERSION = 2;
+  static const uint16_t OP_NONE = 0;
+  static const size_t MAX_BYTES = 128;
+  static const size_t HEADER = 2;
+  static const size_t OP_HEADER = 5;
+  static const size_t MAX_OPS = (MAX_BYTES - HEADER) / OP_HEADER;
+  // Ops run back to back in one tick before the VM yields
+  static const uint8_t OPS_PER_TICK = 4;
+
+  void begin(const CommandEngine& engine) { this->engine = &engine; }
+  // Text form -> bytecode. Ops separated by ';' or newline: "<command> [arg]"
+  // or "wait <ms>". Returns nullptr or an error message.
+  const char* compile(const char* text, uint8_t* out, size_t& len) const;
+  // Structural check of stored/uploaded bytecode; nullptr = ok
+  const char* verify(const uint8_t* code, size_t len) const;
+  // Verify and start code (copied); a running macro is stopped first
+  const char* start(const uint8_t* code, size_t len, uint8_t slot);
+  void stop();
+  bool running() const { return pc != 0; }
+  void update();
+  // One op per line: "+<delay>ms <command> <arg>"
+  void disasm(const uint8_t* code, size_t len, Print& out) const;
+  void print(Print& out) const;
+
+private:
+  // Replies of macro steps go to the log, not to the (maybe gone) phone
+  class LogTransport : public Transport {
+  public:
+    const char* name() const override { return "macro"; }
+    void poll(CommandEngine&) override {}
+    size_t write(uint8_t c) override { return Serial.write(c); }
+  };
+
+  const CommandEngine* engine = nullptr;
+  LogTransport log;
+  uint8_t code[MAX_BYTES];
+  size_t codeLen = 0;
+  size_t pc = 0;              // offset of the next op, 0 = idle
+  uint8_t cmds[MAX_OPS];      // table index per op, resolved by start()
+  uint8_t op = 0;             // number of the next op
+  uint8_t slot = 0;
+  unsigned long wakeAt = 0;
+  uint32_t opsRun = 0;
+  uint32_t runs = 0;
+  uint32_t rejected = 0;
+
+  // Table index of a command op's id, nullptr = ok
+  const char* resolve(uint16_t id, int& index) const;
+};
@@ -0,0 +1,9 @@
+#pragma once
+
+// Compile-time update list: ModuleList<a, b, c>::update() expands to
+// a.update(); b.update(); c.update(); in declaration order, so the tick
+// has no table of pointers and each module call can be inlined.
+template <auto&... Modules>
+struct ModuleList {
+  static void update() { (Modules.update(), ...); }
+};
@@ -0,0 +1,318 @@
+#include "OutputArbiter.h"
+#include "soc/gpio_struct.h"
+#include "LedcModulator.h"
+#include "rom/gpio.h"
+#include "soc/gpio_sig_map.h"
+
+extern LedcModulator ledc;
+
+static const unsigned long MAX_CRANK_MS_DEFAULT = 3000;
+// Hold PWM frequency: above audible range for relay/solenoid coils
+static const uint32_t HOLD_PWM_HZ = 20000;
+
+OutputArbiter::OutputArbiter()
+  : shadow(0), pendingSet{0, 0}, pendingClr{0, 0}, holdNoSlot(0), holdStarts(0), holdFallbacks(0),
+    routed(0), routeDirty(0), commits(0), commitCycles(0), commitCyclesMax(0), maxCrankMs(MAX_CRANK_MS_DEFAULT),
+    starterSince(0), interlockBlocks(0), crankCutoffs(0), trace(false), pulseArm(0), expired(0),
+    pulseHist{0}, pulseErrMaxUs(0) {
+  for (uint8_t i = 0; i < OUT_COUNT; i++) {
+    ch[i] = Channel{0, 0, SRC_COUNT, 0, 0, 0, 0, 0};
+    mod[i] = LedcModulator::NONE;
+    hold[i] = Hold{0, 0, LedcModulator::NONE};
+    timers[i] = PulseTimer{this, i, nullptr, 0};
+  }
+}
+
+void OutputArbiter::begin() {
+  shadow = 0;
+  pendingSet[0] = pendingClr[0] = pendingSet[1] = pendingClr[1] = 0;
+  for (uint8_t i = 0; i < OUT_COUNT; i++) {
+    if (timers[i].handle) continue;
+    esp_timer_create_args_t args = {};
+    args.callback = onPulseTimer;
+    args.arg = &timers[i];
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = BOARD.out[i].name;
+    esp_timer_create(&args, &timers[i].handle);
+  }
+}
+
+// esp_timer task: end the pulse at the pin right now, loop() catches up later
+void OutputArbiter::onPulseTimer(void* arg) {
+  PulseTimer* t = (PulseTimer*)arg;
+  const BoardPin& pin = BOARD.out[t->out];
+  uint32_t bit = gpioBit(pin.gpio);
+  // Idle level into the register first, then take the pin back from LEDC if needed
+  if (gpioBank(pin.gpio)) {
+    if (pin.activeHigh) GPIO.out1_w1tc.val = bit; else GPIO.out1_w1ts.val = bit;
+  } else {
+    if (pin.activeHigh) GPIO.out_w1tc = bit; else GPIO.out_w1ts = bit;
+  }
+  if (t->owner->routed & (1 << t->out)) gpio_matrix_out(pin.gpio, SIG_GPIO_OUT_IDX, false, false);
+  t->offAt = esp_timer_get_time();
+  __atomic_fetch_or(&t->owner->expired, 1UL << t->out, __ATOMIC_SEQ_CST);
+}
+
+void OutputArbiter::commit() {
+  // Registers first, so a pin leaving LEDC lands on its new GPIO level
+  commitRegisters();
+  if (routeDirty) {
+    uint16_t dirty = routeDirty;
+    routeDirty = 0;
+    for (uint8_t i = 0; i < OUT_COUNT; i++) {
+      if (!(dirty & (1 << i))) continue;
+      bool wantLedc = isOn((Output)i) && drive(i) != LedcModulator::NONE;
+      if (wantLedc) {
+        ledcAttachPin(BOARD.out[i].gpio, drive(i));
+        routed |= (1 << i);
+      } else if (routed & (1 << i)) {
+        ledcDetachPin(BOARD.out[i].gpio);
+        routed &= ~(1 << i);
+      }
+      // Hold channel goes back to the pool once the pin no longer uses it
+      Hold& h = hold[i];
+      if (h.ledc != LedcModulator::NONE && (!isOn((Output)i) || mod[i] != LedcModulator::NONE)) {
+        ledc.release(h.ledc);
+        h.ledc = LedcModulator::NONE;
+      }
+    }
+  }
+  // Start pulse timers at the committed ON edge
+  if (pulseArm) {
+    uint16_t arm = pulseArm;
+    pulseArm = 0;
+    for (uint8_t i = 0; i < OUT_COUNT; i++) {
+      if (!(arm & (1 << i)) || ch[i].pulseSrc == SRC_COUNT) continue;
+      ch[i].pulseOnAt = esp_timer_get_time();
+      esp_timer_start_once(timers[i].handle, ch[i].pulseUs);
+    }
+  }
+}
+
+void OutputArbiter::setModulation(Output out, int8_t ledcChannel) {
+  mod[out] = ledcChannel;
+  routeDirty |= (1 << out);
+}
+
+void OutputArbiter::setHold(Output out, uint16_t pullInMs, uint8_t dutyPct) {
+  hold[out].pullInMs = pullInMs;
+  hold[out].dutyPct = dutyPct >= 100 ? 0 : dutyPct;
+}
+
+// Pull-in time over: switch ON outputs with hold drive to their PWM channel
+void OutputArbiter::updateHold(unsigned long now) {
+  for (uint8_t i = 0; i < OUT_COUNT; i++) {
+    Hold& h = hold[i];
+    uint16_t bit = 1 << i;
+    if (!h.dutyPct || !isOn((Output)i) || h.ledc != LedcModulator::NONE ||
+        mod[i] != LedcModulator::NONE || (holdNoSlot & bit)) continue;
+    if (now - ch[i].lastChange < h.pullInMs) continue;
+    h.ledc = ledc.acquirePwm(HOLD_PWM_HZ, h.dutyPct, BOARD.out[i].activeHigh);
+    if (h.ledc == LedcModulator::NONE) {
+      // Stay at full drive until the next ON edge
+      holdNoSlot |= bit;
+      holdFallbacks++;
+      continue;
+    }
+    holdStarts++;
+    routeDirty |= bit;
+    if (trace) Serial.printf("[%lu] OUT %s HOLD %u%%\n", now, BOARD.out[i].name, h.dutyPct);
+  }
+}
+
+void OutputArbiter::commitRegisters() {
+  if (!(pendingSet[0] | pendingClr[0] | pendingSet[1] | pendingClr[1])) return;
+  uint32_t c0 = ESP.getCycleCount();
+  if (pendingSet[0]) GPIO.out_w1ts = pendingSet[0];
+  if (pendingClr[0]) GPIO.out_w1tc = pendingClr[0];
+  if (pendingSet[1]) GPIO.out1_w1ts.val = pendingSet[1];
+  if (pendingClr[1]) GPIO.out1_w1tc.val = pendingClr[1];
+  pendingSet[0] = pendingClr[0] = pendingSet[1] = pendingClr[1] = 0;
+  commitCycles = ESP.getCycleCount() - c0;
+  if (commitCycles > commitCyclesMax) commitCyclesMax = commitCycles;
+  commits++;
+}
+
+void OutputArbiter::update() {
+  unsigned long now = millis();
+  uint32_t done = __atomic_exchange_n(&expired, 0, __ATOMIC_SEQ_CST);
+  for (uint8_t i = 0; done && i < OUT_COUNT; i++) {
+    if (done & (1UL << i)) finishPulse((Output)i);
+  }
+  // Max crank time: drop every starter claim, whoever holds it
+  if (isOn(OUT_STARTER) && now - starterSince > maxCrankMs) {
+    crankCutoffs++;
+    Serial.printf("Interlock: STARTER cut after %lu ms (max crank)\n", now - starterSince);
+    clear(OUT_STARTER);
+  }
+  updateHold(now);
+}
+
+void OutputArbiter::request(Output out, OutputSource src, bool on) {
+  Channel& c = ch[out];
+  c.claimMask |= (1 << src);
+  if (on) c.levelMask |= (1 << src);
+  else c.levelMask &= ~(1 << src);
+  apply(out);
+}
+
+void OutputArbiter::release(Output out, OutputSource src) {
+  Channel& c = ch[out];
+  c.claimMask &= ~(1 << src);
+  c.levelMask &= ~(1 << src);
+  if (c.pulseSrc == src) cancelPulse(out);
+  apply(out);
+}
+
+bool OutputArbiter::pulse(Output out, OutputSource src, unsigned long ms) {
+  if (!allowed(out)) {
+    interlockBlocks++;
+    return false;
+  }
+  cancelPulse(out);
+  request(out, src, true);
+  ch[out].pulseSrc = src;
+  ch[out].pulseUs = ms * 1000UL;
+  pulseArm |= (1 << out);
+  return true;
+}
+
+void OutputArbiter::cancelPulse(Output out) {
+  if (ch[out].pulseSrc == SRC_COUNT) return;
+  esp_timer_stop(timers[out].handle);
+  // The timer may have ended it already this tick (pin idle, shadow still ON):
+  // catch up now, or apply() skips the next ON edge and the next update()
+  // would drop a new pulse's claim as if it were this one
+  uint32_t bit = 1UL << out;
+  if (__atomic_fetch_and(&expired, ~bit, __ATOMIC_SEQ_CST) & bit) finishPulse(out);
+  ch[out].pulseSrc = SRC_COUNT;
+  pulseArm &= ~(1 << out);
+}
+
+// The timer already put the pin to idle: sync shadow/routing, drop the
+// pulse claim and re-resolve (another claim may still want it ON)
+void OutputArbiter::finishPulse(Output out) {
+  Channel& c = ch[out];
+  uint16_t bit = 1 << out;
+  shadow &= ~bit;
+  routed &= ~bit;
+  if (drive(out) != LedcModulator::NONE) routeDirty |= bit;
+  holdNoSlot &= ~bit;
+  c.writes++;
+  c.lastChange = millis();
+  if (out == OUT_STARTER) starterSince = c.lastChange;
+
+  int64_t width = timers[out].offAt - c.pulseOnAt;
+  uint32_t err = (uint32_t)(width > c.pulseUs ? width - c.pulseUs : c.pulseUs - width);
+  static const uint32_t LIMITS[PULSE_BUCKETS - 1] = {50, 100, 250, 500, 1000};
+  uint8_t b = 0;
+  while (b < PULSE_BUCKETS - 1 && err >= LIMITS[b]) b++;
+  pulseHist[b]++;
+  if (err > pulseErrMaxUs) pulseErrMaxUs = err;
+  if (trace) {
+    Serial.printf("[%lu] OUT %s OFF (pulse %ld us, want %lu us)\n", c.lastChange, BOARD.out[out].name,
+                  (long)width, (unsigned long)c.pulseUs);
+  }
+
+  if (c.pulseSrc != SRC_COUNT) {
+    c.claimMask &= ~(1 << c.pulseSrc);
+    c.levelMask &= ~(1 << c.pulseSrc);
+    c.pulseSrc = SRC_COUNT;
+  }
+  apply(out);
+}
+
+void OutputArbiter::clear(Output out) {
+  Channel& c = ch[out];
+  c.claimMask = 0;
+  c.levelMask = 0;
+  cancelPulse(out);
+  apply(out);
+}
+
+bool OutputArbiter::wanted(Output out) const {
+  uint8_t claims = ch[out].claimMask;
+  if (!claims) return false;
+  uint8_t top = 7 - __builtin_clz((unsigned)claims << 24);
+  return (ch[out].levelMask >> top) & 1;
+}
+
+bool OutputArbiter::allowed(Output out) const {
+  switch (out) {
+    case OUT_STARTER: return isOn(OUT_IG);
+    case OUT_UNLOCK:  return !isOn(OUT_LOCK);
+    default:          return true;
+  }
+}
+
+void OutputArbiter::apply(Output out) {
+  Channel& c = ch[out];
+  bool on = wanted(out);
+  if (on && !allowed(out)) {
+    // Vetoed claims are dropped so they cannot fire later (e.g. starter when IG comes on)
+    interlockBlocks++;
+    c.claimMask = 0;
+    c.levelMask = 0;
+    cancelPulse(out);
+    on = false;
+  }
+  if (on == isOn(out)) {
+    c.suppressed++;
+    return;
+  }
+  write(out, on);
+  // Outputs other interlocks depend on
+  if (out == OUT_IG) apply(OUT_STARTER);
+  else if (out == OUT_LOCK) apply(OUT_UNLOCK);
+}
+
+void OutputArbiter::write(Output out, bool on) {
+  unsigned long now = millis();
+  const BoardPin& pin = BOARD.out[out];
+  bool high = (on == pin.activeHigh);
+  if (drive(out) != LedcModulator::NONE || (routed & (1 << out))) routeDirty |= (1 << out);
+  holdNoSlot &= ~(1 << out);
+#ifdef OUTPUT_DIRECT_WRITE
+  digitalWrite(pin.gpio, high ? HIGH : LOW);
+#else
+  uint8_t bank = gpioBank(pin.gpio);
+  uint32_t bit = gpioBit(pin.gpio);
+  if (high) {
+    pendingSet[bank] |= bit;
+    pendingClr[bank] &= ~bit;
+  } else {
+    pendingClr[bank] |= bit;
+    pendingSet[bank] &= ~bit;
+  }
+#endif
+  if (on) shadow |= (1 << out);
+  else shadow &= ~(1 << out);
+  if (out == OUT_STARTER && on) starterSince = now;
+  Channel& c = ch[out];
+  c.writes++;
+  c.lastChange = now;
+  if (trace) {
+    Serial.printf("[%lu] OUT %s %s (claims 0x%02x)\n", now, pin.name, on ? "ON" : "OFF", c.claimMask);
+  }
+}
+
+void OutputArbiter::print(Print& out) const {
+  unsigned long now = millis();
+  for (uint8_t i = 0; i < OUT_COUNT; i++) {
+    const Channel& c = ch[i];
+    out.printf("%-9s gpio%-2u %-3s%s claims=0x%02x writes=%lu suppressed=%lu last=%lums ago\n",
+               BOARD.out[i].name, BOARD.out[i].gpio, isOn((Output)i) ? "ON" : "off",
+               (routed & (1 << i)) ? (isHolding((Output)i) ? " (hold)" : " (ledc)") : "", c.claimMask,
+               (unsigned long)c.writes, (unsigned long)c.suppressed,
+               c.writes ? now - c.lastChange : 0UL);
+  }
+  out.printf("Commits: %lu, last=%lu cycles max=%lu cycles\n",
+             (unsigned long)commits, (unsigned long)commitCycles, (unsigned long)commitCyclesMax);
+  out.printf("Pulse width error: <50us=%lu <100us=%lu <250us=%lu <500us=%lu <1ms=%lu >=1ms=%lu max=%luus\n",
+             (unsigned long)pulseHist[0], (unsigned long)pulseHist[1], (unsigned long)pulseHist[2],
+             (unsigned long)pulseHist[3], (unsigned long)pulseHist[4], (unsigned long)pulseHist[5],
+             (unsigned long)pulseErrMaxUs);
+  out.printf("Hold: started=%lu no LEDC slot=%lu\n", (unsigned long)holdStarts, (unsigned long)holdFallbacks);
+  out.printf("Interlock: blocked=%lu crank cutoffs=%lu max crank=%lums\n",
+             (unsigned long)interlockBlocks, (unsigned long)crankCutoffs, maxCrankMs);
+}
@@ -0,0 +1,133 @@
+#pragma once
+#include <Arduino.h>
+#include "pin_config.h"
+#include "esp_timer.h"
+
+// Who asks for an output; higher value = higher priority
+enum OutputSource : uint8_t {
+  SRC_DOOR,      // DoorControl blink/pulse patterns
+  SRC_WARM,      // WarmUpEngine
+  SRC_BUTTON,    // ButtonTombol start sequence / LED
+  SRC_SEQUENCE,  // main.cpp status LEDs
+  SRC_COMMAND,   // direct commands (acc_on, lamp_on, starter_on, ...)
+  SRC_COUNT
+};
+
+// Single owner of all outputs. Modules place ON/OFF claims per source; the
+// highest-priority claim wins (no claim = OFF), interlocks are applied on
+// top, and the pin is only written when the resolved level changes.
+// Levels here are logical (ON = active); the board profile's active level
+// decides the pin level. Interlocks: STARTER only while IG is on, STARTER cut after the max crank
+// time, UNLOCK never together with LOCK.
+// Level changes are staged in set/clear masks and reach the pins in commit(),
+// once per tick: one GPIO.out_w1ts/out_w1tc pair for GPIO0-31 and one
+// out1_w1ts/out1_w1tc pair for GPIO32-39, so outputs switched in the same
+// tick change together. Build with -DOUTPUT_DIRECT_WRITE for the previous
+// digitalWrite()-per-change behaviour (benchmark baseline).
+// A modulated output (setModulation) is routed to its LEDC channel while ON,
+// so the peripheral shapes the ON level (pattern offload).
+// Pulses end on an esp_timer one-shot armed when the ON edge is committed:
+// the timer callback drives the pin to idle itself, so the width does not
+// depend on loop() load; update() then catches up the logical state.
+// Hold drive (setHold): an output is switched ON at full drive and, after its
+// pull-in time, routed to an LEDC PWM channel at the hold duty until it goes
+// OFF (less coil current/heat on long ACC/IG holds). A pattern modulation
+// takes precedence; without a free LEDC slot the output stays at full drive.
+class OutputArbiter {
+public:
+  OutputArbiter();
+  // Creates the pulse timers; pins are configured by boardInitPins()
+  void begin();
+  // Catch up timer-ended pulses, crank-time limit; call every tick
+  void update();
+  // Write the staged changes to the GPIO registers; call at the end of every tick
+  void commit();
+  void request(Output out, OutputSource src, bool on);
+  void release(Output out, OutputSource src);
+  // ON claim that is released after ms (esp_timer, sub-ms accurate).
+  // Returns false if an interlock vetoes it.
+  bool pulse(Output out, OutputSource src, unsigned long ms);
+  bool isPulsing(Output out) const { return ch[out].pulseSrc != SRC_COUNT; }
+  // Drop every claim (forced off, e.g. resetAll)
+  void clear(Output out);
+  // LEDC channel that produces the ON level, LedcModulator::NONE = plain GPIO.
+  // Takes effect at the next commit().
+  void setModulation(Output out, int8_t ledcChannel);
+  // Hold drive for out: full drive for pullInMs, then dutyPct (1-99) PWM.
+  // dutyPct 0 or >= 100 disables it. Takes effect at the next ON edge.
+  void setHold(Output out, uint16_t pullInMs, uint8_t dutyPct);
+  uint16_t holdPullInMs(Output out) const { return hold[out].pullInMs; }
+  uint8_t holdDutyPct(Output out) const { return hold[out].dutyPct; }
+  bool isHolding(Output out) const { return hold[out].ledc != -1; }
+  bool isOn(Output out) const { return (shadow >> out) & 1; }
+  void setMaxCrankMs(unsigned long ms) { maxCrankMs = ms; }
+  unsigned long getMaxCrankMs() const { return maxCrankMs; }
+  // Log every physical write to Serial
+  void setTrace(bool on) { trace = on; }
+  void print(Print& out) const;
+  uint32_t lastCommitCycles() const { return commitCycles; }
+  // Register commits that changed a pin (wake-to-actuation latency)
+  uint32_t commitCount() const { return commits; }
+
+private:
+  struct Channel {
+    uint8_t claimMask;      // bit per OutputSource holding a claim
+    uint8_t levelMask;      // claimed level per OutputSource
+    uint8_t pulseSrc;       // source of the running pulse, SRC_COUNT = none
+    uint32_t pulseUs;       // requested width
+    int64_t pulseOnAt;      // esp_timer time of the committed ON edge
+    unsigned long lastChange;
+    uint32_t writes;
+    uint32_t suppressed;    // requests that did not change the pin
+  };
+  Channel ch[OUT_COUNT];
+  uint16_t shadow;          // last level written per Output
+  uint32_t pendingSet[2];       // staged W1TS per bank (0: GPIO0-31, 1: GPIO32-39)
+  uint32_t pendingClr[2];       // staged W1TC per bank
+  int8_t mod[OUT_COUNT];        // LEDC channel per Output, -1 = none
+  struct Hold {
+    uint16_t pullInMs;
+    uint8_t dutyPct;            // 0 = hold drive off
+    int8_t ledc;                // PWM channel while holding, -1 = full drive
+  };
+  Hold hold[OUT_COUNT];
+  uint16_t holdNoSlot;          // Outputs that found no free LEDC slot this ON period
+  uint32_t holdStarts;
+  uint32_t holdFallbacks;
+  uint16_t routed;              // Outputs currently routed to LEDC
+  uint16_t routeDirty;          // Outputs whose routing must be re-checked in commit()
+  uint32_t commits;
+  uint32_t commitCycles;
+  uint32_t commitCyclesMax;
+  unsigned long maxCrankMs;
+  unsigned long starterSince;
+  uint32_t interlockBlocks;
+  uint32_t crankCutoffs;
+  bool trace;
+
+  struct PulseTimer {
+    OutputArbiter* owner;
+    uint8_t out;
+    esp_timer_handle_t handle;
+    volatile int64_t offAt;     // set by the timer callback
+  };
+  PulseTimer timers[OUT_COUNT];
+  uint16_t pulseArm;            // pulses to start at the next commit()
+  volatile uint32_t expired;    // pulses ended by the timer, not yet seen by update()
+  // |width - requested| histogram: <50us, <100us, <250us, <500us, <1ms, >=1ms
+  static const uint8_t PULSE_BUCKETS = 6;
+  uint32_t pulseHist[PULSE_BUCKETS];
+  uint32_t pulseErrMaxUs;
+
+  // LEDC channel that drives out while ON: pattern first, then hold PWM
+  int8_t drive(uint8_t out) const { return mod[out] != -1 ? mod[out] : hold[out].ledc; }
+  void updateHold(unsigned long now);
+  bool wanted(Output out) const;
+  bool allowed(Output out) const;
+  void apply(Output out);
+  void write(Output out, bool on);
+  void commitRegisters();
+  void cancelPulse(Output out);
+  void finishPulse(Output out);
+  static void onPulseTimer(void* arg);
+};
@@ -0,0 +1,248 @@
+#include "ParkingMode.h"
+#include "BoardPins.h"
+#include <esp_attr.h>
+#include <esp_sleep.h>
+#include <esp_system.h>
+#include <driver/rtc_io.h>
+#include <soc/rtc.h>
+#include <esp32/clk.h>
+#ifdef CONFIG_ESP32_ULP_COPROC_ENABLED
+#include <esp32/ulp.h>
+#endif
+
+static const uint32_t PARK_MAGIC = 0x5041524B;  // "PARK"
+
+// Survives deep sleep (RTC slow memory), not a power-on
+struct ParkRecord {
+  uint32_t magic;
+  uint32_t parkedAt;   // RTC time when parking started, 0 = not set
+  uint32_t parks;      // since the last reset that was not a parking wake
+  uint8_t ulp;         // ULP watch (else ext0/ext1)
+};
+static RTC_NOINIT_ATTR ParkRecord record;
+
+// Datasheet typicals (uA): deep sleep with the ULP sampling (sensor-monitored
+// pattern at 1 % duty .. ULP powered on), and RTC timer + RTC memory only
+static const uint32_t UA_ULP_LOW = 100;
+static const uint32_t UA_ULP_HIGH = 150;
+static const uint32_t UA_RTC_ONLY = 10;
+
+// ULP program data: last words of the ULP reserved memory
+static const uint32_t VAR_BASE = CONFIG_ESP32_ULP_COPROC_RESERVE_MEM / 4 - 8;
+enum { VAR_CAUSE, VAR_MASK, VAR_COUNT, VAR_T_LO, VAR_T_HI, VAR_COUNT_ALL };
+enum { CAUSE_REMOTE = 1, CAUSE_ALARM = 2 };
+
+static int rtcIo(uint8_t gpio) { return rtc_io_number_get((gpio_num_t)gpio); }
+
+// RTC IO numbers of the remote inputs: lowest one, and the active mask relative to it
+static bool remoteWindow(int& lo, int& hi, uint32_t& mask) {
+  lo = 99;
+  hi = -1;
+  for (uint8_t i = IN_REMOTE_A; i <= IN_REMOTE_D; i++) {
+    int io = rtcIo(BOARD.in[i].gpio);
+    if (io < 0) return false;
+    if (io < lo) lo = io;
+    if (io > hi) hi = io;
+  }
+  mask = 0;
+  for (uint8_t i = IN_REMOTE_A; i <= IN_REMOTE_D; i++) mask |= 1UL << (rtcIo(BOARD.in[i].gpio) - lo);
+  // One ULP register read covers at most 16 bits
+  return hi - lo < 16;
+}
+
+void ParkingMode::begin() {
+  if (esp_reset_reason() != ESP_RST_DEEPSLEEP || record.magic != PARK_MAGIC) {
+    record.magic = 0;
+    return;
+  }
+  switch (esp_sleep_get_wakeup_cause()) {
+    case ESP_SLEEP_WAKEUP_ULP: {
+      ulpWake = true;
+      uint32_t why = RTC_SLOW_MEM[VAR_BASE + VAR_CAUSE] & 0xFFFF;
+      uint32_t seen = RTC_SLOW_MEM[VAR_BASE + VAR_MASK] & 0xFFFF;
+      ulpStamp = (RTC_SLOW_MEM[VAR_BASE + VAR_T_LO] & 0xFFFF) | ((RTC_SLOW_MEM[VAR_BASE + VAR_T_HI] & 0xFFFF) << 16);
+      int lo, hi;
+      uint32_t mask;
+      if (why == CAUSE_REMOTE && remoteWindow(lo, hi, mask)) {
+        for (uint8_t i = IN_REMOTE_A; i <= IN_REMOTE_D && remote < 0; i++) {
+          if (seen & (1UL << (rtcIo(BOARD.in[i].gpio) - lo))) remote = (int8_t)i;
+        }
+      }
+      cause = why == CAUSE_ALARM ? PARK_WAKE_ALARM : remote >= 0 ? PARK_WAKE_REMOTE : PARK_WAKE_OTHER;
+      break;
+    }
+    case ESP_SLEEP_WAKEUP_EXT1: {
+      uint64_t pins = esp_sleep_get_ext1_wakeup_status();
+      for (uint8_t i = IN_REMOTE_A; i <= IN_REMOTE_D && remote < 0; i++) {
+        if (pins & (1ULL << BOARD.in[i].gpio)) remote = (int8_t)i;
+      }
+      cause = remote >= 0 ? PARK_WAKE_REMOTE : PARK_WAKE_OTHER;
+      break;
+    }
+    case ESP_SLEEP_WAKEUP_EXT0:
+      cause = PARK_WAKE_ALARM;
+      break;
+    default:
+      cause = PARK_WAKE_OTHER;
+      break;
+  }
+}
+
+void ParkingMode::onActuated() {
+  if (cause != PARK_WAKE_REMOTE) return;
+  appToActUs = micros();
+  if (ulpWake) {
+    // Slow-clock counter since the ULP decided to wake: ROM, bootloader and setup() included
+    uint32_t ticks = (uint32_t)rtc_time_get() - ulpStamp;
+    uint64_t us = rtc_time_slowclk_to_us(ticks, esp_clk_slowclk_cal_get());
+    // More than 10 s: stale counter read, no sample
+    if (us < 10000000ULL) wakeToActUs = (uint32_t)us;
+  }
+  Serial.printf("Parking: woken by remote %c, on the pins %lu ms after the wake (%lu ms after app start)\n",
+                'A' + remote, (unsigned long)(wakeToActUs / 1000), (unsigned long)(appToActUs / 1000));
+}
+
+void ParkingMode::onRtc(uint32_t now) {
+  if (cause == PARK_WAKE_NONE || !record.parkedAt || now < record.parkedAt) return;
+  parkedS = now - record.parkedAt;
+}
+
+#ifdef CONFIG_ESP32_ULP_COPROC_ENABLED
+// Every SAMPLE_MS: INT low -> wake (alarm). Any remote input high -> count,
+// PRESS_SAMPLES in a row -> wake (remote), none -> count back to 0. Before the
+// wake the RTC counter is latched, for the wake-to-unlock time.
+bool ParkingMode::loadUlp() {
+  int lo, hi;
+  uint32_t mask;
+  int intIo = rtcIo(PIN_RTC_INT);
+  if (!remoteWindow(lo, hi, mask) || intIo < 0) return false;
+  const uint32_t in = RTC_GPIO_IN_NEXT_S;
+  enum { L_ALARM = 1, L_WAKE, L_TIME, L_IDLE, L_HALT };
+  const ulp_insn_t program[] = {
+    I_RD_REG(RTC_GPIO_IN_REG, in + intIo, in + intIo),
+    M_BL(L_ALARM, 1),
+    I_RD_REG(RTC_GPIO_IN_REG, in + lo, in + hi),
+    I_ANDI(R0, R0, mask),
+    M_BXZ(L_IDLE),
+    I_MOVI(R2, VAR_BASE),
+    I_ST(R0, R2, VAR_MASK),
+    I_LD(R1, R2, VAR_COUNT),
+    I_ADDI(R1, R1, 1),
+    I_ST(R1, R2, VAR_COUNT),
+    I_MOVR(R0, R1),
+    M_BL(L_HALT, PRESS_SAMPLES),
+    I_MOVI(R0, CAUSE_REMOTE),
+    M_BX(L_WAKE),
+    M_LABEL(L_ALARM),
+    I_MOVI(R0, CAUSE_ALARM),
+    M_LABEL(L_WAKE),
+    I_MOVI(R2, VAR_BASE),
+    I_ST(R0, R2, VAR_CAUSE),
+    I_WR_REG_BIT(RTC_CNTL_TIME_UPDATE_REG, RTC_CNTL_TIME_UPDATE_S, 1),
+    M_LABEL(L_TIME),
+    I_RD_REG(RTC_CNTL_TIME_UPDATE_REG, RTC_CNTL_TIME_VALID_S, RTC_CNTL_TIME_VALID_S),
+    M_BL(L_TIME, 1),
+    I_RD_REG(RTC_CNTL_TIME0_REG, 0, 15),
+    I_ST(R0, R2, VAR_T_LO),
+    I_RD_REG(RTC_CNTL_TIME0_REG, 16, 31),
+    I_ST(R0, R2, VAR_T_HI),
+    I_WAKE(),
+    I_END(),
+    I_HALT(),
+    M_LABEL(L_IDLE),
+    I_MOVI(R2, VAR_BASE),
+    I_MOVI(R1, 0),
+    I_ST(R1, R2, VAR_COUNT),
+    M_LABEL(L_HALT),
+    I_HALT(),
+  };
+  size_t size = sizeof(program) / sizeof(program[0]);
+  if (size > VAR_BASE) return false;
+  for (uint8_t i = 0; i < VAR_COUNT_ALL; i++) RTC_SLOW_MEM[VAR_BASE + i] = 0;
+  if (ulp_process_macros_and_load(0, program, &size) != ESP_OK) return false;
+  ulp_set_wakeup_period(0, SAMPLE_MS * 1000UL);
+  return ulp_run(0) == ESP_OK;
+}
+#else
+bool ParkingMode::loadUlp() { return false; }
+#endif
+
+void ParkingMode::sleep(uint32_t now) {
+  record.parks = record.magic == PARK_MAGIC ? record.parks + 1 : 1;
+  record.parkedAt = now;
+  record.magic = PARK_MAGIC;
+  Serial.flush();
+  boardHoldIdle();
+  // RTC IO keeps the inputs readable (and INT's pull-up) without the digital pads
+  esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_PERIPH, ESP_PD_OPTION_ON);
+  for (const BoardPin& p : BOARD.in) {
+    if (&p == &BOARD.in[IN_BUTTON]) continue;
+    gpio_num_t g = (gpio_num_t)p.gpio;
+    rtc_gpio_init(g);
+    rtc_gpio_set_direction(g, RTC_GPIO_MODE_INPUT_ONLY);
+    if (p.role == PinRole::InputPullup) {
+      rtc_gpio_pulldown_dis(g);
+      rtc_gpio_pullup_en(g);
+    }
+  }
+  record.ulp = loadUlp();
+  if (record.ulp) {
+    esp_sleep_enable_ulp_wakeup();
+  } else {
+    uint64_t pins = 0;
+    for (uint8_t i = IN_REMOTE_A; i <= IN_REMOTE_D; i++) pins |= 1ULL << BOARD.in[i].gpio;
+    esp_sleep_enable_ext1_wakeup(pins, ESP_EXT1_WAKEUP_ANY_HIGH);
+    esp_sleep_enable_ext0_wakeup((gpio_num_t)PIN_RTC_INT, 0);
+  }
+  esp_deep_sleep_start();
+}
+
+// uAh as "1.2" mAh
+static void printMah(Print& out, uint64_t uah) {
+  out.printf("%lu.%lu", (unsigned long)(uah / 1000), (unsigned long)(uah % 1000 / 100));
+}
+
+void ParkingMode::print(Print& out, const char* blocker) const {
+  static const char* const WAKE_NAMES[] = {"-", "remote", "RTC alarm", "other"};
+#ifdef CONFIG_ESP32_ULP_COPROC_ENABLED
+  const bool ulp = true;
+#else
+  const bool ulp = false;
+#endif
+  if (idleMinutes) out.printf("Parking: deep sleep after %u min without activity", idleMinutes);
+  else out.print("Parking: off");
+  if (ulp) {
+    out.printf(", ULP samples every %lu ms, press = %u samples\n", (unsigned long)SAMPLE_MS, PRESS_SAMPLES);
+  } else {
+    out.println(", ext1/ext0 wake (no ULP in this core)");
+  }
+  out.printf("  now: %s\n", blocker ? blocker : "ready");
+  if (cause != PARK_WAKE_NONE) {
+    out.printf("  last wake: %s", WAKE_NAMES[cause]);
+    if (remote >= 0) out.printf(" %c", 'A' + remote);
+    out.printf(" (%s), park #%lu", ulpWake ? "ULP" : "ext", (unsigned long)record.parks);
+    if (parkedS) out.printf(", parked %lu.%lu h", (unsigned long)(parkedS / 3600), (unsigned long)(parkedS % 3600 / 360));
+    out.println();
+  }
+  if (appToActUs) {
+    out.print("  remote press -> pins: ");
+    if (wakeToActUs) {
+      out.printf("%lu ms after the ULP wake (RTC counter, boot included) + %lu-%lu ms press filter",
+                 (unsigned long)(wakeToActUs / 1000), (unsigned long)((PRESS_SAMPLES - 1) * SAMPLE_MS),
+                 (unsigned long)(PRESS_SAMPLES * SAMPLE_MS));
+    } else {
+      out.print("wake time not measured (ROM/bootloader time not included)");
+    }
+    out.printf(", %lu ms after app start\n", (unsigned long)(appToActUs / 1000));
+  }
+  uint32_t lowUa = ulp ? UA_ULP_LOW : UA_RTC_ONLY, highUa = ulp ? UA_ULP_HIGH : UA_RTC_ONLY;
+  out.printf("  est. deep-sleep current %lu-%lu uA (ESP32 datasheet typicals; RX500, regulator and relay drivers\n"
+             "  not included, not a measurement)",
+             (unsigned long)lowUa, (unsigned long)highUa);
+  if (parkedS) {
+    out.print(", last park ~");
+    printMah(out, (uint64_t)parkedS * highUa / 3600);
+    out.print(" mAh");
+  }
+  out.println();
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <Arduino.h>
+#include "pin_config.h"
+
+// Why the last deep sleep ended
+enum ParkWake : uint8_t {
+  PARK_WAKE_NONE,     // not woken from parking (power-on, reset, ...)
+  PARK_WAKE_REMOTE,   // valid remote press
+  PARK_WAKE_ALARM,    // DS3231 alarm (scheduled warm-up)
+  PARK_WAKE_OTHER,    // deep-sleep wake without a recognised cause
+};
+
+// Deep-sleep parking. Both cores and BLE are off; the outputs are held at
+// their inactive level (pad hold). The ULP coprocessor samples the remote
+// inputs and the DS3231 INT line every SAMPLE_MS: a remote input has to stay
+// active for PRESS_SAMPLES samples in a row (a valid press, not RF noise),
+// INT low wakes at once. The ULP program is built at runtime from the ULP
+// macros (no ULP toolchain), for the RTC IO numbers of the board profile.
+// Without ULP support in the core, ext1 (remote, any high) and ext0 (INT low)
+// wake the CPU instead, without the press filter.
+// Lock/engine state comes back from HotStateStore (RTC memory); the press
+// that woke the board is handed to RX500Module::press() in setup(), since the
+// key may be released before the first poll.
+class ParkingMode {
+public:
+  static const uint32_t SAMPLE_MS = 20;
+  static const uint8_t PRESS_SAMPLES = 3;
+
+  // setup(), after boardInitPins(): wake cause and the ULP's result
+  void begin();
+  void setMinutes(uint16_t m) { idleMinutes = m; }
+  uint16_t minutes() const { return idleMinutes; }
+  ParkWake wakeCause() const { return cause; }
+  // Remote input (0-3 = A-D) that woke the board, -1 = none
+  int8_t wakeRemote() const { return remote; }
+  // End of setup(): the wake press's output change is on the pins
+  void onActuated();
+  // Once the RTC runs: length of the last park
+  void onRtc(uint32_t now);
+  // Pins held, wake sources armed, deep sleep; does not return
+  void sleep(uint32_t now);
+  void print(Print& out, const char* blocker) const;
+
+private:
+  uint16_t idleMinutes = 0;
+  ParkWake cause = PARK_WAKE_NONE;
+  int8_t remote = -1;
+  bool ulpWake = false;         // woken by the ULP (else ext0/ext1 or not parked)
+  uint32_t ulpStamp = 0;        // RTC slow-clock counter (low 32 bit) at the ULP wake decision
+  uint32_t wakeToActUs = 0;     // ULP wake decision -> output change, 0 = not measured
+  uint32_t appToActUs = 0;      // app start -> output change
+  uint32_t parkedS = 0;         // length of the last park, 0 = unknown
+
+  bool loadUlp();
+};
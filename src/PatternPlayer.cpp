@@ -0,0 +1,109 @@
+#include "PatternPlayer.h"
+#include <climits>
+
+extern OutputArbiter outputs;
+extern LedcModulator ledc;
+
+PatternPlayer::PatternPlayer() {
+  for (uint8_t i = 0; i < OUT_COUNT; i++) {
+    slots[i] = Slot{nullptr, SRC_DOOR, 0, 0, LedcModulator::NONE, 0};
+  }
+}
+
+void PatternPlayer::play(Output out, OutputSource src, const Pattern& p) {
+  Slot& s = slots[out];
+  if (s.pat == &p && s.src == src) return;
+  if (s.pat) stop(out);
+  s.pat = &p;
+  s.src = src;
+  s.step = 0;
+  s.pass = 0;
+  s.ledc = LedcModulator::NONE;
+  if (offload && patternOffloadable(p)) {
+    s.ledc = ledc.acquireWave(patternPeriodMs(p) * 1000UL, p.steps[0].ms * 1000UL, BOARD.out[out].activeHigh);
+  }
+  if (s.ledc != LedcModulator::NONE) {
+    // Logical ON for the whole pattern; LEDC shapes the pin
+    outputs.setModulation(out, s.ledc);
+    outputs.request(out, src, true);
+  } else {
+    enter(out, millis());
+  }
+}
+
+void PatternPlayer::stop(Output out) {
+  Slot& s = slots[out];
+  if (!s.pat) return;
+  if (s.ledc != LedcModulator::NONE) {
+    outputs.setModulation(out, LedcModulator::NONE);
+    ledc.release(s.ledc);
+    s.ledc = LedcModulator::NONE;
+  }
+  s.pat = nullptr;
+  outputs.release(out, s.src);
+}
+
+void PatternPlayer::setOffload(bool on) {
+  if (on == offload) return;
+  offload = on;
+  for (uint8_t i = 0; i < OUT_COUNT; i++) {
+    Slot& s = slots[i];
+    if (!s.pat || (s.ledc != LedcModulator::NONE) == (on && patternOffloadable(*s.pat))) continue;
+    const Pattern* p = s.pat;
+    OutputSource src = s.src;
+    stop((Output)i);
+    play((Output)i, src, *p);
+  }
+}
+
+unsigned long PatternPlayer::msToNextStep() const {
+  unsigned long now = millis(), best = ULONG_MAX;
+  for (uint8_t i = 0; i < OUT_COUNT; i++) {
+    const Slot& s = slots[i];
+    if (!s.pat || s.ledc != LedcModulator::NONE) continue;
+    long left = (long)(s.next - now);
+    if (left <= 0) return 0;
+    if ((unsigned long)left < best) best = (unsigned long)left;
+  }
+  return best;
+}
+
+void PatternPlayer::enter(Output out, unsigned long now) {
+  Slot& s = slots[out];
+  const PatternStep& st = s.pat->steps[s.step];
+  outputs.request(out, s.src, st.level);
+  s.next = now + st.ms;
+}
+
+void PatternPlayer::update() {
+  unsigned long now = millis();
+  for (uint8_t i = 0; i < OUT_COUNT; i++) {
+    Slot& s = slots[i];
+    if (!s.pat) continue;
+    if (s.ledc != LedcModulator::NONE) {
+      // Forced off by a higher claim / clear(): give the channel back
+      if (!outputs.isOn((Output)i)) stop((Output)i);
+      continue;
+    }
+    if ((long)(now - s.next) < 0) continue;
+    if (++s.step >= s.pat->count) {
+      s.pass++;
+      if (s.pat->repeat && s.pass >= s.pat->repeat) {
+        stop((Output)i);
+        continue;
+      }
+      s.step = s.pat->loopFrom;
+    }
+    enter((Output)i, now);
+  }
+}
+
+void PatternPlayer::print(Print& out) const {
+  for (uint8_t i = 0; i < OUT_COUNT; i++) {
+    const Slot& s = slots[i];
+    if (!s.pat) continue;
+    out.printf("%-9s %-14s %s\n", BOARD.out[i].name, s.pat->name,
+               s.ledc != LedcModulator::NONE ? "ledc" : "cpu");
+  }
+  out.printf("LEDC slots in use: %u/%u%s\n", ledc.inUse(), LedcModulator::SLOTS, offload ? "" : " (offload off: light sleep)");
+}
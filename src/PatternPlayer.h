@@ -0,0 +1,38 @@
+#pragma once
+#include <Arduino.h>
+#include "OutputArbiter.h"
+#include "LedcModulator.h"
+#include "Patterns.h"
+
+// Plays Patterns on outputs through OutputArbiter claims. Offloadable
+// patterns get an LEDC channel (no CPU toggling); the rest are stepped in
+// update(). One pattern per output.
+class PatternPlayer {
+public:
+  PatternPlayer();
+  // Start p on out; no-op if p already plays there
+  void play(Output out, OutputSource src, const Pattern& p);
+  void stop(Output out);
+  bool playing(Output out) const { return slots[out].pat != nullptr; }
+  // LEDC offload on/off (default on). Off: running patterns move to CPU
+  // stepping, for light sleep (the LEDC wave clock stops in it); on: the
+  // offloadable ones move back. A moved pattern restarts at its first step.
+  void setOffload(bool on);
+  // ms until the next CPU-stepped edge, ULONG_MAX if there is none
+  unsigned long msToNextStep() const;
+  void update();
+  void print(Print& out) const;
+
+private:
+  struct Slot {
+    const Pattern* pat;
+    OutputSource src;
+    uint8_t step;
+    uint8_t pass;
+    int8_t ledc;
+    unsigned long next;
+  };
+  Slot slots[OUT_COUNT];
+  bool offload = true;
+  void enter(Output out, unsigned long now);
+};
@@ -0,0 +1,57 @@
+#pragma once
+#include <stdint.h>
+
+// Light/horn patterns as data: (level, duration) steps, played by
+// PatternPlayer on any output. A pattern runs its steps `repeat` times
+// (0 = until stopped); after the first pass it loops from `loopFrom`.
+// Two-step forever patterns (on, off) starting at step 0 can run on the LEDC
+// peripheral instead of the CPU.
+struct PatternStep {
+  bool level;
+  uint16_t ms;
+};
+
+struct Pattern {
+  const char* name;
+  const PatternStep* steps;
+  uint8_t count;
+  uint8_t repeat;
+  uint8_t loopFrom;
+};
+
+constexpr bool patternOffloadable(const Pattern& p) {
+  return p.repeat == 0 && p.count == 2 && p.loopFrom == 0 &&
+         p.steps[0].level && !p.steps[1].level;
+}
+
+constexpr uint32_t patternPeriodMs(const Pattern& p) {
+  uint32_t t = 0;
+  for (uint8_t i = 0; i < p.count; i++) t += p.steps[i].ms;
+  return t;
+}
+
+// Hazard after LOCK: on 400, off 200, on 400
+inline constexpr PatternStep LOCK_HAZARD_STEPS[] = { {true, 400}, {false, 200}, {true, 400} };
+inline constexpr Pattern PATTERN_LOCK_HAZARD = { "lock_hazard", LOCK_HAZARD_STEPS, 3, 1, 0 };
+
+// Hazard after UNLOCK: one 1000 ms flash
+inline constexpr PatternStep UNLOCK_HAZARD_STEPS[] = { {true, 1000} };
+inline constexpr Pattern PATTERN_UNLOCK_HAZARD = { "unlock_hazard", UNLOCK_HAZARD_STEPS, 1, 1, 0 };
+
+// Alarm: hazard and alarm output toggle every 200 ms
+inline constexpr PatternStep ALARM_STEPS[] = { {true, 200}, {false, 200} };
+inline constexpr Pattern PATTERN_ALARM = { "alarm", ALARM_STEPS, 2, 0, 0 };
+
+// Pesawat heartbeat while locked and engine off: 100 ms flash every 3.1 s
+inline constexpr PatternStep PESAWAT_STEPS[] = { {true, 100}, {false, 3000} };
+inline constexpr Pattern PATTERN_PESAWAT = { "pesawat", PESAWAT_STEPS, 2, 0, 0 };
+
+// LED_POWER: slow blink when idle, fast while a start attempt is running
+inline constexpr PatternStep LED_IDLE_STEPS[] = { {true, 500}, {false, 500} };
+inline constexpr Pattern PATTERN_LED_IDLE = { "led_idle", LED_IDLE_STEPS, 2, 0, 0 };
+inline constexpr PatternStep LED_FAST_STEPS[] = { {true, 200}, {false, 50} };
+inline constexpr Pattern PATTERN_LED_FAST = { "led_fast", LED_FAST_STEPS, 2, 0, 0 };
+
+static_assert(patternOffloadable(PATTERN_ALARM) && patternOffloadable(PATTERN_PESAWAT) &&
+              patternOffloadable(PATTERN_LED_IDLE) && patternOffloadable(PATTERN_LED_FAST),
+              "periodic patterns are expected to run on LEDC");
@@ -0,0 +1,238 @@
+#include "PowerManager.h"
+#include <driver/gpio.h>
+#include <driver/uart.h>
+#include <esp_sleep.h>
+
+// ESP32 datasheet typicals (uA). Modem-sleep ranges per CPU clock: the low
+// end is taken for time spent waiting (idle task), the high end for tick
+// work. Radio TX/RX is not included.
+static const uint32_t UA_240_RUN = 68000;
+static const uint32_t UA_240_WAIT = 30000;
+static const uint32_t UA_80_RUN = 31000;
+static const uint32_t UA_80_WAIT = 20000;
+static const uint32_t UA_LIGHT_SLEEP = 800;
+
+static const char* const STATE_NAMES[PS_COUNT] = {"active", "idle", "parked"};
+static const char* const SOURCE_NAMES[WAKE_SOURCE_COUNT] = {"remote", "button", "rtc", "ble"};
+
+void PowerManager::begin(bool enable) {
+  loopTask = xTaskGetCurrentTaskHandle();
+  on = enable;
+  esp_pm_config_esp32_t cfg = {};
+  cfg.max_freq_mhz = MAX_MHZ;
+  cfg.min_freq_mhz = MIN_MHZ;
+  cfg.light_sleep_enable = true;
+  pmErr = esp_pm_configure(&cfg);
+  if (pmErr == ESP_OK) {
+    pmMode = PM_MODE_LIGHT_SLEEP;
+  } else {
+    cfg.light_sleep_enable = false;
+    pmMode = esp_pm_configure(&cfg) == ESP_OK ? PM_MODE_DFS : PM_MODE_CLOCK;
+  }
+  if (pmMode != PM_MODE_CLOCK) {
+    esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "pm_busy", &freqLock);
+    esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "pm_awake", &awakeLock);
+  }
+  // Boot counts as busy until the first endTick()
+  apply(PS_ACTIVE);
+  transitions = 0;
+
+  // No ESP_INTR_FLAG_IRAM (nothing else installs the service): the handler
+  // may call gpio_intr_disable(), which lives in flash
+  gpio_install_isr_service(0);
+  for (uint8_t i = IN_REMOTE_A; i <= IN_REMOTE_D; i++) addPin(BOARD.in[i].gpio, WAKE_REMOTE);
+  addPin(PIN_BUTTON, WAKE_BUTTON);
+  addPin(PIN_RTC_INT, WAKE_RTC);
+  rearm();
+  esp_sleep_enable_gpio_wakeup();
+  // Console: the first bytes of a line wake the chip (and are lost), the
+  // linger time keeps it awake for the rest
+  uart_set_wakeup_threshold(UART_NUM_0, 3);
+  esp_sleep_enable_uart_wakeup(UART_NUM_0);
+  lastTickMs = millis();
+  tickStartUs = micros();
+}
+
+void PowerManager::addPin(uint8_t gpio, WakeSource src) {
+  if (pinCount >= WAKE_PINS) return;
+  WakePin& p = pins[pinCount];
+  p = WakePin{this, gpio, (uint8_t)src, pinCount};
+  gpio_isr_handler_add((gpio_num_t)gpio, onWakePin, &p);
+  pinCount++;
+}
+
+void PowerManager::setEnabled(bool enable) {
+  on = enable;
+  poke();
+}
+
+void IRAM_ATTR PowerManager::onWakePin(void* arg) {
+  WakePin* p = static_cast<WakePin*>(arg);
+  PowerManager* pm = p->owner;
+  // Level interrupt: off until rearm() sets it up for the other level
+  gpio_intr_disable((gpio_num_t)p->gpio);
+  __atomic_fetch_and(&pm->armed, ~(1UL << p->bit), __ATOMIC_SEQ_CST);
+  pm->stamp(p->src);
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(pm->loopTask, &woken);
+  if (woken) portYIELD_FROM_ISR();
+}
+
+void IRAM_ATTR PowerManager::stamp(uint8_t src) {
+  wakes[src]++;
+  if (pendingUs) return;
+  uint32_t t = (uint32_t)micros();
+  pendingSrc = src;
+  pendingUs = t ? t : 1;
+}
+
+void PowerManager::wake(WakeSource src) {
+  stamp(src);
+  poke();
+}
+
+void PowerManager::poke() {
+  if (loopTask) xTaskNotifyGive(loopTask);
+}
+
+// Pins whose interrupt fired are armed again against their current level.
+// A pin that is still armed is left alone: if it changed during this tick
+// its interrupt is already pending.
+void PowerManager::rearm() {
+  for (uint8_t i = 0; i < pinCount; i++) {
+    uint32_t bit = 1UL << i;
+    if (armed & bit) continue;
+    gpio_num_t g = (gpio_num_t)pins[i].gpio;
+    bool high = gpio_get_level(g) != 0;
+    gpio_wakeup_enable(g, high ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+    __atomic_fetch_or(&armed, bit, __ATOMIC_SEQ_CST);
+    gpio_intr_enable(g);
+  }
+}
+
+void PowerManager::waitTick(unsigned long maxWaitMs) {
+  unsigned long now = millis();
+  bool fast = state == PS_ACTIVE || now - lastWakeMs < LINGER_MS;
+  unsigned long period = fast ? ACTIVE_TICK_MS : IDLE_TICK_MS;
+  unsigned long elapsed = now - lastTickMs;
+  unsigned long wait = elapsed < period ? period - elapsed : 0;
+  if (maxWaitMs < wait) wait = maxWaitMs;
+  uint32_t t0 = micros();
+  // Also returns at once for a notification that came during the last tick
+  if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait))) lastWakeMs = millis();
+  uint32_t t1 = micros();
+  waitUs[state] += t1 - t0;
+  lastTickMs = millis();
+  tickStartUs = t1;
+}
+
+void PowerManager::endTick(bool busy, bool ledcInUse, uint32_t commits) {
+  uint32_t now = micros();
+  workUs[state] += now - tickStartUs;
+
+  // Latency: from the event (ISR / BT write) to the commit of the first tick
+  // that started after it and changed an output
+  uint32_t p = pendingUs;
+  if (p && (int32_t)(tickStartUs - p) >= 0) {
+    if (commits != lastCommits) {
+      Latency& l = lat[pendingSrc];
+      uint32_t us = now - p;
+      if (!l.actuated || us < l.minUs) l.minUs = us;
+      if (us > l.maxUs) l.maxUs = us;
+      l.totalUs += us;
+      l.actuated++;
+      pendingUs = 0;
+    } else if (now - p > ACTUATION_WINDOW_US) {
+      // Nothing switched (status query, rejected input)
+      pendingUs = 0;
+    }
+  }
+  lastCommits = commits;
+  rearm();
+
+  if (busy) lastBusyMs = millis();
+  PowerState next;
+  if (!on || busy) {
+    next = PS_ACTIVE;
+  } else if (pmMode != PM_MODE_LIGHT_SLEEP || ledcInUse || millis() - lastWakeMs < LINGER_MS) {
+    next = PS_IDLE;
+  } else {
+    next = PS_PARKED;
+  }
+  if (next != state) apply(next);
+}
+
+unsigned long PowerManager::idleMs() const {
+  unsigned long now = millis();
+  unsigned long sinceWake = now - lastWakeMs, sinceBusy = now - lastBusyMs;
+  return sinceWake < sinceBusy ? sinceWake : sinceBusy;
+}
+
+void PowerManager::apply(PowerState next) {
+  bool fast = next == PS_ACTIVE;
+  bool awake = next != PS_PARKED;
+  if (pmMode == PM_MODE_CLOCK) {
+    // APB stays at 80 MHz for both clocks: UART, LEDC and BT are unaffected
+    if (fast != freqHeld) setCpuFrequencyMhz(fast ? MAX_MHZ : MIN_MHZ);
+    freqHeld = fast;
+  } else {
+    if (fast && !freqHeld) esp_pm_lock_acquire(freqLock);
+    if (!fast && freqHeld) esp_pm_lock_release(freqLock);
+    freqHeld = fast;
+    if (awake && !awakeHeld) esp_pm_lock_acquire(awakeLock);
+    if (!awake && awakeHeld) esp_pm_lock_release(awakeLock);
+    awakeHeld = awake;
+  }
+  state = next;
+  transitions++;
+}
+
+// uA as "12.3"
+static const char* maText(uint64_t ua, char* buf, size_t len) {
+  snprintf(buf, len, "%lu.%lu", (unsigned long)(ua / 1000), (unsigned long)(ua % 1000 / 100));
+  return buf;
+}
+
+void PowerManager::print(Print& out) const {
+  static const char* const MODE_NAMES[] = {"esp_pm DFS 240/80 MHz + light sleep", "esp_pm DFS 240/80 MHz",
+                                           "CPU clock 240/80 MHz (no esp_pm)"};
+  out.printf("Power: %s, %s, state %s, CPU %lu MHz, %lu state changes\n", MODE_NAMES[pmMode], on ? "on" : "off",
+             STATE_NAMES[state], (unsigned long)getCpuFrequencyMhz(), (unsigned long)transitions);
+  if (pmMode != PM_MODE_LIGHT_SLEEP) out.printf("  light sleep not available: %s\n", esp_err_to_name(pmErr));
+
+  // Estimate: per state, work at the run current and waiting at the idle
+  // (or light-sleep) current of its clock
+  uint64_t total = 0;
+  for (uint8_t s = 0; s < PS_COUNT; s++) total += workUs[s] + waitUs[s];
+  if (!total) return;
+  uint64_t sleepUa = 0, awakeUa = 0;
+  char a[12], b[12];
+  out.println("  state     time    work  est. mA");
+  for (uint8_t s = 0; s < PS_COUNT; s++) {
+    uint64_t t = workUs[s] + waitUs[s];
+    // Only the active state runs at 240 MHz
+    uint32_t run = s == PS_ACTIVE ? UA_240_RUN : UA_80_RUN;
+    uint32_t idle = s == PS_ACTIVE ? UA_240_WAIT : UA_80_WAIT;
+    uint64_t charge = workUs[s] * run + waitUs[s] * (s == PS_PARKED ? UA_LIGHT_SLEEP : idle);   // uA*us
+    sleepUa += charge / total;
+    awakeUa += (workUs[s] * run + waitUs[s] * idle) / total;
+    unsigned long share = (unsigned long)(t * 1000 / total);
+    unsigned long work = t ? (unsigned long)(workUs[s] * 1000 / t) : 0;
+    out.printf("  %-7s %3lu.%lu%% %3lu.%lu%%  %s\n", STATE_NAMES[s], share / 10, share % 10, work / 10, work % 10,
+               t ? maText(charge / t, a, sizeof(a)) : "-");
+  }
+  out.printf("  est. average %s mA (parked waits in light sleep), %s mA if a driver lock (BT controller)\n"
+             "  kept light sleep off; datasheet typicals, radio not included, not a measurement\n",
+             maText(sleepUa, a, sizeof(a)), maText(awakeUa, b, sizeof(b)));
+
+  out.print("  wakes:");
+  for (uint8_t i = 0; i < WAKE_SOURCE_COUNT; i++) out.printf(" %s=%lu", SOURCE_NAMES[i], (unsigned long)wakes[i]);
+  out.println();
+  out.println("  wake -> first output change (us):");
+  for (uint8_t i = 0; i < WAKE_SOURCE_COUNT; i++) {
+    const Latency& l = lat[i];
+    if (!l.actuated) continue;
+    out.printf("    %-6s n=%lu min=%lu avg=%lu max=%lu\n", SOURCE_NAMES[i], (unsigned long)l.actuated,
+               (unsigned long)l.minUs, (unsigned long)(l.totalUs / l.actuated), (unsigned long)l.maxUs);
+  }
+}
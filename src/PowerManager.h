@@ -0,0 +1,126 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_pm.h>
+#include "pin_config.h"
+
+// Event that ended a loop() wait early; its wake-to-actuation latency is kept per source
+enum WakeSource : uint8_t {
+  WAKE_REMOTE,   // RX500 input level change (GPIO ISR)
+  WAKE_BUTTON,   // start button (GPIO ISR)
+  WAKE_RTC,      // DS3231 alarm 1 on rtc_int (GPIO ISR)
+  WAKE_BLE,      // characteristic write (BT task)
+  WAKE_SOURCE_COUNT
+};
+
+// What the core's sdkconfig lets begin() configure
+enum PowerMode : uint8_t {
+  PM_MODE_LIGHT_SLEEP,  // esp_pm DFS 240/80 MHz + automatic light sleep (tickless idle)
+  PM_MODE_DFS,          // esp_pm DFS only (no CONFIG_FREERTOS_USE_TICKLESS_IDLE)
+  PM_MODE_CLOCK,        // no CONFIG_PM_ENABLE: setCpuFrequencyMhz 240/80 MHz by hand
+};
+
+enum PowerState : uint8_t {
+  PS_ACTIVE,   // pulse, sequence, warm-up, engine or alarm running (or `pm off`): 240 MHz, no light sleep
+  PS_IDLE,     // nothing running, 80 MHz; light sleep blocked (LEDC driving a pin, recent wake, mode)
+  PS_PARKED,   // nothing running, light sleep allowed between ticks
+  PS_COUNT
+};
+
+// Replaces loop()'s 10 ms busy spin: the loop task blocks on a task
+// notification until its next tick is due, so the idle task runs and esp_pm
+// can lower the clock or enter light sleep. The tick is 10 ms while something
+// runs and stretches to IDLE_TICK_MS when nothing does; input edges (remote,
+// button, RTC alarm) and BLE writes wake it at once.
+// Input pins use level interrupts armed for the opposite of the pin's current
+// level: the same interrupt is the light-sleep wake source (gpio_wakeup) and
+// the loop notification, and fires on press and release.
+// Busy states hold ESP_PM_CPU_FREQ_MAX and ESP_PM_NO_LIGHT_SLEEP. The LEDC wave
+// clock (REF_TICK) and the hold PWM (APB) stop in light sleep, so an LEDC
+// channel in use also keeps it off; PatternPlayer steps the patterns on the
+// CPU whenever light sleep is possible (sleepCapable()).
+// Time per state is accounted for `pm`, with a current estimate from datasheet
+// typicals (not a measurement).
+class PowerManager {
+public:
+  static const unsigned long ACTIVE_TICK_MS = 10;
+  static const unsigned long IDLE_TICK_MS = 1000;
+  // Fast tick and no light sleep this long after a wake event: debounce,
+  // release, the rest of a serial line
+  static const unsigned long LINGER_MS = 2000;
+  // A wake counts as actuated if an output changes this soon after it
+  static const uint32_t ACTUATION_WINDOW_US = 250000;
+  static const int MAX_MHZ = 240;
+  static const int MIN_MHZ = 80;
+
+  // From setup() (loop task): esp_pm config, locks, wake pins
+  void begin(bool on);
+  void setEnabled(bool on);
+  bool enabled() const { return on; }
+  // Top of loop(): block until the next tick or a wake event; maxWaitMs
+  // bounds the wait (next CPU-stepped pattern edge)
+  void waitTick(unsigned long maxWaitMs);
+  // After outputs.commit(): busy = actuation running, ledcInUse = an LEDC
+  // channel drives a pin (hold PWM), commits = OutputArbiter register commits so far
+  void endTick(bool busy, bool ledcInUse, uint32_t commits);
+  // From another task (BLE write): wake loop() and stamp the latency sample
+  void wake(WakeSource src);
+  // Wake loop() without a latency sample (connect/disconnect)
+  void poke();
+  // Activity without a wake event (a command ran): restarts the idle time
+  void noteActivity() { lastWakeMs = millis(); }
+  // Time since the last wake event, activity or busy tick (parking timeout)
+  unsigned long idleMs() const;
+  // Light sleep can happen between ticks (PatternPlayer keeps off LEDC)
+  bool sleepCapable() const { return on && pmMode == PM_MODE_LIGHT_SLEEP; }
+  PowerMode mode() const { return pmMode; }
+  void print(Print& out) const;
+
+private:
+  struct WakePin {
+    PowerManager* owner;
+    uint8_t gpio;
+    uint8_t src;
+    uint8_t bit;
+  };
+  static const uint8_t WAKE_PINS = 6;
+  WakePin pins[WAKE_PINS];
+  uint8_t pinCount = 0;
+  volatile uint32_t armed = 0;      // bit per pin, cleared by its ISR
+
+  TaskHandle_t loopTask = nullptr;
+  PowerMode pmMode = PM_MODE_CLOCK;
+  esp_err_t pmErr = ESP_OK;
+  esp_pm_lock_handle_t freqLock = nullptr;
+  esp_pm_lock_handle_t awakeLock = nullptr;
+  bool freqHeld = false;
+  bool awakeHeld = false;
+  bool on = true;
+  PowerState state = PS_ACTIVE;
+  uint32_t transitions = 0;
+
+  unsigned long lastTickMs = 0;
+  unsigned long lastWakeMs = 0;
+  unsigned long lastBusyMs = 0;
+  uint32_t tickStartUs = 0;
+  uint32_t lastCommits = 0;
+
+  // First wake not yet matched to an output change (ISR / BT task)
+  volatile uint32_t pendingUs = 0;
+  volatile uint8_t pendingSrc = 0;
+
+  uint64_t workUs[PS_COUNT] = {};
+  uint64_t waitUs[PS_COUNT] = {};
+  struct Latency {
+    uint32_t actuated, minUs, maxUs;
+    uint64_t totalUs;
+  };
+  Latency lat[WAKE_SOURCE_COUNT] = {};
+  volatile uint32_t wakes[WAKE_SOURCE_COUNT] = {};
+
+  void addPin(uint8_t gpio, WakeSource src);
+  void rearm();
+  void apply(PowerState next);
+  void stamp(uint8_t src);
+  static void onWakePin(void* arg);
+};
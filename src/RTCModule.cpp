@@ -51,27 +51,47 @@
 //   rtc.adjust(DateTime(F(__DATE__), F(__TIME__)));
 // }
 #include "RTCModule.h"
-#include <Wire.h>
 
 RTCModule::RTCModule() {
   rtcStatus = RTC_NEED_SET;
+  memset(&drift, 0, sizeof(drift));
+  drift.autoTrim = 1;
+}
+
+void RTCModule::init(Preferences* prefs) {
+  _prefs = prefs;
+  if (_prefs->getBytesLength("rtcdrift") == sizeof(drift)) {
+    _prefs->getBytes("rtcdrift", &drift, sizeof(drift));
+  }
 }
 
 bool RTCModule::begin() {
-  Wire.begin(SDA_PIN, SCL_PIN);
   Serial.printf("RTC init SDA=%d SCL=%d\n", SDA_PIN, SCL_PIN);
 
-  if (!rtc.begin()) {
+  Ds3231Sample s;
+  if (!ds.begin(SDA_PIN, SCL_PIN) || !ds.read(s)) {
     Serial.println("RTC NOT FOUND");
     rtcStatus = RTC_NEED_SET;
     return false;
   }
+  last = s;
+  chipFound = true;
 
-  if (rtc.lostPower()) {
+  if (s.status & 0x80) {
     Serial.println("RTC lost power -> NEED SET");
     rtcStatus = RTC_NEED_SET;
   } else {
     rtcStatus = RTC_OK;
+    // Whole-second start; update() locks onto the second edge
+    if (s.time >= EPOCH_MIN && s.time < EPOCH_MAX) anchor(s.time, millis(), false);
+  }
+
+  // Aging register is cleared when VCC and the backup battery were both gone
+  if (s.aging != drift.aging) {
+    Serial.printf("RTC aging %d -> %d (stored)\n", s.aging, drift.aging);
+    setAging(drift.aging);
+  } else {
+    Serial.printf("RTC aging %d\n", drift.aging);
   }
 
   return true;
@@ -81,57 +101,343 @@ RTCStatus RTCModule::status() {
   return rtcStatus;
 }
 
-DateTime RTCModule::now() {
-  // Avoid calling rtc.now() (I2C) when RTC status is not OK to prevent
-  // repeated Wire errors when the device is missing or the bus is faulty.
-  if (rtcStatus != RTC_OK) {
-    return DateTime(2000, 1, 1, 0, 0, 0);
+void RTCModule::formatNow(char* buf, size_t len) {
+  // If RTC not set, lost power or implausible, report safe neutral time 2000-01-01 00:00:00
+  uint32_t t = epoch();
+  if (!t) {
+    snprintf(buf, len, "2000-01-01 00:00:00");
+    return;
   }
-  return rtc.now();
+  TimeCodec::formatIso(t, buf, len);
 }
 
-String RTCModule::nowString() {
-  // If RTC not set or lost power, report safe neutral time 2000-01-01 00:00:00
-  if (rtcStatus != RTC_OK || rtc.lostPower()) {
-    return String("2000-01-01 00:00:00");
+bool RTCModule::setNowFromString(const char* s, bool precise) {
+  uint32_t t;
+  uint16_t ms;
+  unsigned long at = millis();
+  if (!TimeCodec::parse(s, t, ms) || t < EPOCH_MIN || t >= EPOCH_MAX) {
+    return false;
   }
-  DateTime t = rtc.now();
-  char buf[32];
-  snprintf(buf, sizeof(buf),
-           "%04d-%02d-%02d %02d:%02d:%02d",
-           t.year(), t.month(), t.day(),
-           t.hour(), t.minute(), t.second());
-  return String(buf);
+  sync(t, ms, at, precise);
+  Serial.println(precise ? "RTC synced -> OK" : "RTC manually set -> OK");
+  return true;
 }
 
-void RTCModule::printNow() {
-  Serial.print("RTC: ");
-  Serial.println(nowString());
-}
+void RTCModule::sync(uint32_t sec, uint16_t ms, unsigned long atMs, bool precise) {
+  int64_t ref = (int64_t)sec * 1000 + ms;
+  // An edge read or time write started before this set belongs to the old
+  // RTC time; alarm and aging writes do not and must still be accounted
+  ignoreResult = ds.busy() && (inFlight == DS_JOB_EDGE || inFlight == DS_JOB_SET);
+  DriftEvent e = {sec, DRIFT_NO_OFFSET, 0, drift.aging, (uint8_t)(precise ? DRIFT_SYNC : DRIFT_SYNC_MANUAL), 0};
+  if (rtcStatus == RTC_OK && anchored && phaseKnown && !pendingSet) {
+    int64_t d = clockMs(atMs) - ref;
+    if (d > -2000000000LL && d < 2000000000LL) e.offsetMs = (int32_t)d;
+  }
+  // Drift sample: precise on both ends, long enough, below 50 ppm (else the
+  // reference or the RTC was off, not drift)
+  if (precise && drift.lastPrecise && sec > drift.lastPrecise && e.offsetMs != DRIFT_NO_OFFSET) {
+    uint32_t interval = sec - drift.lastPrecise;
+    uint32_t mag = (uint32_t)(e.offsetMs < 0 ? -(int64_t)e.offsetMs : e.offsetMs);
+    if (interval >= DRIFT_MIN_INTERVAL_S && mag <= interval / 20) e.interval = interval;
+  }
+  logEvent(e);
+  drift.lastPrecise = precise ? sec : 0;
 
-bool RTCModule::setNowFromString(const String& s) {
-  if (s.length() < 19) return false;
+  // Software clock follows the reference at once (slewed when < 1 s away) ...
+  unsigned long secStart = atMs - ms;
+  if (anchored && phaseKnown && e.offsetMs != DRIFT_NO_OFFSET && e.offsetMs > -1000 && e.offsetMs < 1000) {
+    slewMs = e.offsetMs;
+    slewStartMs = atMs;
+  } else {
+    slewMs = 0;
+  }
+  lastSlewMs = slewMs;
+  baseSec = sec;
+  baseMs = secStart;
+  anchored = true;
+  phaseKnown = true;
+  rtcStatus = RTC_OK;
+  // ... and the DS3231 is written on a reference second boundary (update()):
+  // writing the seconds register restarts its countdown chain, so the RTC
+  // phase is right to about a millisecond, not just the second
+  pendingSet = true;
+  setStarted = false;
 
-  int y  = s.substring(0,4).toInt();
-  int m  = s.substring(5,7).toInt();
-  int d  = s.substring(8,10).toInt();
-  int hh = s.substring(11,13).toInt();
-  int mm = s.substring(14,16).toInt();
-  int ss = s.substring(17,19).toInt();
+  if (e.interval) trim(sec);
+  saveDrift();
+}
 
-  if (y < 2020 || m < 1 || m > 12 || d < 1 || d > 31) {
-    return false;
+int64_t RTCModule::clockMs(unsigned long m) const {
+  unsigned long el = m - baseMs;
+  int64_t t = (int64_t)baseSec * 1000 + el;
+  if (slewMs) {
+    unsigned long se = m - slewStartMs;
+    if (se < SLEW_WINDOW_MS) t += (int64_t)slewMs * (int64_t)(SLEW_WINDOW_MS - se) / (int64_t)SLEW_WINDOW_MS;
   }
+  return t;
+}
 
-  rtc.adjust(DateTime(y, m, d, hh, mm, ss));
-  rtcStatus = RTC_OK;
+// New anchor: RTC second sec began at millis() == atMs. With smooth, the
+// software clock keeps its current reading and fades the difference out.
+void RTCModule::anchor(uint32_t sec, unsigned long atMs, bool smooth) {
+  int32_t d = 0;
+  unsigned long now = millis();
+  if (smooth && anchored) {
+    int64_t diff = clockMs(now) - ((int64_t)sec * 1000 + (int64_t)(now - atMs));
+    if (diff > -1000 && diff < 1000) d = (int32_t)diff;
+  }
+  baseSec = sec;
+  baseMs = atMs;
+  slewMs = d;
+  slewStartMs = now;
+  lastSlewMs = d;
+  anchored = true;
+  anchors++;
+}
 
-  Serial.println("RTC manually set -> OK");
-  return true;
+void RTCModule::update() {
+  unsigned long ms = millis();
+  Ds3231Sample s;
+  if (ds.collect(s)) handleSample(s, ms);
+  if (ds.busy()) return;
+
+  if (pendingSet) {
+    if (!setStarted) {
+      // Next boundary at least 2 ms ahead, so the driver task is there in time
+      unsigned long k = (ms + 2 - baseMs) / 1000UL + 1;
+      inFlight = DS_JOB_SET;
+      setStarted = ds.start(DS_JOB_SET, baseSec + (uint32_t)k, baseMs + 1000UL * k);
+    }
+    return;
+  }
+  if (agingDirty && (long)(ms - agingRetryAt) >= 0) {
+    agingDirty = false;
+    agingJob = drift.aging;
+    inFlight = DS_JOB_AGING;
+    if (!ds.start(DS_JOB_AGING, (uint8_t)agingJob)) agingDirty = true;
+    return;
+  }
+  if (rtcStatus != RTC_OK) return;
+  if (alarmDirty && (!alarmRetry || (long)(ms - alarmRetryAt) >= 0)) {
+    alarmDirty = false;
+    alarmRetry = false;
+    alarmJob = alarmWant;
+    inFlight = DS_JOB_ALARM;
+    if (!ds.start(DS_JOB_ALARM, alarmJob)) alarmDirty = true;
+    return;
+  }
+  if (anchored && phaseKnown && ms - huntLastMs < RESYNC_MS) return;
+  huntLastMs = ms;
+  inFlight = DS_JOB_EDGE;
+  unsigned long at = 0;
+  if (anchored && phaseKnown) {
+    // Poll only around the expected tick instead of for up to a second
+    unsigned long toEdge = 1000UL - (unsigned long)(clockMs(ms) % 1000);
+    if (toEdge <= EDGE_LEAD_MS) toEdge += 1000UL;
+    at = ms + toEdge - EDGE_LEAD_MS;
+  }
+  ds.start(DS_JOB_EDGE, 0, at);
+}
+
+void RTCModule::handleSample(const Ds3231Sample& s, unsigned long ms) {
+  if (ignoreResult) {
+    ignoreResult = false;
+    return;
+  }
+  if (inFlight == DS_JOB_SET) {
+    pendingSet = false;
+    huntLastMs = ms;
+    if (!s.ok) {
+      huntMisses++;
+      Serial.println("RTC write failed");
+    }
+    return;
+  }
+  if (inFlight == DS_JOB_AGING) {
+    if (s.ok) {
+      last.aging = agingJob;
+    } else {
+      huntMisses++;
+      agingDirty = true;
+      agingRetryAt = ms + WRITE_RETRY_MS;
+      Serial.println("RTC aging write failed");
+    }
+    return;
+  }
+  if (inFlight == DS_JOB_ALARM) {
+    if (s.ok) {
+      alarmSet = alarmJob;
+    } else {
+      // Retried with the latest wanted time; else parkBlocker() would wait forever
+      huntMisses++;
+      alarmDirty = true;
+      alarmRetry = true;
+      alarmRetryAt = ms + WRITE_RETRY_MS;
+      Serial.println("RTC alarm write failed");
+    }
+    return;
+  }
+  if (!s.ok) {
+    // bus error, or no tick for 1.5 s (oscillator stopped)
+    huntMisses++;
+    return;
+  }
+  last = s;
+  if (s.status & 0x80) {
+    Serial.println("RTC lost power -> NEED SET");
+    rtcStatus = RTC_NEED_SET;
+    anchored = false;
+    return;
+  }
+  if (s.time < EPOCH_MIN || s.time >= EPOCH_MAX) {
+    anchored = false;
+    return;
+  }
+  // s.time began at s.edgeMs
+  anchor(s.time, s.edgeMs, phaseKnown);
+  phaseKnown = true;
 }
 
 bool RTCModule::lostPowerFlag() {
-  // If RTC isn't initialized or flagged as NEED_SET, avoid querying over I2C.
+  // Status register from the last burst read, no I2C here
   if (rtcStatus != RTC_OK) return true;
-  return rtc.lostPower();
+  return last.status & 0x80;
+}
+
+uint32_t RTCModule::epoch() {
+  if (rtcStatus != RTC_OK || !anchored) return 0;
+  return (uint32_t)(clockMs(millis()) / 1000);
+}
+
+void RTCModule::printStats(Print& out) {
+  ds.printStats(out);
+  int q = last.tempQ < 0 ? -last.tempQ : last.tempQ;
+  out.printf("Last read: status=0x%02X aging=%d temp=%s%d.%02d C\n", last.status, last.aging,
+             last.tempQ < 0 ? "-" : "", q / 4, q % 4 * 25);
+  if (alarmSet) {
+    char when[TimeCodec::ISO_LEN];
+    TimeCodec::formatIso(alarmSet, when, sizeof(when));
+    out.printf("Alarm 1: %s\n", when);
+  } else {
+    out.println("Alarm 1: off");
+  }
+}
+
+void RTCModule::setAlarm(uint32_t t) {
+  if (t == alarmWant) return;
+  alarmWant = t;
+  alarmDirty = true;
+}
+
+// 0.1 ppm as "+1.3" / "-0.4"
+static const char* ppmText(int32_t ppm10, char* buf, size_t len) {
+  unsigned long a = (unsigned long)(ppm10 < 0 ? -ppm10 : ppm10);
+  snprintf(buf, len, "%c%lu.%lu", ppm10 < 0 ? '-' : '+', a / 10, a % 10);
+  return buf;
+}
+
+void RTCModule::logEvent(const DriftEvent& e) {
+  drift.ev[drift.head] = e;
+  drift.head = (uint8_t)((drift.head + 1) % DRIFT_EVENTS);
+  if (drift.count < DRIFT_EVENTS) drift.count++;
+}
+
+bool RTCModule::driftEstimate(int32_t& ppm10, uint32_t& span, uint8_t& samples) const {
+  // Newest back to the last aging change: total offset over total time
+  int64_t off = 0;
+  span = 0;
+  samples = 0;
+  for (uint8_t k = 0; k < drift.count; k++) {
+    const DriftEvent& e = drift.ev[(drift.head + DRIFT_EVENTS - 1 - k) % DRIFT_EVENTS];
+    if (e.kind == DRIFT_TRIM || e.aging != drift.aging) break;
+    if (e.kind != DRIFT_SYNC || !e.interval) continue;
+    off += e.offsetMs;
+    span += e.interval;
+    samples++;
+  }
+  if (!span) return false;
+  // ms per s = 1000 ppm
+  ppm10 = (int32_t)(off * 10000 / (int64_t)span);
+  return true;
+}
+
+void RTCModule::trim(uint32_t now) {
+  int32_t ppm10;
+  uint32_t span;
+  uint8_t samples;
+  if (!drift.autoTrim || !driftEstimate(ppm10, span, samples) || span < DRIFT_TRIM_SPAN_S) return;
+  if (ppm10 > -DRIFT_TRIM_MIN_PPM10 && ppm10 < DRIFT_TRIM_MIN_PPM10) return;
+  // RTC fast (positive) -> more aging -> slower, one LSB per 0.1 ppm
+  int32_t step = ppm10 > DRIFT_TRIM_MAX_STEP ? DRIFT_TRIM_MAX_STEP : ppm10 < -DRIFT_TRIM_MAX_STEP ? -DRIFT_TRIM_MAX_STEP : ppm10;
+  int32_t next = drift.aging + step;
+  int8_t v = (int8_t)(next > 127 ? 127 : next < -127 ? -127 : next);
+  if (v == drift.aging || !setAging(v)) return;
+  logEvent(DriftEvent{now, 0, span, v, DRIFT_TRIM, (int16_t)ppm10});
+  char p[12];
+  Serial.printf("RTC drift %s ppm over %lu h -> aging %d\n", ppmText(ppm10, p, sizeof(p)), (unsigned long)(span / 3600), v);
+}
+
+bool RTCModule::setAging(int8_t v, bool manual) {
+  if (!chipFound) return false;
+  // No bus access here: the loop task would race the I2C task's alarm
+  // read-modify-write of the control register (DS_JOB_AGING in update())
+  drift.aging = v;
+  agingDirty = true;
+  agingRetryAt = millis();
+  if (manual) {
+    logEvent(DriftEvent{epoch(), 0, 0, v, DRIFT_TRIM, 0});
+    saveDrift();
+  }
+  return true;
+}
+
+void RTCModule::setAutoTrim(bool on) {
+  drift.autoTrim = on;
+  saveDrift();
+}
+
+void RTCModule::resetDrift() {
+  drift.head = drift.count = 0;
+  drift.lastPrecise = 0;
+  saveDrift();
+}
+
+void RTCModule::saveDrift() {
+  if (_prefs) _prefs->putBytes("rtcdrift", &drift, sizeof(drift));
+}
+
+void RTCModule::printDrift(Print& out) {
+  int32_t ppm10;
+  uint32_t span;
+  uint8_t samples;
+  char p[12];
+  if (driftEstimate(ppm10, span, samples)) {
+    out.printf("Drift %s ppm over %lu.%lu h (%u samples)", ppmText(ppm10, p, sizeof(p)),
+               (unsigned long)(span / 3600), (unsigned long)(span % 3600 / 360), samples);
+  } else {
+    out.print("Drift: no sample yet (two HOSTTIME syncs >= 6 h apart)");
+  }
+  out.printf(", aging %d%s, auto %s\n", drift.aging, last.aging == drift.aging ? "" : " (register differs)",
+             drift.autoTrim ? "on" : "off");
+  out.printf("Clock: %s, anchors=%lu misses=%lu last slew=%ld ms%s\n",
+             !anchored ? "not set" : phaseKnown ? "edge locked" : "coarse", (unsigned long)anchors,
+             (unsigned long)huntMisses, (long)lastSlewMs, drift.lastPrecise ? "" : ", no precise sync chain");
+  for (uint8_t k = 0; k < drift.count; k++) {
+    const DriftEvent& e = drift.ev[(drift.head + DRIFT_EVENTS - drift.count + k) % DRIFT_EVENTS];
+    char when[TimeCodec::ISO_LEN];
+    TimeCodec::formatIso(e.t, when, sizeof(when));
+    if (e.kind == DRIFT_TRIM) {
+      out.printf("  %s trim   aging -> %d (%s ppm over %lu h)\n", when, e.aging, ppmText(e.ppm10, p, sizeof(p)),
+                 (unsigned long)(e.interval / 3600));
+      continue;
+    }
+    out.printf("  %s %s", when, e.kind == DRIFT_SYNC ? "sync  " : "manual");
+    if (e.offsetMs == DRIFT_NO_OFFSET) out.print(" offset ?");
+    else out.printf(" offset %+ld ms", (long)e.offsetMs);
+    if (e.interval) {
+      int32_t v = (int32_t)((int64_t)e.offsetMs * 10000 / (int64_t)e.interval);
+      out.printf(" / %lu s (%s ppm)", (unsigned long)e.interval, ppmText(v, p, sizeof(p)));
+    }
+    out.printf(" aging %d\n", e.aging);
+  }
 }
@@ -22,35 +22,165 @@
 #pragma once
 
 #include <Arduino.h>
-#include <RTClib.h>
+#include <Preferences.h>
+#include "DS3231Driver.h"
+#include "pin_config.h"
+#include "TimeCodec.h"
 
 enum RTCStatus {
   RTC_OK,
   RTC_NEED_SET
 };
 
+enum DriftEventKind : uint8_t {
+  DRIFT_SYNC,         // precise reference (HOSTTIME with milliseconds)
+  DRIFT_SYNC_MANUAL,  // setrtc: whole seconds, typed by hand
+  DRIFT_TRIM,         // aging register written
+};
+
+// One sync or aging change, kept in NVS ("rtcdrift") for the drift estimate and `drift`
+struct DriftEvent {
+  uint32_t t;         // reference local time
+  int32_t offsetMs;   // sync: RTC minus reference before the set, DRIFT_NO_OFFSET if unknown
+  uint32_t interval;  // sync: seconds since the previous precise sync, 0 = not a drift sample
+                      // trim: span of the estimate
+  int8_t aging;       // aging register in effect (trim: the new value)
+  uint8_t kind;       // DriftEventKind
+  int16_t ppm10;      // trim: estimate that caused it, 0.1 ppm
+};
+
 class RTCModule {
 public:
   RTCModule();
 
+  // Drift log and aging value live in NVS; call before begin()
+  void init(Preferences* prefs);
   bool begin();
+  // Starts/collects DS3231Driver jobs: the second-edge lock once a minute and
+  // a pending set on the reference second boundary; runs in TickModules, no
+  // bus wait in the tick
+  void update();
   RTCStatus status();
 
-  DateTime now();
-  String nowString();
+  // "YYYY-MM-DD HH:MM:SS" into a caller buffer (>= TimeCodec::ISO_LEN), no heap;
+  // 2000-01-01 00:00:00 while the time is not valid
+  void formatNow(char* buf, size_t len);
 
-  void printNow();
-
-  // Diagnostic: whether hardware reports lost power (backup battery)
+  // Diagnostic: whether hardware reports lost power (backup battery), from the last burst read
   bool lostPowerFlag();
+  // Driver metrics plus the last temperature/status/aging read (`rtcstat`)
+  void printStats(Print& out);
+
+  // Plausible RTC time window: 2020-01-01 .. 2035-12-31
+  static const uint32_t EPOCH_MIN = 1577836800UL;
+  static const uint32_t EPOCH_MAX = 2082758400UL;
+
+  // Local time as Unix seconds, 0 if the RTC is not set. Software clock
+  // anchored on the RTC second edge (re-anchored once a minute, differences
+  // below a second are slewed, not stepped), so it does no I2C and never
+  // jumps back.
+  uint32_t epoch();
 
   // HANYA dipanggil manual (menu / serial)
-  bool setNowFromString(const String& s);
+  // Strict "YYYY-MM-DD HH:MM:SS[.mmm]" or "@<unix seconds>[.mmm]" (TimeCodec::parse), 2020-2035.
+  // precise = the text is a machine reference received just now (HOSTTIME):
+  // its offset against the RTC becomes a drift sample.
+  bool setNowFromString(const char* s, bool precise = false);
+  // Set to reference time sec.ms, valid at millis() == atMs
+  void sync(uint32_t sec, uint16_t ms, unsigned long atMs, bool precise);
+
+  // DS3231 alarm 1 on INT/SQW (board input rtc_int), a wake source of the
+  // power manager. Local Unix seconds, 0 = off; written by update() when the
+  // driver is free, only when the time changed.
+  void setAlarm(uint32_t t);
+  // INT is asserted: clear the alarm flag so it can fire again
+  void ackAlarm() { alarmDirty = true; }
+  uint32_t alarm() const { return alarmSet; }
+
+  // Drift since the last aging change: 0.1 ppm (positive = RTC fast) over span seconds.
+  // False while there is no usable sample.
+  bool driftEstimate(int32_t& ppm10, uint32_t& span, uint8_t& samples) const;
+  // DS3231 aging offset, about 0.1 ppm per LSB at 25 C, positive slows the clock.
+  // Written by the I2C task on a later update(); false if there is no DS3231.
+  // manual: logged as a trim, so the estimate restarts from here
+  bool setAging(int8_t v, bool manual = false);
+  void setAutoTrim(bool on);
+  void resetDrift();
+  void printDrift(Print& out);
+
+  static const int32_t DRIFT_NO_OFFSET = INT32_MIN;
+  static const uint8_t DRIFT_EVENTS = 12;
+  // A sync counts as a drift sample after 6 h: 10 ms of edge/tick jitter is then < 0.5 ppm
+  static const uint32_t DRIFT_MIN_INTERVAL_S = 6UL * 3600UL;
+  // Aging is only trimmed from at least a day of samples
+  static const uint32_t DRIFT_TRIM_SPAN_S = 86400UL;
+  static const int16_t DRIFT_TRIM_MIN_PPM10 = 2;
+  static const int8_t DRIFT_TRIM_MAX_STEP = 20;
+  static const unsigned long RESYNC_MS = 60000UL;
+  // A failed register write job is tried again after this long
+  static const unsigned long WRITE_RETRY_MS = 5000UL;
+  static const unsigned long SLEW_WINDOW_MS = 10000UL;
+  // Edge polling starts this long before the second the software clock expects
+  static const unsigned long EDGE_LEAD_MS = 30UL;
 
 private:
-  RTC_DS3231 rtc;
+  DS3231Driver ds;
   RTCStatus rtcStatus;
+  Ds3231Sample last = {};
+  Ds3231Job inFlight = DS_JOB_READ;
+  bool ignoreResult = false;
+  Preferences* _prefs = nullptr;
+
+  // Software clock: baseSec started at millis() == baseMs; slewMs is the
+  // remaining correction, faded out over SLEW_WINDOW_MS from slewStartMs
+  bool anchored = false;
+  bool phaseKnown = false;
+  uint32_t baseSec = 0;
+  unsigned long baseMs = 0;
+  int32_t slewMs = 0;
+  unsigned long slewStartMs = 0;
+
+  // Edge lock (DS_JOB_EDGE) bookkeeping
+  unsigned long huntLastMs = 0;
+  uint32_t anchors = 0;
+  uint32_t huntMisses = 0;
+  int32_t lastSlewMs = 0;
+
+  // Set waiting for the reference second boundary (setStarted: job handed to the driver)
+  bool pendingSet = false;
+  bool setStarted = false;
+
+  // Alarm 1: wanted time, time of the job in flight, time in the chip
+  uint32_t alarmWant = 0;
+  uint32_t alarmJob = 0;
+  uint32_t alarmSet = 0;
+  bool alarmDirty = false;
+  // Last write failed: the next one waits until alarmRetryAt
+  bool alarmRetry = false;
+  unsigned long alarmRetryAt = 0;
+
+  // Aging register write: drift.aging is the wanted value, agingJob the one in flight
+  bool chipFound = false;
+  bool agingDirty = false;
+  int8_t agingJob = 0;
+  unsigned long agingRetryAt = 0;
+
+  struct DriftLog {
+    DriftEvent ev[DRIFT_EVENTS];
+    uint8_t head;        // next write
+    uint8_t count;
+    int8_t aging;        // last written aging value
+    uint8_t autoTrim;
+    uint32_t lastPrecise;  // reference time of the last precise sync, 0 = chain broken
+  };
+  DriftLog drift;
 
-  static const int SDA_PIN = 21;
-  static const int SCL_PIN = 22;
+  int64_t clockMs(unsigned long m) const;
+  void anchor(uint32_t sec, unsigned long atMs, bool smooth);
+  void handleSample(const Ds3231Sample& s, unsigned long ms);
+  void logEvent(const DriftEvent& e);
+  void trim(uint32_t now);
+  void saveDrift();
+  static const int SDA_PIN = PIN_SDA;
+  static const int SCL_PIN = PIN_SCL;
 };
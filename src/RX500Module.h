@@ -1,23 +1,79 @@
 #pragma once
 #include <Arduino.h>
-#include <functional>
 #include "pin_config.h"
 
+// Remote receiver (RX500) input module.
+// Hooks is a type with static handlers, bound at compile time so every edge
+// calls straight into the handler (no std::function, no heap):
+//   struct RemoteHooks {
+//     static void onActivity();     // every rising edge, before the button handler
+//     static void onLock();         // A
+//     static void onUnlock();       // B
+//     static void onStart();        // C
+//     static void onAlarmToggle();  // D
+//   };
+template <typename Hooks>
 class RX500Module {
 public:
-  RX500Module(uint8_t pinA = LEDIN_A, uint8_t pinB = LEDIN_B, uint8_t pinC = LEDIN_C, uint8_t pinD = LEDIN_D);
-  void begin();
-  void update();
-  void setOnLock(std::function<void()> cb);
-  void setOnUnlock(std::function<void()> cb);
-  void setOnStart(std::function<void()> cb);
-  void setOnAlarmToggle(std::function<void()> cb);
+  RX500Module(uint8_t pinA = LEDIN_A, uint8_t pinB = LEDIN_B, uint8_t pinC = LEDIN_C, uint8_t pinD = LEDIN_D)
+    : _pinA(pinA), _pinB(pinB), _pinC(pinC), _pinD(pinD),
+      _lastA(LOW), _lastB(LOW), _lastC(LOW), _lastD(LOW) {}
+
+  // Pins are configured by boardInitPins()
+  void begin() {
+    // read initial state
+    _lastA = digitalRead(_pinA);
+    _lastB = digitalRead(_pinB);
+    _lastC = digitalRead(_pinC);
+    _lastD = digitalRead(_pinD);
+  }
+
+  // Press of input A-D (0-3) seen before begin(), e.g. by the ULP while the
+  // board was parked: handled like a rising edge; a key still held does not
+  // fire again
+  void press(uint8_t i) {
+    Hooks::onActivity();
+    switch (i) {
+      case 0: _lastA = HIGH; Hooks::onLock(); break;
+      case 1: _lastB = HIGH; Hooks::onUnlock(); break;
+      case 2: _lastC = HIGH; Hooks::onStart(); break;
+      case 3: _lastD = HIGH; Hooks::onAlarmToggle(); break;
+    }
+  }
+
+  void update() {
+    int a = digitalRead(_pinA);
+    int b = digitalRead(_pinB);
+    int c = digitalRead(_pinC);
+    int d = digitalRead(_pinD);
+
+    // rising edges
+    if (a == HIGH && _lastA == LOW) {
+      Hooks::onActivity();
+      Hooks::onLock();
+    }
+    _lastA = a;
+
+    if (b == HIGH && _lastB == LOW) {
+      Hooks::onActivity();
+      Hooks::onUnlock();
+    }
+    _lastB = b;
+
+    if (c == HIGH && _lastC == LOW) {
+      Hooks::onActivity();
+      Hooks::onStart();
+    }
+    _lastC = c;
+
+    if (d == HIGH && _lastD == LOW) {
+      Hooks::onActivity();
+      Hooks::onAlarmToggle();
+    }
+    _lastD = d;
+  }
 
 private:
   uint8_t _pinA, _pinB, _pinC, _pinD;
   int _lastA, _lastB, _lastC, _lastD;
-  std::function<void()> _onLock;
-  std::function<void()> _onUnlock;
-  std::function<void()> _onStart;
-  std::function<void()> _onAlarmToggle;
 };
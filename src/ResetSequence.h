@@ -0,0 +1,44 @@
+#pragma once
+#include <Arduino.h>
+#include "OutputArbiter.h"
+#include "Sequencer.h"
+
+extern OutputArbiter outputs;
+extern Sequencer sequencer;
+
+// Second half of resetAll(): the caller cuts IG, starter and alarm at once;
+// ACC, lamp and hazard follow DELAY_MS later (one Sequencer routine).
+// Hooks is bound at compile time:
+//   struct ResetHooks { static void notify(const char* msg); };
+template <typename Hooks>
+class ResetSequence {
+public:
+  static const unsigned long DELAY_MS = 500;
+  // Schedule the delayed half; a pending one starts over
+  void start();
+  bool pending() const { return sequencer.running(seq); }
+private:
+  Sequencer::Handle seq = Sequencer::NONE;
+  static void routine(Seq& s);
+};
+
+template <typename Hooks>
+void ResetSequence<Hooks>::routine(Seq& s) {
+  ResetSequence* self = (ResetSequence*)s.ctx;
+  SEQ_BEGIN(s);
+  SEQ_SLEEP(s, DELAY_MS);
+  self->seq = Sequencer::NONE;
+  outputs.clear(OUT_ACC);
+  outputs.clear(OUT_LAMP);
+  // ensure hazard/alarm off as part of full reset
+  outputs.clear(OUT_HAZARD);
+  Hooks::notify("ALL OFF");
+  Serial.println("Reset sequence: ACC and other outputs turned off");
+  SEQ_END(s);
+}
+
+template <typename Hooks>
+void ResetSequence<Hooks>::start() {
+  sequencer.cancel(seq);
+  seq = sequencer.spawn(routine, this, "reset");
+}
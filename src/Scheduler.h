@@ -0,0 +1,230 @@
+#pragma once
+#include <Arduino.h>
+#include <Preferences.h>
+#include "TimeCodec.h"
+
+class RTCModule;
+
+// Weekly schedule: up to SCHEDULE_SLOTS entries of (days-of-week mask, HH:MM,
+// action, argument), stored in NVS ("sched"). Each slot's next fire time is
+// kept as local Unix seconds in a min-heap, so a tick costs one comparison
+// of RTCModule::epoch() against the heap head.
+// The last fire time per slot is stored too ("schedlast"): after a reboot
+// inside the firing minute the slot does not fire again. A fire that is more
+// than SCHEDULE_GRACE_S late (RTC set forward, board off) is skipped.
+static const uint8_t SCHEDULE_SLOTS = 8;
+static const uint32_t SCHEDULE_GRACE_S = 60;
+
+enum ScheduleAction : uint8_t {
+  SCHED_OFF,
+  SCHED_WARM,   // arg = warm-up minutes, 0 = warmlen setting
+  SCHED_MACRO,  // arg = macro slot
+};
+
+struct ScheduleSlot {
+  uint8_t days;      // bit per weekday, bit0 = Sunday (TimeCodec::weekday())
+  uint8_t hour;
+  uint8_t minute;
+  uint8_t action;    // ScheduleAction
+  uint16_t arg;
+};
+
+// First time >= from and > after on a day in s.days at s.hour:s.minute, 0 if none
+inline uint32_t scheduleNextFire(const ScheduleSlot& s, uint32_t from, uint32_t after) {
+  if (s.action == SCHED_OFF || !(s.days & 0x7F)) return 0;
+  // Start from the later bound: counting from `from` alone, a weekly 00:00
+  // slot with `from` just before midnight and `after` on the next day ran
+  // out of days before its next week
+  uint32_t first = from > after ? from : after + 1;
+  uint32_t day = first - first % 86400UL;
+  uint32_t tod = s.hour * 3600UL + s.minute * 60UL;
+  for (uint8_t d = 0; d < 8; d++, day += 86400UL) {
+    uint32_t t = day + tod;
+    if (t >= first && (s.days & (1 << TimeCodec::weekday(t)))) return t;
+  }
+  return 0;
+}
+
+// Min-heap of slot indices keyed by their next fire time
+struct ScheduleHeap {
+  uint8_t idx[SCHEDULE_SLOTS];
+  uint8_t count = 0;
+
+  void clear() { count = 0; }
+  uint8_t top() const { return idx[0]; }
+  void push(uint8_t i, const uint32_t* key) {
+    uint8_t c = count++;
+    while (c > 0) {
+      uint8_t p = (c - 1) / 2;
+      if (key[idx[p]] <= key[i]) break;
+      idx[c] = idx[p];
+      c = p;
+    }
+    idx[c] = i;
+  }
+  uint8_t pop(const uint32_t* key) {
+    uint8_t first = idx[0];
+    uint8_t last = idx[--count];
+    uint8_t c = 0;
+    for (;;) {
+      uint8_t l = 2 * c + 1;
+      if (l >= count) break;
+      if (l + 1 < count && key[idx[l + 1]] < key[idx[l]]) l++;
+      if (key[last] <= key[idx[l]]) break;
+      idx[c] = idx[l];
+      c = l;
+    }
+    idx[c] = last;
+    return first;
+  }
+};
+
+// Hooks is bound at compile time:
+//   struct SchedHooks {
+//     static void warm(uint16_t minutes);
+//     static void macro(uint8_t slot);
+//   };
+// Clock only needs uint32_t epoch() (0 = not set); the host test passes a
+// virtual one instead of the RTC.
+template <typename Hooks, typename Clock = RTCModule>
+class Scheduler {
+public:
+  void init(Clock* rtc, Preferences* prefs) {
+    _rtc = rtc;
+    _prefs = prefs;
+  }
+
+  // Load slots (default: daily warm-up at 15:31) and last fire times
+  void begin() {
+    if (_prefs->isKey("sched")) {
+      _prefs->getBytes("sched", slots, sizeof(slots));
+    } else {
+      memset(slots, 0, sizeof(slots));
+      slots[0] = ScheduleSlot{0x7F, 15, 31, SCHED_WARM, 0};
+    }
+    memset(last, 0, sizeof(last));
+    if (_prefs->isKey("schedlast")) _prefs->getBytes("schedlast", last, sizeof(last));
+    rebuild();
+  }
+
+  void update() {
+    if (!built) {
+      // RTC not valid yet
+      if (millis() - lastTry < 10000UL) return;
+      rebuild();
+      if (!built) return;
+    }
+    if (!heap.count) return;
+    uint32_t now = _rtc->epoch();
+    if (now < next[heap.top()]) return;
+    while (heap.count && now >= next[heap.top()]) {
+      uint8_t i = heap.pop(next);
+      uint32_t t = next[i];
+      if (now - t < SCHEDULE_GRACE_S) {
+        last[i] = t;
+        _prefs->putBytes("schedlast", last, sizeof(last));
+        fires++;
+        fire(i);
+      } else {
+        skipped++;
+        Serial.printf("Schedule %u: missed by %lu s, skipped\n", i + 1, (unsigned long)(now - t));
+      }
+      next[i] = scheduleNextFire(slots[i], now - (SCHEDULE_GRACE_S - 1), last[i]);
+      if (next[i]) heap.push(i, next);
+    }
+  }
+
+  // Recompute every next fire time (after boot, RTC set, slot change)
+  void rebuild() {
+    lastTry = millis();
+    heap.clear();
+    uint32_t now = _rtc->epoch();
+    built = now != 0;
+    if (!built) return;
+    for (uint8_t i = 0; i < SCHEDULE_SLOTS; i++) {
+      next[i] = scheduleNextFire(slots[i], now - (SCHEDULE_GRACE_S - 1), last[i]);
+      if (next[i]) heap.push(i, next);
+    }
+  }
+
+  const ScheduleSlot& slot(uint8_t i) const { return slots[i]; }
+  void setSlot(uint8_t i, const ScheduleSlot& s) {
+    slots[i] = s;
+    _prefs->putBytes("sched", slots, sizeof(slots));
+    rebuild();
+  }
+  uint32_t nextFire(uint8_t i) const { return built ? next[i] : 0; }
+  // Earliest next fire of any slot, 0 = none (RTC alarm for the power manager)
+  uint32_t nextAny() const { return built && heap.count ? next[heap.top()] : 0; }
+
+  // Replay the heap over `days` days on a virtual clock: checks every fire
+  // lands on a mask day at HH:MM, in order, once per slot and day.
+  // Returns the number of fires, errors in *errors.
+  uint32_t simulate(uint32_t start, uint16_t days, uint32_t* errors) const {
+    uint32_t key[SCHEDULE_SLOTS];
+    uint32_t prev[SCHEDULE_SLOTS];
+    ScheduleHeap h;
+    for (uint8_t i = 0; i < SCHEDULE_SLOTS; i++) {
+      prev[i] = 0;
+      key[i] = scheduleNextFire(slots[i], start, 0);
+      if (key[i]) h.push(i, key);
+    }
+    uint32_t end = start + days * 86400UL;
+    uint32_t count = 0, bad = 0, clock = start;
+    while (h.count && key[h.top()] < end) {
+      uint8_t i = h.pop(key);
+      uint32_t t = key[i];
+      const ScheduleSlot& s = slots[i];
+      if (t < clock || t % 86400UL != s.hour * 3600UL + s.minute * 60UL ||
+          !(s.days & (1 << TimeCodec::weekday(t))) || (prev[i] && t / 86400UL == prev[i] / 86400UL)) {
+        bad++;
+      }
+      clock = prev[i] = t;
+      count++;
+      key[i] = scheduleNextFire(s, t + 1, t);
+      if (key[i]) h.push(i, key);
+    }
+    *errors = bad;
+    return count;
+  }
+
+  void print(Print& out) const {
+    static const char DAYS[] = "SMTWTFS";
+    for (uint8_t i = 0; i < SCHEDULE_SLOTS; i++) {
+      const ScheduleSlot& s = slots[i];
+      if (s.action == SCHED_OFF) continue;
+      char mask[8];
+      for (uint8_t d = 0; d < 7; d++) mask[d] = (s.days & (1 << d)) ? DAYS[d] : '-';
+      mask[7] = '\0';
+      out.printf("%u: %s %02u:%02u %s %u", i + 1, mask, s.hour, s.minute,
+                 s.action == SCHED_WARM ? "warm" : "macro", s.arg);
+      if (nextFire(i)) {
+        char when[TimeCodec::ISO_LEN];
+        TimeCodec::formatIso(nextFire(i), when, sizeof(when));
+        out.printf(", next %s\n", when);
+      } else {
+        out.println(built ? ", no next" : ", RTC not set");
+      }
+    }
+    out.printf("Fired=%lu skipped=%lu\n", (unsigned long)fires, (unsigned long)skipped);
+  }
+
+private:
+  Clock* _rtc = nullptr;
+  Preferences* _prefs = nullptr;
+  ScheduleSlot slots[SCHEDULE_SLOTS];
+  uint32_t last[SCHEDULE_SLOTS];
+  uint32_t next[SCHEDULE_SLOTS];
+  ScheduleHeap heap;
+  bool built = false;
+  unsigned long lastTry = 0;
+  uint32_t fires = 0;
+  uint32_t skipped = 0;
+
+  void fire(uint8_t i) {
+    const ScheduleSlot& s = slots[i];
+    Serial.printf("Schedule %u fired (%s %u)\n", i + 1, s.action == SCHED_WARM ? "warm" : "macro", s.arg);
+    if (s.action == SCHED_WARM) Hooks::warm(s.arg);
+    else if (s.action == SCHED_MACRO) Hooks::macro((uint8_t)s.arg);
+  }
+};
@@ -0,0 +1,89 @@
+#include "Sequencer.h"
+
+Sequencer::Sequencer() : nextWake(0), active(0), peak(0), resumes(0), spawnFails(0) {
+  for (uint8_t i = 0; i < POOL; i++) frames[i] = Seq{nullptr, nullptr, "", 0, 0, false, false, 0};
+}
+
+Sequencer::Handle Sequencer::spawn(void (*fn)(Seq&), void* ctx, const char* name) {
+  uint8_t i = 0;
+  while (i < POOL && frames[i].used) i++;
+  if (i == POOL) {
+    spawnFails++;
+    Serial.printf("Sequencer: no free frame for %s\n", name);
+    return NONE;
+  }
+  Seq& s = frames[i];
+  s.fn = fn;
+  s.ctx = ctx;
+  s.name = name;
+  s.line = 0;
+  if (++s.gen == 0) s.gen = 1;
+  s.used = true;
+  s.done = false;
+  active++;
+  if (active > peak) peak = active;
+  Handle h = handleOf(s);
+  step(s);
+  refreshWake();
+  return running(h) ? h : NONE;
+}
+
+Seq* Sequencer::frame(Handle h) const {
+  uint8_t i = h & 0xFF;
+  if (h == NONE || i >= POOL) return nullptr;
+  const Seq& s = frames[i];
+  if (!s.used || handleOf(s) != h) return nullptr;
+  return const_cast<Seq*>(&s);
+}
+
+void Sequencer::cancel(Handle h) {
+  Seq* s = frame(h);
+  if (!s) return;
+  s->used = false;
+  active--;
+  refreshWake();
+}
+
+// Resume s once; free the frame when the routine ran to its end
+void Sequencer::step(Seq& s) {
+  Handle h = handleOf(s);
+  resumes++;
+  s.fn(s);
+  // The routine may have cancelled itself (e.g. via resetAll())
+  if (frame(h) && s.done) {
+    s.used = false;
+    active--;
+  }
+}
+
+void Sequencer::refreshWake() {
+  bool any = false;
+  for (uint8_t i = 0; i < POOL; i++) {
+    if (!frames[i].used) continue;
+    if (!any || (long)(frames[i].wakeAt - nextWake) < 0) nextWake = frames[i].wakeAt;
+    any = true;
+  }
+}
+
+void Sequencer::update() {
+  if (!active) return;
+  unsigned long now = millis();
+  if ((long)(now - nextWake) < 0) return;
+  for (uint8_t i = 0; i < POOL; i++) {
+    Seq& s = frames[i];
+    if (s.used && (long)(now - s.wakeAt) >= 0) step(s);
+  }
+  refreshWake();
+}
+
+void Sequencer::print(Print& out) const {
+  unsigned long now = millis();
+  for (uint8_t i = 0; i < POOL; i++) {
+    const Seq& s = frames[i];
+    if (!s.used) continue;
+    long left = (long)(s.wakeAt - now);
+    out.printf("%-8s wakes in %ld ms (line %u)\n", s.name, left > 0 ? left : 0L, s.line);
+  }
+  out.printf("Frames: %u/%u in use, peak %u, resumes=%lu, spawn failures=%lu\n",
+             active, POOL, peak, (unsigned long)resumes, (unsigned long)spawnFails);
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <Arduino.h>
+
+// Timed sequences (start, warm-up, reset) written as linear routines:
+//
+//   static void run(Seq& s) {
+//     SEQ_BEGIN(s);
+//     outputs.request(OUT_IG, SRC_WARM, true);
+//     SEQ_SLEEP(s, 1000);
+//     outputs.pulse(OUT_STARTER, SRC_WARM, 1000);
+//     SEQ_END(s);
+//   }
+//
+// A routine runs until SEQ_SLEEP, returns, and is resumed after the sleep
+// at the statement following it (stackless, switch on the resume line;
+// the toolchain is GCC 8, without C++20 coroutines). Locals do not survive
+// a sleep: keep state in the owner (Seq::ctx) and do not put SEQ_SLEEP
+// inside a switch statement of the routine.
+// Frames come from a fixed pool in Sequencer, no heap. Sleeping routines
+// cost nothing per tick: update() returns at once until the earliest wake
+// time. cancel() drops a routine at its current sleep; the owner cleans up.
+struct Seq {
+  void (*fn)(Seq&);
+  void* ctx;                 // owner object, for member access from fn
+  const char* name;
+  uint16_t line;             // resume point, 0 = start
+  uint8_t gen;               // bumped on every reuse of the frame, never 0
+  bool used;
+  bool done;
+  unsigned long wakeAt;
+
+  void sleepFor(unsigned long ms) { wakeAt = millis() + ms; }
+  void sleepUntil(unsigned long t) { wakeAt = t; }
+};
+
+#define SEQ_BEGIN(s)  switch ((s).line) { case 0:
+#define SEQ_SLEEP(s, ms) \
+  do { (s).sleepFor(ms); (s).line = __LINE__; return; case __LINE__:; } while (0)
+#define SEQ_SLEEP_UNTIL(s, t) \
+  do { (s).sleepUntil(t); (s).line = __LINE__; return; case __LINE__:; } while (0)
+#define SEQ_END(s)    default:; } (s).done = true
+
+class Sequencer {
+public:
+  // Handle of a running routine; NONE = spawn failed / not running
+  typedef uint16_t Handle;
+  static const Handle NONE = 0;
+  static const uint8_t POOL = 6;
+
+  Sequencer();
+  // Runs fn at once up to its first sleep. Returns NONE if the pool is full
+  // (or fn already finished).
+  Handle spawn(void (*fn)(Seq&), void* ctx, const char* name);
+  // Drop the routine; stale handles (finished, reused frame) are ignored
+  void cancel(Handle h);
+  bool running(Handle h) const { return frame(h) != nullptr; }
+  // Any routine running (power manager: keeps the fast tick)
+  bool busy() const { return active != 0; }
+  void update();
+  void print(Print& out) const;
+
+private:
+  Seq frames[POOL];
+  unsigned long nextWake;
+  uint8_t active;            // frames in use
+  uint8_t peak;
+  uint32_t resumes;
+  uint32_t spawnFails;
+
+  Seq* frame(Handle h) const;
+  Handle handleOf(const Seq& s) const { return (Handle)((s.gen << 8) | (&s - frames)); }
+  void step(Seq& s);
+  void refreshWake();
+};
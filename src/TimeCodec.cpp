@@ -0,0 +1,104 @@
+#include "TimeCodec.h"
+
+namespace TimeCodec {
+
+CivilTime toCivil(uint32_t t) {
+  CivilTime c;
+  uint32_t days = t / 86400UL;
+  uint32_t sec = t % 86400UL;
+  civilFromDays((int32_t)days, c.year, c.month, c.day);
+  c.hour = (uint8_t)(sec / 3600);
+  c.minute = (uint8_t)(sec / 60 % 60);
+  c.second = (uint8_t)(sec % 60);
+  c.weekday = (uint8_t)((days + 4) % 7);
+  return c;
+}
+
+// n decimal digits at s, false on any non-digit
+static bool digits(const char* s, uint8_t n, unsigned& v) {
+  v = 0;
+  for (uint8_t i = 0; i < n; i++) {
+    unsigned c = (unsigned)(uint8_t)s[i] - '0';
+    if (c > 9) return false;
+    v = v * 10 + c;
+  }
+  return true;
+}
+
+bool parseIso(const char* s, uint32_t& out) {
+  unsigned y, mo, d, h, mi, se;
+  if (!digits(s, 4, y) || s[4] != '-' || !digits(s + 5, 2, mo) || s[7] != '-' || !digits(s + 8, 2, d) ||
+      (s[10] != ' ' && s[10] != 'T') || !digits(s + 11, 2, h) || s[13] != ':' || !digits(s + 14, 2, mi) ||
+      s[16] != ':' || !digits(s + 17, 2, se) || s[19] != '\0') {
+    return false;
+  }
+  if (y < 1970 || y > 2105 || mo < 1 || mo > 12 || d < 1 || d > daysInMonth(y, mo) || h > 23 || mi > 59 ||
+      se > 59) {
+    return false;
+  }
+  out = (uint32_t)daysFromCivil((int)y, mo, d) * 86400UL + h * 3600UL + mi * 60UL + se;
+  return true;
+}
+
+bool parseEpoch(const char* s, uint32_t& out) {
+  uint64_t v = 0;
+  uint8_t n = 0;
+  for (; s[n]; n++) {
+    unsigned c = (unsigned)(uint8_t)s[n] - '0';
+    if (c > 9 || n >= 10) return false;
+    v = v * 10 + c;
+  }
+  if (n == 0 || v > 0xFFFFFFFFULL) return false;
+  out = (uint32_t)v;
+  return true;
+}
+
+bool parse(const char* s, uint32_t& out) {
+  if (s[0] == '@') return parseEpoch(s + 1, out);
+  return parseIso(s, out);
+}
+
+bool parse(const char* s, uint32_t& out, uint16_t& ms) {
+  ms = 0;
+  const char* dot = strrchr(s, '.');
+  if (!dot) return parse(s, out);
+  size_t head = (size_t)(dot - s);
+  size_t n = strlen(dot + 1);
+  unsigned frac;
+  char buf[24];
+  if (n < 1 || n > 3 || head >= sizeof(buf) || !digits(dot + 1, (uint8_t)n, frac)) return false;
+  memcpy(buf, s, head);
+  buf[head] = '\0';
+  if (!parse(buf, out)) return false;
+  ms = (uint16_t)(n == 1 ? frac * 100 : n == 2 ? frac * 10 : frac);
+  return true;
+}
+
+static inline void put2(char* p, unsigned v) {
+  p[0] = (char)('0' + v / 10);
+  p[1] = (char)('0' + v % 10);
+}
+
+size_t formatIso(uint32_t t, char* buf, size_t len) {
+  if (len < ISO_LEN) {
+    if (len) buf[0] = '\0';
+    return 0;
+  }
+  CivilTime c = toCivil(t);
+  put2(buf, c.year / 100);
+  put2(buf + 2, c.year % 100);
+  buf[4] = '-';
+  put2(buf + 5, c.month);
+  buf[7] = '-';
+  put2(buf + 8, c.day);
+  buf[10] = ' ';
+  put2(buf + 11, c.hour);
+  buf[13] = ':';
+  put2(buf + 14, c.minute);
+  buf[16] = ':';
+  put2(buf + 17, c.second);
+  buf[19] = '\0';
+  return ISO_LEN - 1;
+}
+
+}  // namespace TimeCodec
@@ -0,0 +1,73 @@
+#pragma once
+#include <Arduino.h>
+
+// Local time as 32-bit Unix seconds (no time zone, the RTC keeps local time).
+// Valid range 1970-01-01 .. 2106-02-07. Conversions use the days-from-civil /
+// civil-from-days algorithms (March-based year, no month tables, no loops),
+// parsing is strict and formatting writes into a caller buffer, no String.
+struct CivilTime {
+  uint16_t year;
+  uint8_t month;    // 1-12
+  uint8_t day;      // 1-31
+  uint8_t hour;
+  uint8_t minute;
+  uint8_t second;
+  uint8_t weekday;  // 0 = Sunday
+};
+
+namespace TimeCodec {
+
+// "YYYY-MM-DD HH:MM:SS" + NUL
+static const size_t ISO_LEN = 20;
+
+// Days since 1970-01-01 of a valid date (year >= 1970)
+inline int32_t daysFromCivil(int y, unsigned m, unsigned d) {
+  y -= m <= 2;
+  const int era = (y >= 0 ? y : y - 399) / 400;
+  const unsigned yoe = (unsigned)(y - era * 400);                        // [0, 399]
+  const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;   // [0, 365]
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;            // [0, 146096]
+  return era * 146097 + (int32_t)doe - 719468;
+}
+
+inline void civilFromDays(int32_t z, uint16_t& y, uint8_t& m, uint8_t& d) {
+  z += 719468;
+  const int32_t era = (z >= 0 ? z : z - 146096) / 146097;
+  const unsigned doe = (unsigned)(z - era * 146097);
+  const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  const unsigned mp = (5 * doy + 2) / 153;
+  d = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+  m = (uint8_t)(mp < 10 ? mp + 3 : mp - 9);
+  y = (uint16_t)(yoe + era * 400 + (m <= 2));
+}
+
+inline bool isLeap(unsigned y) { return (y % 4 == 0) && (y % 100 != 0 || y % 400 == 0); }
+
+inline uint8_t daysInMonth(unsigned y, unsigned m) {
+  // bit m of 0x15AA set = 31-day month
+  return m == 2 ? (isLeap(y) ? 29 : 28) : (uint8_t)(30 + ((0x15AA >> m) & 1));
+}
+
+// 1970-01-01 was a Thursday
+inline uint8_t weekday(uint32_t t) { return (uint8_t)((t / 86400UL + 4) % 7); }
+
+inline uint32_t fromCivil(const CivilTime& c) {
+  return (uint32_t)daysFromCivil(c.year, c.month, c.day) * 86400UL + c.hour * 3600UL + c.minute * 60UL + c.second;
+}
+
+CivilTime toCivil(uint32_t t);
+
+// Strict "YYYY-MM-DD HH:MM:SS" (or 'T' separator): exact digit counts, real
+// calendar day (no Feb 31), year 1970-2105, nothing after the seconds.
+bool parseIso(const char* s, uint32_t& out);
+// Decimal Unix seconds, digits only, must fit 32 bit
+bool parseEpoch(const char* s, uint32_t& out);
+// ISO form, or epoch seconds prefixed with '@' ("@1767225600")
+bool parse(const char* s, uint32_t& out);
+// Same, with an optional ".d", ".dd" or ".ddd" fraction of a second in ms
+bool parse(const char* s, uint32_t& out, uint16_t& ms);
+// "YYYY-MM-DD HH:MM:SS" into buf (len >= ISO_LEN); returns chars written, 0 if too small
+size_t formatIso(uint32_t t, char* buf, size_t len);
+
+}  // namespace TimeCodec
@@ -0,0 +1,67 @@
+#include "Transport.h"
+#include "BLEModule.h"
+#include "CommandEngine.h"
+
+/* ===== StreamTransport ===== */
+
+void StreamTransport::poll(CommandEngine& engine) {
+  for (int budget = RX_BUDGET; budget > 0 && stream.available(); budget--) {
+    switch (rxLine.feed((char)stream.read())) {
+      case LineAssembler::LINE:
+        // Dispatch straight from the assembler's buffer
+        if (!lineHook || !lineHook(rxLine.line(), rxLine.length(), *this)) {
+          engine.dispatch(rxLine.line(), rxLine.length(), *this);
+        }
+        break;
+      case LineAssembler::OVERFLOW:
+        overflowCount++;
+        printf("LINE TOO LONG (max %d)\n", CMD_LINE_MAX);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+/* ===== BLETransport ===== */
+
+bool BLETransport::receive(const char* data, size_t len) {
+  if (rxPending) {
+    droppedCount++;
+    return false;
+  }
+  if (len > RX_MAX) len = RX_MAX;
+  memcpy(rx, data, len);
+  rx[len] = '\0';
+  rxLen = len;
+  rxPending = true;
+  return true;
+}
+
+void BLETransport::poll(CommandEngine& engine) {
+  if (!rxPending) return;
+  engine.dispatch(rx, rxLen, *this);
+  flush();
+  rxPending = false;
+}
+
+size_t BLETransport::write(uint8_t c) {
+  if (c == '\r') return 1;
+  if (c == '\n') {
+    flush();
+    return 1;
+  }
+  tx[txLen++] = (char)c;
+  if (txLen == CHUNK) {
+    flush();
+    // give the stack time to send before the next chunk of the same line
+    delay(5);
+  }
+  return 1;
+}
+
+void BLETransport::flush() {
+  if (txLen == 0) return;
+  ble.notify(tx, txLen);
+  txLen = 0;
+}
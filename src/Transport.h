@@ -0,0 +1,66 @@
+#pragma once
+
+#include <Arduino.h>
+#include "LineAssembler.h"
+
+class BLEModule;
+class CommandEngine;
+
+// A command source and its reply sink. Replies are written with the usual
+// Print API (print/println/printf) and only go back to this transport.
+class Transport : public Print {
+public:
+  virtual const char* name() const = 0;
+  // Called from loop(): hand every complete received line to the engine
+  virtual void poll(CommandEngine& engine) = 0;
+};
+
+// USB Serial or Bluetooth Classic SPP (BluetoothSerial): any Arduino Stream.
+// poll() only consumes bytes that are already buffered, never blocks.
+class StreamTransport : public Transport {
+public:
+  // Return true if the line was consumed and must not reach the engine
+  using LineHook = bool (*)(char* line, size_t len, Transport& from);
+  // Max bytes taken from the stream per poll(), bounds the time spent per tick
+  static const int RX_BUDGET = 256;
+
+  StreamTransport(Stream& stream, const char* label) : stream(stream), label(label) {}
+  const char* name() const override { return label; }
+  void setLineHook(LineHook hook) { lineHook = hook; }
+  void poll(CommandEngine& engine) override;
+  size_t write(uint8_t c) override { return stream.write(c); }
+  size_t write(const uint8_t* buf, size_t size) override { return stream.write(buf, size); }
+  uint32_t overflows() const { return overflowCount; }
+private:
+  Stream& stream;
+  const char* label;
+  LineAssembler rxLine;
+  LineHook lineHook = nullptr;
+  uint32_t overflowCount = 0;
+};
+
+// BLE characteristic: writes arrive in the BT task and are parked in a fixed
+// buffer until loop() polls; replies go out as notifications split to the
+// 20-byte default ATT payload.
+class BLETransport : public Transport {
+public:
+  static const size_t RX_MAX = CMD_LINE_MAX;
+  static const size_t CHUNK = 20;
+
+  BLETransport(BLEModule& ble) : ble(ble) {}
+  const char* name() const override { return "ble"; }
+  // BT task: store one command; returns false if the previous one is still queued
+  bool receive(const char* data, size_t len);
+  void poll(CommandEngine& engine) override;
+  size_t write(uint8_t c) override;
+  void flush() override;
+  uint32_t dropped() const { return droppedCount; }
+private:
+  BLEModule& ble;
+  char rx[RX_MAX + 1];
+  volatile size_t rxLen = 0;
+  volatile bool rxPending = false;
+  volatile uint32_t droppedCount = 0;
+  char tx[CHUNK];
+  size_t txLen = 0;
+};
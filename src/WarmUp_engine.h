@@ -1,31 +1,153 @@
 #pragma once
 #include <Arduino.h>
 #include <Preferences.h>
-#include <functional>
-#include "RTCModule.h"
+#include "OutputArbiter.h"
+#include "Sequencer.h"
 
+extern OutputArbiter outputs;
+extern Sequencer sequencer;
+
+// Scheduled (Scheduler) / forced warm-up: IG on, starter after 1 s, everything
+// off after the warm duration (one Sequencer routine). Hooks is bound at compile time:
+//   struct WarmHooks {
+//     static void setEngine(bool on);
+//     static void notify(const char* msg);   // BLE status line
+//   };
+template <typename Hooks>
 class WarmUpEngine {
 public:
   WarmUpEngine();
-  void init(RTCModule* rtc, Preferences* prefs, std::function<void(bool)> engineSetter);
+  void init(Preferences* prefs);
   void begin();
-  void update();
   void forceWarm();
+  // Start from a schedule slot; minutes 0 = the warmlen setting
+  void scheduledWarm(int minutes);
   void cancelWarm();
+  // Warm reset recovery: continue for remainingMs with IG on and no new
+  // starter pulse (never crank again after a reset, it may have been the
+  // starter's brownout). Called again with the corrected time it restarts.
+  void resume(unsigned long remainingMs);
   void setDurationMinutes(int m);
-  int getDurationMinutes() const;
-  bool isActive() const;
-  unsigned long remainingMillis() const;
+  int getDurationMinutes() const { return warmDurationMinutes; }
+  bool isActive() const { return warmActive; }
+  unsigned long remainingMillis() const { if (!warmActive) return 0; if (warmEnd > millis()) return warmEnd - millis(); return 0; }
 private:
-  RTCModule* _rtc;
   Preferences* _prefs;
-  std::function<void(bool)> _engineSetter;
   bool warmActive;
+  bool resumed;
   unsigned long warmEnd;
-  bool warmStarterPending;
-  unsigned long warmStarterAt;
-  int lastWarmDay;
+  Sequencer::Handle warmSeq;
   int warmDurationMinutes;
-  bool rtcTimePlausible() const;
-  DateTime rtcSafeNow() const;
+  void startWarm(const char* why, int minutes);
+  static void warmRoutine(Seq& s);
 };
+
+template <typename Hooks>
+WarmUpEngine<Hooks>::WarmUpEngine()
+  : _prefs(nullptr), warmActive(false), resumed(false), warmEnd(0), warmSeq(Sequencer::NONE), warmDurationMinutes(10) {}
+
+template <typename Hooks>
+void WarmUpEngine<Hooks>::init(Preferences* prefs) {
+  _prefs = prefs;
+}
+
+template <typename Hooks>
+void WarmUpEngine<Hooks>::begin() {
+  if (_prefs) {
+    warmDurationMinutes = _prefs->getInt("warmlen", warmDurationMinutes);
+    Serial.printf("Warm duration loaded: %d minutes\n", warmDurationMinutes);
+  }
+}
+
+template <typename Hooks>
+void WarmUpEngine<Hooks>::warmRoutine(Seq& s) {
+  WarmUpEngine* self = (WarmUpEngine*)s.ctx;
+  SEQ_BEGIN(s);
+  outputs.request(OUT_IG, SRC_WARM, true);
+  if (!self->resumed) {
+    SEQ_SLEEP(s, 1000);
+    if (!outputs.isOn(OUT_STARTER) && outputs.pulse(OUT_STARTER, SRC_WARM, 1000)) {
+      Hooks::setEngine(true);
+      Serial.println("Warm-up: STARTER pulse started (1s)");
+      Hooks::notify("STARTER ON");
+    }
+  }
+  SEQ_SLEEP_UNTIL(s, self->warmEnd);
+  // Finish warm period
+  self->warmActive = false;
+  self->warmSeq = Sequencer::NONE;
+  outputs.clear(OUT_ACC);
+  outputs.clear(OUT_IG);
+  outputs.clear(OUT_STARTER);
+  Hooks::setEngine(false);
+  outputs.clear(OUT_LAMP);
+  outputs.clear(OUT_ALARM);
+  Hooks::notify("WARM DONE");
+  Serial.println("Warm-up complete: systems turned off (pesawat unaffected)");
+  SEQ_END(s);
+}
+
+template <typename Hooks>
+void WarmUpEngine<Hooks>::startWarm(const char* why, int minutes) {
+  resumed = false;
+  warmActive = true;
+  warmEnd = millis() + ((unsigned long)minutes * 60UL * 1000UL);
+  warmSeq = sequencer.spawn(warmRoutine, this, "warm");
+  if (warmSeq == Sequencer::NONE) {
+    warmActive = false;
+    return;
+  }
+  Hooks::notify("WARM ON");
+  Serial.printf("Warm-up %s: IG_ON, starter in 1s, duration %d min\n", why, minutes);
+}
+
+template <typename Hooks>
+void WarmUpEngine<Hooks>::forceWarm() {
+  if (!warmActive) {
+    startWarm("forced", warmDurationMinutes);
+  } else {
+    Serial.println("Warm-up already active");
+  }
+}
+
+template <typename Hooks>
+void WarmUpEngine<Hooks>::scheduledWarm(int minutes) {
+  if (warmActive) {
+    Serial.println("Warm-up already active, schedule skipped");
+    return;
+  }
+  startWarm("scheduled", minutes > 0 ? minutes : warmDurationMinutes);
+}
+
+template <typename Hooks>
+void WarmUpEngine<Hooks>::cancelWarm() {
+  warmActive = false;
+  sequencer.cancel(warmSeq);
+  warmSeq = Sequencer::NONE;
+  outputs.release(OUT_IG, SRC_WARM);
+}
+
+template <typename Hooks>
+void WarmUpEngine<Hooks>::resume(unsigned long remainingMs) {
+  if (warmActive) cancelWarm();
+  resumed = true;
+  warmActive = true;
+  warmEnd = millis() + remainingMs;
+  warmSeq = sequencer.spawn(warmRoutine, this, "warm");
+  if (warmSeq == Sequencer::NONE) {
+    warmActive = false;
+    return;
+  }
+  Serial.printf("Warm-up resumed: %lu s left, IG_ON\n", remainingMs / 1000UL);
+}
+
+template <typename Hooks>
+void WarmUpEngine<Hooks>::setDurationMinutes(int m) {
+  if (m >= 1 && m <= 60) {
+    warmDurationMinutes = m;
+    if (_prefs) _prefs->putInt("warmlen", warmDurationMinutes);
+    Serial.printf("Warm duration set to %d minutes (saved)\n", warmDurationMinutes);
+  } else {
+    Serial.println("Invalid minutes (1-60)");
+  }
+}
@@ -11,19 +11,48 @@
 #include "ButtonTombol.h"
 #include <Wire.h>
 #include <Preferences.h>
-#include <algorithm>
 #include <cctype>
 #include "WarmUp_engine.h"
 #include "Door_control.h"
+#include "Transport.h"
+#include "CommandEngine.h"
+#include "HeapMonitor.h"
+#include "BootTrace.h"
+#include "HotState.h"
+#include "PowerManager.h"
+#include "ParkingMode.h"
+#include "ModuleList.h"
+#include "OutputArbiter.h"
+#include "BoardPins.h"
+#include "PatternPlayer.h"
+#include "LedcModulator.h"
+#include "Sequencer.h"
+#include "ResetSequence.h"
+#include "MacroVM.h"
+#include "Scheduler.h"
+#ifdef ENABLE_SPP
+#include <BluetoothSerial.h>
+#endif
 
-// Change these UUIDs as needed (use full 128-bit UUIDs for App Inventor)
-static BLEUUID SERVICE_UUID("12345678-1234-1234-1234-123456789abc");
-static BLEUUID CHARACTERISTIC_UUID("abcdefab-1234-5678-1234-abcdefabcdef");
+// Service/characteristic UUIDs are defined in BLEBackend.h (BLE_SERVICE_UUID,
+// BLE_CHAR_UUID); change them there (use full 128-bit UUIDs for App Inventor)
 
 // Serial baud: default 115200. You can change at runtime by typing `b9600` or
 // `b115200` on the Serial Console within the first 3 seconds after reset.
 static const uint32_t DEFAULT_BAUD = 115200;
 static uint32_t serialBaud = DEFAULT_BAUD;
+static const unsigned long BAUD_WINDOW_MS = 3000;
+static unsigned long baudWindowUntil = 0;
+
+// Boot log lines are queued here instead of waiting on the UART FIFO
+static const size_t SERIAL_TX_BUFFER = 2048;
+
+// Loop work-time budget (one control tick) and measured worst case
+static const unsigned long LOOP_BUDGET_US = 10000;
+static unsigned long loopMaxUs = 0;
+static unsigned long loopOverruns = 0;
+static unsigned long loopTicks = 0;
+static unsigned long long loopTotalUs = 0;
 
 // LED pin turned on when a BLE central connects. Change if your board uses
 // a different built-in LED pin.
@@ -34,94 +63,90 @@ static uint32_t serialBaud = DEFAULT_BAUD;
 static bool isConnected = false;
 // Whether we've received HOSTTIME from the host
 static bool hostTimeSynced = false;
-// Lock state and pulse control to operate the solenoid safely
-static bool locked = false; // true when lock is engaged
-static bool pulseActive = false;
-static int pulsePin = -1;
-static unsigned long pulseEnd = 0;
-
-// variables for BLE command processing
-// ===== Remote input edge detection (latch trigger) =====
-static int lastInA = LOW;
-static int lastInIg = LOW;
-static int lastInStarter = LOW;
-static int lastInAlarm = LOW;
-
-// Misc states for other commands
-static bool accOn = false;
-static bool igOn = false;
+// Misc states for other commands (output levels live in OutputArbiter)
 static bool engineOn = false; // starter pulse
-static bool alarmOn = false;
-static bool lampOn = false;
-
-// Starter pulse control (non-blocking)
-bool starterActive = false;
-unsigned long starterEnd = 0;
-// Start_the_Car composite command flags
-static volatile bool startCarPending = false;
-static volatile unsigned long startCarAt = 0;
-// start sequence stage: 0 = waiting for IG, 1 = waiting for STARTER
-static volatile int startCarStage = 0;
-
-// resetAll delayed turn-off
-static bool resetPending = false;
-static unsigned long resetAt = 0;
-
-// Alarm blink control (non-blocking)
-static bool alarmStateHigh = false;
-static unsigned long alarmNextToggle = 0;
-// Pesawat (indicator) control when locked
-static bool pesawatOn = false;
-static bool pesawatStateHigh = false;
-static unsigned long pesawatNextToggle = 0;
-
-// Hazzard & pesawat control (non-blocking)
-static bool hazardActive = false;
-static bool hazardLockedMode = false; // true=LOCK, false=UNLOCK
-static int hazardStep = 0;
-static unsigned long hazardNext = 0;
-static bool hazardAlarmMode = false; // true = continuous blinking
+
+// CPU cycles of the last resetAll() output work (see outstat)
+static uint32_t resetCycles = 0;
 
 // Preferences (NVS) to persist settings
 static Preferences prefs;
 
 BLEModule ble;
 RTCModule rtc;
-RX500Module rx500;
-ButtonTombol buttonTombol(18, PIN_LED_POWER); // button pin 18, LED_POWER on PIN_LED_POWER (GPIO13)
-WarmUpEngine warmEngine;
+// Owns every output pin; modules request levels through it
+OutputArbiter outputs;
+// LEDC channels shared by pattern offload and output hold PWM
+LedcModulator ledc;
+// Hazard/alarm/pesawat/LED blink patterns (LEDC where possible)
+PatternPlayer patterns;
+// Timed sequences: start (button), warm-up, reset
+Sequencer sequencer;
+// Stored command macros (macro command), run on the control tick
+MacroVM macroVm;
+static const uint8_t MACRO_SLOTS = 4;
+// Macro slot per remote button A-D (0 = default action), "macremote" in NVS
+static uint8_t remoteMacro[4] = {0, 0, 0, 0};
+// Module event handlers, bound at compile time (defined below resetAll())
+struct RemoteHooks {
+  static void onActivity();
+  static void onLock();
+  static void onUnlock();
+  static void onStart();
+  static void onAlarmToggle();
+};
+struct ButtonHooks {
+  static void onPress();
+  static void onReset();
+  static void setEngine(bool on);
+};
+struct WarmHooks {
+  static void setEngine(bool on);
+  static void notify(const char* msg);
+};
+struct ResetHooks {
+  static void notify(const char* msg);
+};
+struct SchedHooks {
+  static void warm(uint16_t minutes);
+  static void macro(uint8_t slot);
+};
+RX500Module<RemoteHooks> rx500;
+ButtonTombol<ButtonHooks> buttonTombol(PIN_BUTTON); // button + LED_POWER from the board profile
+WarmUpEngine<WarmHooks> warmEngine;
+// resetAll delayed turn-off (Sequencer routine)
+static ResetSequence<ResetHooks> resetSequence;
+// Weekly schedule slots (warm-up, macros)
+Scheduler<SchedHooks> scheduler;
 DoorControl doorControl;
+HeapMonitor heapMonitor;
+// Boot phase timestamps (bootstat); BLE comes up in bootBleTask
+BootTrace bootTrace;
+// Lock/alarm/engine/warm-up mirrored in RTC memory across warm resets (hotstate)
+static HotStateStore hotState;
+static HotState restoredState = {};
+static bool hotRestored = false;
+// Blocking tick wait, esp_pm clock/light sleep, wake sources (pm)
+static PowerManager power;
+// Deep sleep with ULP input watch after a configurable idle time (park)
+static ParkingMode parking;
+// Lead the DS3231 alarm needs over a deep sleep: boot, RTC read, schedule
+static const uint32_t PARK_MIN_LEAD_S = 120;
 
-// Normalize incoming command string to lowercase (preserve underscores)
-static std::string normalizeCmd(const std::string &s) {
-  std::string r = s;
-  // trim leading/trailing spaces
-  while (!r.empty() && std::isspace((unsigned char)r.front())) r.erase(r.begin());
-  while (!r.empty() && std::isspace((unsigned char)r.back())) r.pop_back();
-  std::transform(r.begin(), r.end(), r.begin(), [](unsigned char c){ return std::tolower(c); });
-  return r;
-}
-
-// BLE notifications are limited by ATT MTU (commonly 20 bytes payload).
-// Split longer messages into 20-byte chunks so the app receives the full text.
-static void bleNotifyChunks(const std::string &s) {
-  const size_t CHUNK = 20;
-  for (size_t i = 0; i < s.size(); i += CHUNK) {
-    std::string part = s.substr(i, CHUNK);
-    ble.notify(part);
-    delay(5);
-  }
-}
-
+// Everything loop() ticks, in order; the beacon is built right after
+using TickModules = ModuleList<ble, rtc, outputs, sequencer, patterns, doorControl, scheduler, rx500, buttonTombol, macroVm>;
+// CPU cycles spent in TickModules::update() (see loopstat)
+static uint32_t tickCyclesMax = 0;
+static unsigned long long tickCyclesTotal = 0;
 
-
-// Pretty-print command for serial output: uppercase and replace '_' with ' '
-static String prettyCmd(const std::string &s) {
-  std::string r = s;
-  std::transform(r.begin(), r.end(), r.begin(), [](unsigned char c){ return std::toupper(c); });
-  for (auto &c : r) if (c == '_') c = ' ';
-  return String(r.c_str());
-}
+// Command transports: replies go back only to the transport a command came from
+static StreamTransport serialTransport(Serial, "serial");
+static BLETransport bleTransport(ble);
+#ifdef ENABLE_SPP
+// Bluetooth Classic SPP (Bluedroid dual mode); bulk-friendly byte stream
+static BluetoothSerial SerialBT;
+static StreamTransport sppTransport(SerialBT, "spp");
+#endif
 
 // Set engine state and notify DoorControl and button module
 void setEngineState(bool on) {
@@ -132,279 +157,855 @@ void setEngineState(bool on) {
 
 // Reset all outputs/state (called from remote or other flows)
 void resetAll() {
+  uint32_t c0 = ESP.getCycleCount();
   // Immediately turn off IG, starter and alarm; schedule ACC off after 500ms
-  digitalWrite(PIN_IG, LOW); igOn = false;
-  digitalWrite(PIN_STARTER, LOW); starterActive = false;
-  digitalWrite(PIN_ALARM, LOW); alarmOn = false; alarmStateHigh = false;
+  outputs.clear(OUT_IG);
+  outputs.clear(OUT_STARTER);
+  outputs.clear(OUT_ALARM);
   setEngineState(false);
-  // Cancel any pending start/warm operations
-  startCarPending = false; startCarStage = 0;
+  // Cancel any running start/warm sequence
+  buttonTombol.cancelStart();
   warmEngine.cancelWarm();
   // Cancel door pulses/hazard
   doorControl.cancelAll();
-  // Schedule ACC and other outputs off after 500ms
-  resetPending = true;
-  resetAt = millis() + 500;
-  ble.notify(std::string("RESET ALL SCHEDULED"));
+  resetCycles = ESP.getCycleCount() - c0;
+  // Schedule ACC and other outputs off after 500ms (restarts a pending one)
+  resetSequence.start();
+  ble.notify("RESET ALL SCHEDULED");
   Serial.println("Action: RESET_ALL scheduled (IG OFF now, ACC OFF in 500ms)");
 }
 
-void setup() {
-  Serial.begin(serialBaud);
-  delay(10);
-  Serial.println("Starting BLE peripheral...");
-  // Initialize preferences and load warm duration
-  prefs.begin("settings", false);
-  // initialize WarmUp engine and Door control
-  warmEngine.init(&rtc, &prefs, [](bool v){ setEngineState(v); });
-  warmEngine.begin();
-  doorControl.begin();
-  // Load saved button countdown (ms) if present
-  int savedBtnCd = prefs.getInt("btncd", 15000);
-  buttonTombol.setCountdownMs((unsigned long)savedBtnCd);
-  Serial.printf("Button countdown loaded: %d ms\n", savedBtnCd);
+static bool runMacro(uint8_t slot, Print& out);
 
-  // Allow a short window to change baud by typing e.g. "b9600" or "b115200"
-  Serial.println("Type 'b9600' or 'b115200' within 3s to change baud.");
-  unsigned long t0 = millis();
-  while (millis() - t0 < 3000) {
-    if (Serial.available()) {
-      String s = Serial.readStringUntil('\n');
-      s.trim();
-      if (s.length() > 1 && s.charAt(0) == 'b') {
-        uint32_t nb = s.substring(1).toInt();
-        if (nb >= 300 && nb <= 2000000) {
-          serialBaud = nb;
-          Serial.begin(serialBaud);
-          Serial.print("Baud changed to "); Serial.println(serialBaud);
-          break;
-        }
-      }
+// Remote button bound to a macro (macro bind): run it instead of the default action
+static bool remoteRunsMacro(uint8_t button) {
+  if (!remoteMacro[button]) return false;
+  runMacro(remoteMacro[button], Serial);
+  return true;
+}
+
+void RemoteHooks::onActivity() {
+  bootTrace.mark(BOOT_FIRST_INPUT);
+  ble.advBurst();
+}
+void RemoteHooks::onLock() {
+  if (remoteRunsMacro(0)) return;
+  doorControl.lockPulse();
+}
+void RemoteHooks::onUnlock() {
+  if (remoteRunsMacro(1)) return;
+  doorControl.unlockPulse();
+}
+void RemoteHooks::onStart() {
+  if (remoteRunsMacro(2)) return;
+  if (!engineOn) {
+    // use same flow as button to start with countdown
+    buttonTombol.triggerStart();
+    ble.notify("START THE CAR SCHEDULED");
+    Serial.print("Remote: "); Serial.println("START THE CAR triggered (countdown active)");
+  } else {
+    resetAll();
+  }
+}
+void RemoteHooks::onAlarmToggle() {
+  if (remoteRunsMacro(3)) return;
+  doorControl.toggleAlarm();
+}
+
+void ButtonHooks::onPress() {
+  bootTrace.mark(BOOT_FIRST_INPUT);
+  ble.advBurst();
+}
+void ButtonHooks::onReset() { resetAll(); }
+void ButtonHooks::setEngine(bool on) { setEngineState(on); }
+
+void WarmHooks::setEngine(bool on) { setEngineState(on); }
+void WarmHooks::notify(const char* msg) { ble.notify(msg); }
+void ResetHooks::notify(const char* msg) { ble.notify(msg); }
+
+void SchedHooks::warm(uint16_t minutes) { warmEngine.scheduledWarm(minutes); }
+void SchedHooks::macro(uint8_t slot) { runMacro(slot, Serial); }
+
+/* ===== Commands (shared by BLE, USB serial and SPP) ===== */
+
+// Commands that stall or abort the firmware, or could lock the phone out:
+// only from the USB serial console (cable attached), never over BLE or SPP
+static bool consoleOnly(Transport& from, const char* what) {
+  if (&from == &serialTransport) return true;
+  from.printf("ERR %s: USB serial only\n", what);
+  return false;
+}
+
+static void cmdAccOn(char*, Transport& from) {
+  outputs.request(OUT_ACC, SRC_COMMAND, true);
+  from.println("ACC ON");
+  Serial.print("Action: "); Serial.println("ACC ON");
+}
+
+static void cmdAccOff(char*, Transport& from) {
+  outputs.clear(OUT_ACC);
+  from.println("ACC OFF");
+  Serial.print("Action: "); Serial.println("ACC OFF");
+}
+
+static void cmdIgOn(char*, Transport& from) {
+  outputs.request(OUT_IG, SRC_COMMAND, true);
+  from.println("IGNITION ON");
+  Serial.print("Action: "); Serial.println("IG ON");
+}
+
+static void cmdIgOff(char*, Transport& from) {
+  outputs.clear(OUT_IG);
+  from.println("IGNITION OFF");
+  Serial.print("Action: "); Serial.println("IG OFF");
+}
+
+// Composite command: Start_the_Car -> same flow as the physical button
+static void cmdStartTheCar(char*, Transport& from) {
+  // Prevent duplicate starts: ignore if engine already on, starter active, or pending
+  if (engineOn || outputs.isOn(OUT_STARTER)) {
+    from.println("ENGINE ALREADY ON");
+    Serial.println("Ignored START_THE_CAR (engine on or start pending)");
+    return;
+  }
+  // Trigger the same start flow as the physical button (starts countdown)
+  buttonTombol.triggerStart();
+  from.println("START THE CAR");
+  Serial.print("Action: "); Serial.println("START THE CAR triggered (countdown active)");
+}
+
+// STARTER (pulse 1000ms, only while IG is on)
+static void cmdStarterOn(char*, Transport& from) {
+  if (!outputs.isOn(OUT_IG)) {
+    from.println("STARTER BLOCKED (IG OFF)");
+    Serial.println("Ignored STARTER_ON (interlock: IG off)");
+  } else if (!outputs.isOn(OUT_STARTER)) {
+    outputs.pulse(OUT_STARTER, SRC_COMMAND, 1000);
+    setEngineState(true);
+    from.println("STARTER ON");
+    Serial.print("Action: "); Serial.println("STARTER ON");
+  } else {
+    from.println("IGNORED STARTER ON");
+    Serial.println("Ignored STARTER_ON (already active)");
+  }
+}
+
+static void cmdAlarmOn(char*, Transport&) { doorControl.setAlarm(true); }
+static void cmdAlarmOff(char*, Transport&) { doorControl.setAlarm(false); }
+
+static void cmdLampOn(char*, Transport& from) {
+  outputs.request(OUT_LAMP, SRC_COMMAND, true);
+  from.println("LAMP ON");
+  Serial.print("Action: "); Serial.println("LAMP ON");
+}
+
+static void cmdLampOff(char*, Transport& from) {
+  outputs.clear(OUT_LAMP);
+  from.println("LAMP OFF");
+  Serial.print("Action: "); Serial.println("LAMP OFF");
+}
+
+static void cmdResetAll(char*, Transport&) { resetAll(); }
+static void cmdLock(char*, Transport&) { doorControl.lockPulse(); }
+static void cmdUnlock(char*, Transport&) { doorControl.unlockPulse(); }
+static void cmdWarm(char*, Transport&) { warmEngine.forceWarm(); }
+
+// btncd <ms> -> set ButtonTombol countdown window in milliseconds
+static void cmdBtnCd(char* arg, Transport& from) {
+  if (*arg == '\0') {
+    from.println("BTNCD USAGE");
+    Serial.println("Usage: btncd [ms]  (e.g. btncd 20000)");
+    return;
+  }
+  char* end;
+  unsigned long v = strtoul(arg, &end, 10);
+  if (end == arg || *end != '\0') {
+    from.println("BTNCD PARSE ERROR");
+    Serial.println("BTNCD parse error");
+  } else if (v >= 5000 && v <= 60000) {
+    buttonTombol.setCountdownMs(v);
+    prefs.putInt("btncd", (int)v);
+    from.println("BUTTON COUNTDOWN SET");
+    Serial.printf("Button countdown set to %lu ms\n", v);
+  } else {
+    from.println("BTNCD INVALID RANGE");
+    Serial.println("BTNCD invalid range (use 5000-60000 ms)");
+  }
+}
+
+// setrtc YYYY-MM-DD HH:MM:SS ('now' / compile time is refused)
+static void cmdSetRtc(char* arg, Transport& from) {
+  if (*arg == '\0' || strcasecmp(arg, "now") == 0) {
+    from.println("RTC SET DECLINED");
+    Serial.println("Refusing to set RTC to compile-time or 'now'. Use: setrtc YYYY-MM-DD HH:MM:SS or send HOSTTIME from host.");
+    return;
+  }
+  if (rtc.setNowFromString(arg)) {
+    scheduler.rebuild();
+    from.println("RTC SET");
+    char now[TimeCodec::ISO_LEN];
+    rtc.formatNow(now, sizeof(now));
+    Serial.print("RTC: "); Serial.println(now);
+    from.println(now);
+  } else {
+    from.println("RTC SET FAILED");
+    Serial.println("Invalid datetime format. Use: setrtc YYYY-MM-DD HH:MM:SS (or @<unix seconds>), 2020-2035");
+  }
+}
+
+// HOSTTIME YYYY-MM-DD HH:MM:SS[.mmm] (reply of host_time_responder.py to GETTIME);
+// a machine reference, so it also feeds the RTC drift estimate
+static void cmdHostTime(char* arg, Transport& from) {
+  if (*arg != '\0' && rtc.setNowFromString(arg, true)) {
+    scheduler.rebuild();
+    Serial.println("RTC set from host");
+    char now[TimeCodec::ISO_LEN];
+    rtc.formatNow(now, sizeof(now));
+    from.print("RTC: "); from.println(now);
+  } else {
+    from.println("Invalid HOSTTIME format");
+  }
+}
+
+static void cmdRtc(char*, Transport& from) {
+  char now[TimeCodec::ISO_LEN];
+  rtc.formatNow(now, sizeof(now));
+  from.print("RTC: "); from.println(now);
+}
+
+// Phone time over BLE (Current Time Service). Every applied sync is a drift
+// log entry, so a phone that connects many times a day only sets the RTC when
+// it is not valid, off by CTS_STEP_S or more, or CTS_RESYNC_S after the last
+// phone sync. Offsets within CTS_PRECISE_MS count as a precise reference.
+static const uint32_t CTS_STEP_S = 2;
+static const uint32_t CTS_RESYNC_S = RTCModule::DRIFT_MIN_INTERVAL_S;
+static const uint16_t CTS_PRECISE_MS = 20;
+static uint32_t ctsLastSync = 0;
+static uint32_t ctsApplied = 0;
+
+static void applyPeerTime(const PeerTime& pt) {
+  if (!pt.ok) {
+    Serial.println(pt.samples ? "CTS: phone time inconsistent, ignored" : "CTS: phone has no Current Time Service");
+    return;
+  }
+  unsigned long now = millis();
+  int64_t ref = (int64_t)pt.sec * 1000 + pt.ms + (long)(now - pt.atMs);
+  uint32_t sec = (uint32_t)(ref / 1000);
+  if (sec < RTCModule::EPOCH_MIN || sec > RTCModule::EPOCH_MAX) {
+    Serial.println("CTS: phone time out of range, ignored");
+    return;
+  }
+  bool wasValid = rtc.status() == RTC_OK;
+  uint32_t cur = rtc.epoch();
+  uint32_t diff = cur > sec ? cur - sec : sec - cur;
+  if (wasValid && cur && diff < CTS_STEP_S && ctsLastSync && sec - ctsLastSync < CTS_RESYNC_S) {
+    Serial.printf("CTS: RTC agrees with phone (+-%u ms), not set\n", pt.errMs);
+    return;
+  }
+  rtc.sync(sec, (uint16_t)(ref % 1000), now, pt.errMs <= CTS_PRECISE_MS);
+  scheduler.rebuild();
+  ctsLastSync = sec;
+  ctsApplied++;
+  char when[TimeCodec::ISO_LEN];
+  rtc.formatNow(when, sizeof(when));
+  Serial.printf("CTS: RTC set from phone %s (+-%u ms, %u samples, rtt %u-%u ms)\n", when, pt.errMs, pt.samples,
+                pt.rttMinMs, pt.rttMaxMs);
+  if (!wasValid) Serial.printf("CTS: clock valid %lu ms after connect\n", pt.readyMs);
+}
+
+// cts | cts on|off: read the phone's Current Time Service on connect (saved)
+static void cmdCts(char* arg, Transport& from) {
+  if (strcasecmp(arg, "on") == 0 || strcasecmp(arg, "off") == 0) {
+    bool on = strcasecmp(arg, "on") == 0;
+    ble.setPeerTimeSync(on);
+    prefs.putInt("ctssync", on ? 1 : 0);
+    from.printf("CTS SYNC %s\n", on ? "ON" : "OFF");
+  } else if (*arg == '\0') {
+    ble.printPeerTimeStats(from);
+    from.printf("  RTC set from phone: %lu\n", (unsigned long)ctsApplied);
+  } else {
+    from.println("Use: cts | cts on|off");
+  }
+}
+
+// DS3231 bus metrics: per-transaction latency (burst/poll/write), errors, edge lock
+static void cmdRtcStat(char*, Transport& from) {
+  rtc.printStats(from);
+}
+
+// drift | drift reset | drift auto on|off | drift aging <-127..127>
+static void cmdDrift(char* arg, Transport& from) {
+  char sub[8] = "", val[8] = "";
+  int aging = 0;
+  sscanf(arg, "%7s %7s", sub, val);
+  bool agingOk = sscanf(arg, "%*s %d", &aging) == 1 && aging >= -127 && aging <= 127;
+  if (!*sub) {
+    rtc.printDrift(from);
+  } else if (strcasecmp(sub, "reset") == 0) {
+    rtc.resetDrift();
+    from.println("DRIFT RESET");
+  } else if (strcasecmp(sub, "auto") == 0 && (strcasecmp(val, "on") == 0 || strcasecmp(val, "off") == 0)) {
+    rtc.setAutoTrim(strcasecmp(val, "on") == 0);
+    from.printf("DRIFT AUTO %s\n", strcasecmp(val, "on") == 0 ? "ON" : "OFF");
+  } else if (strcasecmp(sub, "aging") == 0 && agingOk) {
+    if (rtc.setAging((int8_t)aging, true)) from.printf("DRIFT AGING %d\n", aging);
+    else from.println("DRIFT AGING FAILED (RTC not found)");
+  } else {
+    from.println("Use: drift | drift reset | drift auto on|off | drift aging <-127..127>");
+  }
+}
+
+// timetest: TimeCodec round trip for every day 2020-2099 (days <-> civil,
+// format -> parse at a varying time of day) and parse/format/convert rates
+static void cmdTimeTest(char*, Transport& from) {
+  uint32_t days = 0, errors = 0;
+  char buf[TimeCodec::ISO_LEN];
+  unsigned long t0 = micros();
+  int32_t first = TimeCodec::daysFromCivil(2020, 1, 1);
+  int32_t end = TimeCodec::daysFromCivil(2100, 1, 1);
+  for (int32_t z = first; z < end; z++, days++) {
+    uint16_t y;
+    uint8_t m, d;
+    TimeCodec::civilFromDays(z, y, m, d);
+    if (TimeCodec::daysFromCivil(y, m, d) != z || d > TimeCodec::daysInMonth(y, m)) errors++;
+    uint32_t t = (uint32_t)z * 86400UL + (days * 7919UL) % 86400UL, back = 0;
+    TimeCodec::formatIso(t, buf, sizeof(buf));
+    if (!TimeCodec::parseIso(buf, back) || back != t) errors++;
+  }
+  unsigned long roundTripUs = micros() - t0;
+  from.printf("Round trip 2020-2099: %lu days, %lu errors, %lu us\n", (unsigned long)days,
+              (unsigned long)errors, roundTripUs);
+
+  const uint32_t N = 10000;
+  uint32_t base = TimeCodec::fromCivil(CivilTime{2026, 1, 1, 0, 0, 0, 0});
+  volatile uint32_t sink = 0;
+  t0 = micros();
+  for (uint32_t i = 0; i < N; i++) sink += TimeCodec::toCivil(base + i * 9973UL).day;
+  unsigned long convUs = micros() - t0;
+  t0 = micros();
+  for (uint32_t i = 0; i < N; i++) sink += TimeCodec::formatIso(base + i * 9973UL, buf, sizeof(buf));
+  unsigned long fmtUs = micros() - t0;
+  uint32_t v = 0;
+  t0 = micros();
+  for (uint32_t i = 0; i < N; i++) sink += TimeCodec::parseIso(buf, v);
+  unsigned long parseUs = micros() - t0;
+  from.printf("Per second: convert %lu, format %lu, parse %lu\n",
+              (unsigned long)(N * 1000000ULL / (convUs ? convUs : 1)),
+              (unsigned long)(N * 1000000ULL / (fmtUs ? fmtUs : 1)),
+              (unsigned long)(N * 1000000ULL / (parseUs ? parseUs : 1)));
+}
+
+static void cmdI2cScan(char*, Transport& from) {
+  from.println("I2C scan start");
+  Wire.begin();
+  for (uint8_t addr = 1; addr < 127; ++addr) {
+    Wire.beginTransmission(addr);
+    if (Wire.endTransmission() == 0) {
+      from.print("Found I2C device at 0x"); from.println(addr, HEX);
     }
   }
+  from.println("I2C scan done");
+}
 
-  pinMode(LED_PIN, OUTPUT);
-  digitalWrite(LED_PIN, LOW);
-  pinMode(PIN_LOCK, OUTPUT);
-  pinMode(PIN_UNLOCK, OUTPUT);
-  pinMode(PIN_HAZZARD, OUTPUT);
-  // engine/lighting pins
-  pinMode(PIN_ACC, OUTPUT);
-  pinMode(PIN_IG, OUTPUT);
-  pinMode(PIN_STARTER, OUTPUT);
-  pinMode(PIN_LAMP, OUTPUT);
-  pinMode(PIN_ALARM, OUTPUT);
-  digitalWrite(PIN_LOCK, LOW);
-  digitalWrite(PIN_UNLOCK, LOW);
-  digitalWrite(PIN_HAZZARD, LOW);
-  digitalWrite(PIN_ACC, LOW);
-  digitalWrite(PIN_IG, LOW);
-  digitalWrite(PIN_STARTER, LOW);
-  digitalWrite(PIN_LAMP, LOW);
-  digitalWrite(PIN_ALARM, LOW);
-  // Pesawat indicator default off
-  pinMode(PIN_PESAWAT, OUTPUT);
-  digitalWrite(PIN_PESAWAT, LOW);
-
-  // Remote control inputs (433MHz RX580) - mapped to A/B/C/D
-  pinMode(LEDIN_A, INPUT);
-  pinMode(LEDIN_B, INPUT);
-  pinMode(LEDIN_C, INPUT);
-  pinMode(LEDIN_D, INPUT);
+// "daily", "weekdays", "weekend" or a list such as "mon,wed,fri" -> bit per weekday (bit0 = Sunday)
+static uint8_t parseDays(const char* s) {
+  static const char* const NAMES[7] = {"sun", "mon", "tue", "wed", "thu", "fri", "sat"};
+  if (strcasecmp(s, "daily") == 0) return 0x7F;
+  if (strcasecmp(s, "weekdays") == 0) return 0x3E;
+  if (strcasecmp(s, "weekend") == 0) return 0x41;
+  uint8_t mask = 0;
+  while (*s) {
+    uint8_t d = 0;
+    while (d < 7 && strncasecmp(s, NAMES[d], 3) != 0) d++;
+    if (d == 7) return 0;
+    mask |= 1 << d;
+    s += 3;
+    if (*s == ',') s++;
+    else if (*s) return 0;
+  }
+  return mask;
+}
 
-  Serial.print("Using serial baud: "); Serial.println(serialBaud);
+// sched                                           -> slots and next fire times
+// sched set <n> <days> <HH:MM> warm [minutes]     -> warm-up (minutes 0/empty = warmlen)
+// sched set <n> <days> <HH:MM> macro <slot>       -> run a stored macro
+// sched del <n> | sched sim [days]
+static void cmdSched(char* arg, Transport& from) {
+  char sub[6] = "", days[32] = "", action[8] = "";
+  int n = 0, hh = -1, mm = -1, a = 0;
+  int got = sscanf(arg, "%5s %d %31s %d:%d %7s %d", sub, &n, days, &hh, &mm, action, &a);
+  bool slotOk = n >= 1 && n <= SCHEDULE_SLOTS;
+  if (!*sub) {
+    scheduler.print(from);
+  } else if (strcasecmp(sub, "set") == 0 && slotOk && got >= 6) {
+    uint8_t mask = parseDays(days);
+    bool warm = strcasecmp(action, "warm") == 0;
+    bool macro = strcasecmp(action, "macro") == 0;
+    if (!mask || hh < 0 || hh > 23 || mm < 0 || mm > 59 || (!warm && !macro) ||
+        (warm && (a < 0 || a > 60)) || (macro && (got < 7 || a < 1 || a > MACRO_SLOTS))) {
+      from.println("Usage: sched set <n> <daily|weekdays|weekend|mon,tue,..> <HH:MM> <warm [0-60]|macro <1-4>>");
+      return;
+    }
+    scheduler.setSlot(n - 1, ScheduleSlot{mask, (uint8_t)hh, (uint8_t)mm,
+                                          (uint8_t)(warm ? SCHED_WARM : SCHED_MACRO), (uint16_t)a});
+    scheduler.print(from);
+  } else if (strcasecmp(sub, "del") == 0 && slotOk) {
+    scheduler.setSlot(n - 1, ScheduleSlot{0, 0, 0, SCHED_OFF, 0});
+    from.printf("Schedule %d deleted\n", n);
+  } else if (strcasecmp(sub, "sim") == 0) {
+    // n = days (default one year) from the RTC time, or 2026-01-01 without RTC
+    uint16_t simDays = (n >= 1 && n <= 3660) ? n : 365;
+    uint32_t start = rtc.epoch();
+    if (!start) start = TimeCodec::fromCivil(CivilTime{2026, 1, 1, 0, 0, 0, 0});
+    uint32_t errors = 0;
+    unsigned long t0 = micros();
+    uint32_t count = scheduler.simulate(start, simDays, &errors);
+    from.printf("Sim %u days: %lu fires, %lu errors, %lu us\n", simDays, (unsigned long)count,
+                (unsigned long)errors, micros() - t0);
+  } else {
+    from.println("Usage: sched [set <n> <days> <HH:MM> <warm [min]|macro <m>> | del <n> | sim [days]]");
+  }
+}
 
-  // Initialize RTC
-  rtc.begin();
+static void cmdWarmLen(char* arg, Transport& from) {
+  if (*arg != '\0') {
+    warmEngine.setDurationMinutes(atoi(arg));
+  }
+  from.printf("Warm duration: %d minutes\n", warmEngine.getDurationMinutes());
+}
 
-  // Initialize RX500 remote handler and register callbacks
-  rx500.begin();
-  rx500.setOnLock([&](){ doorControl.lockPulse(); });
-  rx500.setOnUnlock([&](){ doorControl.unlockPulse(); });
-  rx500.setOnStart([&]() {
-    if (!engineOn) {
-      // use same flow as button to start with countdown
-      buttonTombol.triggerStart();
-      ble.notify(std::string("START THE CAR SCHEDULED"));
-      Serial.print("Remote: "); Serial.println(prettyCmd("start_the_car") + " triggered (countdown active)");
+static void cmdBleStat(char*, Transport& from) {
+  ble.printStats(from);
+  from.printf("BLE rx dropped (busy): %lu\n", (unsigned long)bleTransport.dropped());
+}
+
+// bleclear: forget every bonded phone (USB serial only)
+static void cmdBleClear(char*, Transport& from) {
+  if (!consoleOnly(from, "bleclear")) return;
+  if (!ble.isReady()) {
+    from.println("ERR bleclear: BLE not ready");
+    return;
+  }
+  ble.clearBonds();
+  from.println("OK bonds cleared");
+}
+static void cmdAdvStat(char*, Transport& from) { ble.printAdvStats(from); }
+
+// advcfg <fast_ms> <slow_ms> <burst_ms> -> saved, applied after reboot
+static void cmdAdvCfg(char* arg, Transport& from) {
+  int fastMs = 0, slowMs = 0;
+  long burstMs = 0;
+  if (sscanf(arg, "%d %d %ld", &fastMs, &slowMs, &burstMs) == 3 &&
+      fastMs >= 20 && slowMs >= fastMs && slowMs <= 10240 && burstMs >= 0) {
+    prefs.putInt("advfast", fastMs);
+    prefs.putInt("advslow", slowMs);
+    prefs.putInt("advburst", (int)burstMs);
+    from.printf("Advertising policy saved: fast=%d slow=%d burst=%ld ms (reboot to apply)\n", fastMs, slowMs, burstMs);
+  } else {
+    from.println("Usage: advcfg <fast_ms 20..> <slow_ms ..10240> <burst_ms>");
+  }
+}
+
+// Round-trip probe for host_transport_bench.py
+static void cmdPing(char*, Transport& from) { from.println("PONG"); }
+
+// Worst-case / average work time of one loop() tick against LOOP_BUDGET_US
+static void cmdLoopStat(char*, Transport& from) {
+  from.printf("Loop: ticks=%lu avg=%luus max=%luus budget=%luus overruns=%lu\n",
+              loopTicks, loopTicks ? (unsigned long)(loopTotalUs / loopTicks) : 0UL,
+              loopMaxUs, LOOP_BUDGET_US, loopOverruns);
+  from.printf("Modules: avg=%lu cycles max=%lu cycles\n",
+              loopTicks ? (unsigned long)(tickCyclesTotal / loopTicks) : 0UL,
+              (unsigned long)tickCyclesMax);
+  from.printf("Serial lines too long: %lu\n", (unsigned long)serialTransport.overflows());
+  loopMaxUs = 0;
+  tickCyclesMax = 0;
+}
+
+// Warm reset snapshot: last restore, write count, mirrored state
+static void cmdHotState(char*, Transport& from) { hotState.print(from); }
+
+// Boot phase timestamps: time to input handling and to advertising
+static void cmdBootStat(char*, Transport& from) { bootTrace.print(from); }
+
+// Why the board may not deep-sleep now, nullptr = it may. Every load output
+// has to be off: held pads keep the inactive level only
+static const char* parkBlocker() {
+  static const Output LOADS[] = {OUT_ACC, OUT_IG, OUT_STARTER, OUT_LAMP, OUT_ALARM, OUT_LOCK, OUT_UNLOCK, OUT_HAZARD};
+  if (!bootTrace.reached(BOOT_DONE)) return "booting";
+  if (isConnected) return "BLE connected";
+  if (engineOn || warmEngine.isActive()) return "engine/warm-up running";
+  if (doorControl.isAlarmOn()) return "alarm on";
+  for (Output o : LOADS) {
+    if (outputs.isOn(o)) return "output on";
+  }
+  if (sequencer.busy() || macroVm.running() || buttonTombol.busy()) return "sequence running";
+  uint32_t next = scheduler.nextAny();
+  if (rtc.alarm() != next) return "RTC alarm not set yet";
+  uint32_t now = rtc.epoch();
+  if (next && (!now || next < now + PARK_MIN_LEAD_S)) return "schedule slot due";
+  if (digitalRead(PIN_RTC_INT) == LOW) return "RTC alarm pending";
+  for (uint8_t i = IN_REMOTE_A; i <= IN_REMOTE_D; i++) {
+    if (digitalRead(BOARD.in[i].gpio) == HIGH) return "remote input active";
+  }
+  return nullptr;
+}
+
+// park | park <minutes> (0 = off) | park now: deep-sleep parking
+// Parking turns BLE off until the next wake, so only the status is open to
+// every transport; changing it needs the USB console
+static void cmdPark(char* arg, Transport& from) {
+  unsigned int m = 0;
+  if (strcasecmp(arg, "now") == 0) {
+    if (!consoleOnly(from, "park now")) return;
+    const char* blocker = parkBlocker();
+    if (blocker) {
+      from.printf("ERR park: %s\n", blocker);
+      return;
+    }
+    from.println("OK parking");
+    parking.sleep(rtc.epoch());
+  } else if (sscanf(arg, "%u", &m) == 1 && m <= 1440) {
+    if (!consoleOnly(from, "park")) return;
+    parking.setMinutes((uint16_t)m);
+    prefs.putInt("parkmin", (int)m);
+    from.printf("PARK %u min\n", m);
+  } else if (*arg == '\0') {
+    parking.print(from, parkBlocker());
+  } else {
+    from.println("Use: park | park <minutes 0-1440> (0 = off) | park now");
+  }
+}
+
+// pm | pm on|off | pm locks: power state shares, current estimate, wake latency
+static void cmdPm(char* arg, Transport& from) {
+  if (strcasecmp(arg, "on") == 0 || strcasecmp(arg, "off") == 0) {
+    bool on = strcasecmp(arg, "on") == 0;
+    power.setEnabled(on);
+    prefs.putInt("pm", on ? 1 : 0);
+    from.printf("PM %s\n", on ? "ON" : "OFF");
+  } else if (strcasecmp(arg, "locks") == 0) {
+    // esp_pm writes to stdout (USB console), including the BT controller's locks
+    if (esp_pm_dump_locks(stdout) == ESP_OK) from.println("PM locks printed on the serial console");
+    else from.println("PM locks: esp_pm not enabled in this core");
+  } else if (*arg == '\0') {
+    power.print(from);
+  } else {
+    from.println("Use: pm | pm on|off | pm locks");
+  }
+}
+
+
+// heapstat [trap on|off]: heap low-water marks and post-setup allocations
+static void cmdHeapStat(char* arg, Transport& from) {
+  if (strncasecmp(arg, "trap ", 5) == 0) {
+    if (!consoleOnly(from, "heapstat trap")) return;
+    heapMonitor.setTrap(strcasecmp(arg + 5, "on") == 0);
+  }
+  heapMonitor.print(from);
+}
+
+// outstat [trace on|off]: output levels, claims, write counts and interlock trips
+static void cmdOutStat(char* arg, Transport& from) {
+  if (strncasecmp(arg, "trace ", 6) == 0) {
+    outputs.setTrace(strcasecmp(arg + 6, "on") == 0);
+  }
+  outputs.print(from);
+  from.printf("resetAll: %lu cycles (%s)\n", (unsigned long)resetCycles,
+#ifdef OUTPUT_DIRECT_WRITE
+              "digitalWrite per change"
+#else
+              "staged, + one commit"
+#endif
+              );
+}
+
+// stall <ms>: busy-wait inside loop() to check that pulse widths (outstat)
+// do not stretch under loop load
+static void cmdStall(char* arg, Transport& from) {
+  if (!consoleOnly(from, "stall")) return;
+  long ms = atol(arg);
+  if (ms < 1 || ms > 2000) {
+    from.println("Invalid stall (1-2000 ms)");
+    return;
+  }
+  unsigned long t0 = micros();
+  while (micros() - t0 < (unsigned long)ms * 1000UL) {
+  }
+  from.printf("Stalled %ld ms\n", ms);
+}
+
+// Sequences (start/warm/reset) currently sleeping and the frame pool use
+static void cmdSeqStat(char*, Transport& from) { sequencer.print(from); }
+
+// Patterns currently playing and whether LEDC or the CPU drives them
+static void cmdPatStat(char*, Transport& from) { patterns.print(from); }
+
+// crankmax <ms> -> starter cut-off time (interlock), persisted
+static void cmdCrankMax(char* arg, Transport& from) {
+  if (*arg) {
+    long v = atol(arg);
+    if (v < 500 || v > 10000) {
+      from.println("Invalid crankmax (500-10000 ms)");
+      return;
+    }
+    outputs.setMaxCrankMs((unsigned long)v);
+    prefs.putInt("crankmax", (int)v);
+  }
+  from.printf("Max crank: %lu ms\n", outputs.getMaxCrankMs());
+}
+
+// NVS keys of an output's hold setting: "hpi_<name>" pull-in ms, "hdc_<name>" duty %
+static void holdKeys(Output out, char* pi, char* dc) {
+  snprintf(pi, 16, "hpi_%s", BOARD.out[out].name);
+  snprintf(dc, 16, "hdc_%s", BOARD.out[out].name);
+}
+
+static void loadHoldSettings() {
+  char pi[16], dc[16];
+  for (uint8_t i = 0; i < OUT_COUNT; i++) {
+    holdKeys((Output)i, pi, dc);
+    outputs.setHold((Output)i, (uint16_t)prefs.getInt(pi, 100), (uint8_t)prefs.getInt(dc, 0));
+  }
+}
+
+// hold [<output> <pullin_ms> <duty%> | <output> off] -> PWM hold drive per output, persisted
+static void cmdHold(char* arg, Transport& from) {
+  if (*arg) {
+    char name[16] = "", word[8] = "";
+    int pullIn = 0, duty = 0;
+    sscanf(arg, "%15s %7s", name, word);
+    uint8_t out = 0;
+    while (out < OUT_COUNT && strcasecmp(name, BOARD.out[out].name) != 0) out++;
+    bool off = strcasecmp(word, "off") == 0;
+    bool valid = sscanf(arg, "%*s %d %d", &pullIn, &duty) == 2 &&
+                 pullIn >= 20 && pullIn <= 5000 && duty >= 10 && duty <= 99;
+    if (out == OUT_COUNT || (!off && !valid)) {
+      from.println("Usage: hold <output> <pullin_ms 20-5000> <duty 10-99> | hold <output> off");
+      return;
+    }
+    char pi[16], dc[16];
+    holdKeys((Output)out, pi, dc);
+    if (off) {
+      duty = 0;
+      pullIn = outputs.holdPullInMs((Output)out);
+    }
+    outputs.setHold((Output)out, (uint16_t)pullIn, (uint8_t)duty);
+    prefs.putInt(pi, pullIn);
+    prefs.putInt(dc, duty);
+  }
+  for (uint8_t i = 0; i < OUT_COUNT; i++) {
+    if (outputs.holdDutyPct((Output)i)) {
+      from.printf("%-9s pull-in %u ms, hold %u%%%s\n", BOARD.out[i].name, outputs.holdPullInMs((Output)i),
+                  outputs.holdDutyPct((Output)i), outputs.isHolding((Output)i) ? " (holding)" : "");
     } else {
-      resetAll();
+      from.printf("%-9s full drive\n", BOARD.out[i].name);
     }
-  });
-  rx500.setOnAlarmToggle([&]() { doorControl.toggleAlarm(); });
+  }
+}
 
-  // Initialize physical button module (button pin 18, LED_POWER use PIN_PESAWAT if available)
-  // We'll use PIN_PESAWAT as LED_POWER; change in ButtonTombol constructor if desired
-  buttonTombol.begin();
-  buttonTombol.setResetCallback([](){ resetAll(); });
-  buttonTombol.setEngineSetter([&](bool v){ setEngineState(v); });
+static void cmdHelp(char*, Transport& from);
+static void cmdMacro(char* arg, Transport& from);
+
+static const CommandEngine::Command COMMANDS[] = {
+  {"acc_on",        cmdAccOn},
+  {"acc_off",       cmdAccOff},
+  {"ig_on",         cmdIgOn},
+  {"ig_off",        cmdIgOff},
+  {"start_the_car", cmdStartTheCar},
+  {"starter_on",    cmdStarterOn},
+  {"alarm_on",      cmdAlarmOn},
+  {"alarm_off",     cmdAlarmOff},
+  {"lamp_on",       cmdLampOn},
+  {"lamp_off",      cmdLampOff},
+  {"reset_all",     cmdResetAll},
+  {"lock",          cmdLock},
+  {"unlock",        cmdUnlock},
+  {"btncd",         cmdBtnCd},
+  {"setrtc",        cmdSetRtc},
+  {"hosttime",      cmdHostTime},
+  {"rtc",           cmdRtc},
+  {"drift",         cmdDrift},
+  {"rtcstat",       cmdRtcStat},
+  {"cts",           cmdCts},
+  {"timetest",      cmdTimeTest},
+  {"i2cscan",       cmdI2cScan},
+  {"warm",          cmdWarm},
+  {"warmlen",       cmdWarmLen},
+  {"sched",         cmdSched},
+  {"blestat",       cmdBleStat},
+  {"bleclear",      cmdBleClear},
+  {"advstat",       cmdAdvStat},
+  {"advcfg",        cmdAdvCfg},
+  {"ping",          cmdPing},
+  {"loopstat",      cmdLoopStat},
+  {"outstat",       cmdOutStat},
+  {"crankmax",      cmdCrankMax},
+  {"patstat",       cmdPatStat},
+  {"seqstat",       cmdSeqStat},
+  {"hold",          cmdHold},
+  {"stall",         cmdStall},
+  {"heapstat",      cmdHeapStat},
+  {"bootstat",      cmdBootStat},
+  {"hotstate",      cmdHotState},
+  {"pm",            cmdPm},
+  {"park",          cmdPark},
+  {"macro",         cmdMacro},
+  {"help",          cmdHelp},
+};
+
+static CommandEngine commandEngine(COMMANDS, sizeof(COMMANDS) / sizeof(COMMANDS[0]));
+
+static void cmdHelp(char*, Transport& from) { commandEngine.printHelp(from); }
+
+// Macro slot n (1-MACRO_SLOTS) bytecode is stored as "mac<n>"
+static size_t loadMacro(uint8_t slot, uint8_t* code) {
+  char key[8];
+  snprintf(key, sizeof(key), "mac%u", slot);
+  if (!prefs.isKey(key)) return 0;
+  return prefs.getBytes(key, code, MacroVM::MAX_BYTES);
+}
+
+static bool runMacro(uint8_t slot, Print& out) {
+  uint8_t code[MacroVM::MAX_BYTES];
+  size_t len = loadMacro(slot, code);
+  if (!len) {
+    out.printf("Macro %u empty\n", slot);
+    return false;
+  }
+  const char* err = macroVm.start(code, len, slot);
+  if (err) {
+    out.printf("Macro %u rejected: %s\n", slot, err);
+    return false;
+  }
+  out.printf("MACRO %u RUN\n", slot);
+  return true;
+}
+
+static bool storeMacro(uint8_t slot, const uint8_t* code, size_t len, Transport& from) {
+  char key[8];
+  snprintf(key, sizeof(key), "mac%u", slot);
+  if (prefs.putBytes(key, code, len) != len) {
+    from.println("Macro save failed");
+    return false;
+  }
+  from.printf("Macro %u saved (%u bytes)\n", slot, (unsigned)len);
+  macroVm.disasm(code, len, from);
+  return true;
+}
+
+// macro                      -> list slots, VM state
+// macro set <n> <op; op; ..> -> compile on the device ("lamp_on; wait 2000; lock")
+// macro load <n> <hex>[+]   -> bytecode from host_macro.py, verified before saving;
+//                               a trailing '+' means more chunks follow (line length limit)
+// macro run <n> | stop | del <n> | table
+// macro bind <a|b|c|d> <n>   -> remote button runs macro n instead of its action (0 = default)
+static void cmdMacro(char* arg, Transport& from) {
+  char sub[8] = "";
+  int slot = 0;
+  int used = 0;
+  sscanf(arg, "%7s %d %n", sub, &slot, &used);
+  const char* rest = used ? arg + used : "";
+  bool slotOk = slot >= 1 && slot <= MACRO_SLOTS;
+  uint8_t code[MacroVM::MAX_BYTES];
+  size_t len = 0;
+
+  if (!*sub) {
+    for (uint8_t i = 1; i <= MACRO_SLOTS; i++) {
+      len = loadMacro(i, code);
+      from.printf("Macro %u: %s\n", i, len ? "" : "empty");
+      if (len) macroVm.disasm(code, len, from);
+    }
+    from.printf("Remote A-D: %u %u %u %u\n", remoteMacro[0], remoteMacro[1], remoteMacro[2], remoteMacro[3]);
+    macroVm.print(from);
+  } else if (strcasecmp(sub, "set") == 0 && slotOk && *rest) {
+    const char* err = macroVm.compile(rest, code, len);
+    if (err) from.printf("Macro error: %s\n", err);
+    else storeMacro(slot, code, len, from);
+  } else if (strcasecmp(sub, "load") == 0 && slotOk && *rest) {
+    // Chunks collect in macroStage until a chunk without '+'
+    static uint8_t macroStage[MacroVM::MAX_BYTES];
+    static size_t stageLen = 0;
+    static int stageSlot = 0;
+    if (stageSlot != slot) stageLen = 0;
+    stageSlot = slot;
+    while (stageLen < MacroVM::MAX_BYTES && isxdigit((unsigned char)rest[0]) && isxdigit((unsigned char)rest[1])) {
+      char hex[3] = {rest[0], rest[1], '\0'};
+      macroStage[stageLen++] = (uint8_t)strtoul(hex, nullptr, 16);
+      rest += 2;
+    }
+    if (rest[0] == '+' && !rest[1]) {
+      from.printf("Macro %d: %u bytes, more\n", slot, (unsigned)stageLen);
+      return;
+    }
+    const char* err = *rest ? "bad hex" : macroVm.verify(macroStage, stageLen);
+    if (err) from.printf("Macro error: %s\n", err);
+    else storeMacro(slot, macroStage, stageLen, from);
+    stageLen = 0;
+    stageSlot = 0;
+  } else if (strcasecmp(sub, "run") == 0 && slotOk) {
+    runMacro(slot, from);
+  } else if (strcasecmp(sub, "stop") == 0) {
+    macroVm.stop();
+    from.println("MACRO STOP");
+  } else if (strcasecmp(sub, "del") == 0 && slotOk) {
+    char key[8];
+    snprintf(key, sizeof(key), "mac%u", slot);
+    prefs.remove(key);
+    from.printf("Macro %d deleted\n", slot);
+  } else if (strcasecmp(sub, "table") == 0) {
+    for (size_t i = 0; i < commandEngine.size(); i++) {
+      const char* name = commandEngine.nameAt(i);
+      from.printf("%u %s %04x\n", (unsigned)i, name, CommandEngine::nameId(name, strlen(name)));
+    }
+  } else if (strcasecmp(sub, "bind") == 0) {
+    char button = 0;
+    int n = -1;
+    if (sscanf(arg, "%*s %c %d", &button, &n) == 2 && tolower(button) >= 'a' && tolower(button) <= 'd' &&
+        n >= 0 && n <= MACRO_SLOTS) {
+      remoteMacro[tolower(button) - 'a'] = (uint8_t)n;
+      prefs.putBytes("macremote", remoteMacro, sizeof(remoteMacro));
+      if (n) from.printf("Remote %c -> macro %d\n", toupper(button), n);
+      else from.printf("Remote %c -> default action\n", toupper(button));
+    } else {
+      from.println("Usage: macro bind <a|b|c|d> <0-4>");
+    }
+  } else {
+    from.println("Usage: macro [set <n> <ops> | load <n> <hex> | run <n> | stop | del <n> | table | bind <btn> <n>]");
+  }
+}
+
+// Serial only, first 3s after boot: "b<baud>" changes the console baud rate
+static bool baudLineHook(char* line, size_t len, Transport& from) {
+  if ((long)(millis() - baudWindowUntil) >= 0) return false;
+  if (len < 2 || line[0] != 'b' || !isdigit((unsigned char)line[1])) return false;
+  uint32_t nb = strtoul(line + 1, nullptr, 10);
+  if (nb < 300 || nb > 2000000) return false;
+  serialBaud = nb;
+  Serial.flush();
+  Serial.begin(serialBaud);
+  from.print("Baud changed to "); from.println(serialBaud);
+  return true;
+}
+
+// Deferred boot stage: the BLE (and SPP) stack takes hundreds of ms to come
+// up, so it starts here while loop() already serves the remote and button.
+// BLEModule ignores loop()'s calls until it is ready.
+static volatile bool bleBootDone = false;
+
+static void bootBleTask(void*) {
   // Initialize BLE module and register handlers
   // Register write and connection handlers; write handler performs Lock/Unlock logic
   ble.begin("ESP32-BLE-Mobile",
-    // write handler
-    [&](const std::string& val) {
-      Serial.print("Characteristic written: "); Serial.println(val.c_str());
-      std::string cmd = normalizeCmd(val);
-
-      // ACC
-      if (cmd == "acc_on") {
-        digitalWrite(PIN_ACC, HIGH);
-        accOn = true;
-        ble.notify(std::string("ACC ON"));
-        Serial.print("Action: "); Serial.println(prettyCmd("acc_on"));
-        return;
-      } else if (cmd == "acc_off") {
-        digitalWrite(PIN_ACC, LOW);
-        accOn = false;
-        ble.notify(std::string("ACC OFF"));
-        Serial.print("Action: "); Serial.println(prettyCmd("acc_off"));
-        return;
-      }
-
-      // IG
-      if (cmd == "ig_on") {
-        digitalWrite(PIN_IG, HIGH);
-        igOn = true;
-        ble.notify(std::string("IGNITION ON"));
-        Serial.print("Action: "); Serial.println(prettyCmd("ig_on"));
-        return;
-      } else if (cmd == "ig_off") {
-        digitalWrite(PIN_IG, LOW);
-        igOn = false;
-        ble.notify(std::string("IGNITION OFF"));
-        Serial.print("Action: "); Serial.println(prettyCmd("ig_off"));
-        return;
-      }
-
-      // Composite command: Start_the_Car -> ACC_ON, IG_ON, then starter after 1s
-      if (cmd == "start_the_car") {
-        // Prevent duplicate starts: ignore if engine already on, starter active, or pending
-        // Prevent duplicate starts: ignore if engine already on, starter active, or pending
-        if (engineOn || starterActive || startCarPending) {
-          ble.notify(std::string("ENGINE ALREADY ON"));
-          Serial.println("Ignored START_THE_CAR (engine on or start pending)");
-          return;
-        }
-        // Trigger the same start flow as the physical button (starts countdown)
-        buttonTombol.triggerStart();
-        ble.notify(std::string("START THE CAR"));
-        Serial.print("Action: "); Serial.println(prettyCmd("start_the_car") + " triggered (countdown active)");
-        return;
-      }
-
-      // STARTER (pulse 1000ms)
-      if (cmd == "starter_on") {
-        if (!starterActive) {
-          digitalWrite(PIN_STARTER, HIGH);
-          starterActive = true;
-          starterEnd = millis() + 1000;
-          setEngineState(true);
-          ble.notify(std::string("STARTER ON"));
-          Serial.print("Action: "); Serial.println(prettyCmd("starter_on"));
-        } else {
-          ble.notify(std::string("IGNORED STARTER ON"));
-          Serial.println("Ignored STARTER_ON (already active)");
-        }
-        return;
-      }
-
-      // ALARM
-      if (cmd == "alarm_on") {
-        doorControl.setAlarm(true);
-        return;
-      }
-      else if (cmd == "alarm_off") {
-        doorControl.setAlarm(false);
-        return;
-      }
-
-
-      // LAMP
-      if (cmd == "lamp_on") {
-        digitalWrite(PIN_LAMP, HIGH);
-        lampOn = true;
-        ble.notify(std::string("LAMP ON"));
-        Serial.print("Action: "); Serial.println(prettyCmd("lamp_on"));
-        return;
-      } else if (cmd == "lamp_off") {
-        digitalWrite(PIN_LAMP, LOW);
-        lampOn = false;
-        ble.notify(std::string("LAMP OFF"));
-        Serial.print("Action: "); Serial.println(prettyCmd("lamp_off"));
-        return;
-      }
-
-      // Lock/Unlock existing logic
-      // RESET_ALL (from BLE string)
-      if (cmd == "reset_all") {
-        resetAll();
-        return;
-      }
-      // BTN countdown via BLE: "btncd <ms>"
-      if (cmd.rfind("btncd", 0) == 0) {
-        std::string arg = cmd.substr(5);
-        // trim leading spaces
-        while (!arg.empty() && std::isspace((unsigned char)arg.front())) arg.erase(arg.begin());
-        if (!arg.empty()) {
-          try {
-            unsigned long v = std::stoul(arg);
-            if (v >= 5000 && v <= 60000) {
-              buttonTombol.setCountdownMs(v);
-              prefs.putInt("btncd", (int)v);
-              ble.notify(std::string("BUTTON COUNTDOWN SET"));
-              Serial.printf("Button countdown set to %lu ms\n", v);
-            } else {
-              ble.notify(std::string("BTNCD INVALID RANGE"));
-              Serial.println("BTNCD invalid range (use 5000-60000 ms)");
-            }
-          } catch(...) {
-            ble.notify(std::string("BTNCD PARSE ERROR"));
-            Serial.println("BTNCD parse error");
-          }
-        } else {
-          ble.notify(std::string("BTNCD USAGE"));
-          Serial.println("Usage via BLE: btncd <ms>");
-        }
-        return;
-      }
-      // SETRTC via BLE: "setrtc [now|YYYY-MM-DD HH:MM:SS]"
-      if (cmd.rfind("setrtc", 0) == 0) {
-        std::string arg = cmd.substr(6);
-        while (!arg.empty() && std::isspace((unsigned char)arg.front())) arg.erase(arg.begin());
-        if (arg.empty() || arg == "now") {
-          ble.notify(std::string("RTC SET DECLINED"));
-          Serial.println("Refusing to set RTC to compile-time or 'now' via BLE. Use: setrtc YYYY-MM-DD HH:MM:SS or send HOSTTIME from host.");
-        } else {
-          String s(arg.c_str());
-          if (rtc.setNowFromString(s)) {
-            ble.notify(std::string("RTC SET"));
-            Serial.println("RTC set via BLE:");
-            {
-              String now = rtc.nowString();
-              Serial.print("RTC: "); Serial.println(now);
-              bleNotifyChunks(std::string(now.c_str()));
-            }
-          } else {
-            ble.notify(std::string("RTC SET FAILED"));
-            Serial.println("Invalid datetime format via BLE. Use: setrtc YYYY-MM-DD HH:MM:SS");
-          }
-        }
-        return;
-      }
-      if (cmd == "lock") {
-        doorControl.lockPulse();
-      } else if (cmd == "unlock") {
-        doorControl.unlockPulse();
-      } else {
-        std::string resp = std::string("UNKNOWN ") + std::string(prettyCmd(val).c_str());
-        ble.notify(resp);
-        Serial.println("Action: UNKNOWN command");
-      }
+    // write handler (BT task): park the command for loop()
+    [](const char* data, size_t len) {
+      bleTransport.receive(data, len);
+      power.wake(WAKE_BLE);
     },
     // connection handler
     [](bool connected) {
       isConnected = connected;
-      digitalWrite(LED_PIN, connected ? HIGH : LOW);
+      power.poke();
       Serial.print("BLE Central "); Serial.println(connected ? "connected" : "disconnected");
       // if (!connected) {
       //   ble.startAdvertising(); // atau fungsi sejenis di BLEModule
@@ -412,45 +1013,242 @@ void setup() {
     }
     
   );
-
+  bootTrace.mark(BOOT_ADVERTISING);
 
   // Print the values you need for MIT App Inventor
-  String mac = BLEDevice::getAddress().toString().c_str();
+  String mac = ble.address().c_str();
   Serial.println("--- BLE Info (use these in App Inventor) ---");
   Serial.print("Device Name: "); Serial.println("ESP32-BLE-Mobile");
   Serial.print("Device Address (MAC): "); Serial.println(mac);
-  Serial.print("Service UUID: "); Serial.println(SERVICE_UUID.toString().c_str());
-  Serial.print("Characteristic UUID: "); Serial.println(CHARACTERISTIC_UUID.toString().c_str());
+  Serial.print("Service UUID: "); Serial.println(BLE_SERVICE_UUID);
+  Serial.print("Characteristic UUID: "); Serial.println(BLE_CHAR_UUID);
   Serial.println("-------------------------------------------");
+
+#ifdef ENABLE_SPP
+  SerialBT.begin("ESP32-SPP-Mobile");
+  Serial.println("SPP: Bluetooth Classic serial started (ESP32-SPP-Mobile)");
+#endif
+
+  bleBootDone = true;
+  vTaskDelete(nullptr);
+}
+
+// State from before a warm reset. The starter is never restored: a reset
+// while cranking is most likely the starter's own brownout.
+static void restoreHotState(const HotState& h) {
+  doorControl.restore(h.locked, h.alarmOn);
+  // Pesawat blink follows locked && engine off
+  setEngineState(h.engineOn);
+  if (!h.pesawat) patterns.stop(OUT_PESAWAT);
+  if (h.warmLeftS) {
+    warmEngine.resume(h.warmLeftS * 1000UL);
+  } else if (h.engineOn) {
+    // Engine started by button / command: keep its ignition relays
+    if (h.acc) outputs.request(OUT_ACC, SRC_COMMAND, true);
+    if (h.ig) outputs.request(OUT_IG, SRC_COMMAND, true);
+  }
+  outputs.commit();
+}
+
+// Mirror of the hot state, once per tick; RTC memory is only written on a change
+static void saveHotState() {
+  HotState h = {};
+  h.locked = doorControl.isLocked();
+  h.alarmOn = doorControl.isAlarmOn();
+  h.engineOn = engineOn;
+  h.pesawat = patterns.playing(OUT_PESAWAT);
+  h.acc = outputs.isOn(OUT_ACC);
+  h.ig = outputs.isOn(OUT_IG);
+  if (warmEngine.isActive()) {
+    h.warmLeftS = (uint32_t)((warmEngine.remainingMillis() + 999UL) / 1000UL);
+    h.rtcEpoch = rtc.epoch();
+  }
+  hotState.save(h);
+}
+
+// Once the RTC runs: a restored warm-up loses the time the board was down
+// (snapshot RTC time -> now, minus this boot's uptime)
+static void reconcileWarm() {
+  uint32_t now = rtc.epoch();
+  if (!now || now < restoredState.rtcEpoch || !warmEngine.isActive()) return;
+  uint32_t gap = now - restoredState.rtcEpoch;
+  uint32_t up = (uint32_t)(millis() / 1000UL);
+  uint32_t down = gap > up ? gap - up : 0;
+  // 1 s RTC resolution plus 1 s snapshot granularity
+  if (down < 2) return;
+  unsigned long left = warmEngine.remainingMillis();
+  unsigned long lost = down * 1000UL;
+  Serial.printf("Warm-up: board was down %lu s before the restore\n", (unsigned long)down);
+  warmEngine.resume(left > lost ? left - lost : 0);
+}
+
+// Boot is staged so the remote and button answer within milliseconds of
+// power-up: setup() only brings up pins, settings and input handlers; the
+// RTC and schedule follow in the first loop() tick, BLE in bootBleTask.
+// Each phase is timestamped (bootstat).
+void setup() {
+  bootTrace.mark(BOOT_SETUP);
+  Serial.setTxBufferSize(SERIAL_TX_BUFFER);
+  Serial.begin(serialBaud);
+  Serial.println("Starting BLE peripheral...");
+  // Every pin of the board profile, outputs inactive
+  boardInitPins();
+  outputs.begin();
+  bootTrace.mark(BOOT_OUTPUTS);
+  // Woken from parking: which remote press or alarm (ULP / ext wake status)
+  parking.begin();
+  // Hot state from before a warm reset (RTC memory, no flash), before NVS and BLE
+  hotRestored = hotState.load(restoredState);
+  if (hotRestored) {
+    restoreHotState(restoredState);
+    Serial.printf("Hot state restored: locked=%u alarm=%u engine=%u warm=%lu s\n", restoredState.locked,
+                  restoredState.alarmOn, restoredState.engineOn, (unsigned long)restoredState.warmLeftS);
+  }
+  // Initialize preferences and load warm duration
+  prefs.begin("settings", false);
+  outputs.setMaxCrankMs((unsigned long)prefs.getInt("crankmax", 3000));
+  loadHoldSettings();
+  if (prefs.isKey("macremote")) prefs.getBytes("macremote", remoteMacro, sizeof(remoteMacro));
+  // Load saved button countdown (ms) if present
+  int savedBtnCd = prefs.getInt("btncd", 15000);
+  buttonTombol.setCountdownMs((unsigned long)savedBtnCd);
+  // Advertising policy (fast/slow interval, burst window) persisted in NVS
+  ble.setAdvPolicy((uint16_t)prefs.getInt("advfast", 30),
+                   (uint16_t)prefs.getInt("advslow", 1000),
+                   (uint32_t)prefs.getInt("advburst", 30000));
+  ble.setPeerTimeSync(prefs.getInt("ctssync", 1) != 0);
+  bootTrace.mark(BOOT_SETTINGS);
+  // esp_pm and the wake interrupts, before BLE (its writes wake loop())
+  power.begin(prefs.getInt("pm", 1) != 0);
+  parking.setMinutes((uint16_t)prefs.getInt("parkmin", 0));
+
+  macroVm.begin(commandEngine);
+  // initialize WarmUp engine and Door control
+  warmEngine.init(&prefs);
+  warmEngine.begin();
+  doorControl.begin();
+  // Initialize RX500 remote handler (events go to RemoteHooks)
+  rx500.begin();
+  // The press that ended parking may be over before the first poll
+  int8_t wokeBy = parking.wakeRemote();
+  if (wokeBy >= 0) rx500.press((uint8_t)wokeBy);
+  // Initialize physical button module (PIN_BUTTON, LED_POWER = OUT_LED_POWER)
+  buttonTombol.begin();
+  // Schedule waits for the RTC (first loop tick); no I/O here
+  scheduler.init(&rtc, &prefs);
+  bootTrace.mark(BOOT_INPUTS);
+  Serial.printf("Button countdown loaded: %d ms\n", savedBtnCd);
+
+  // Baud change window: "b9600" / "b115200" is accepted by baudLineHook
+  // during the first 3s while loop() already runs (no busy wait here)
+  Serial.println("Type 'b9600' or 'b115200' within 3s to change baud.");
+  baudWindowUntil = millis() + BAUD_WINDOW_MS;
+  serialTransport.setLineHook(baudLineHook);
+
+  Serial.print("Using serial baud: "); Serial.println(serialBaud);
+
   // Do not wait for HOSTTIME on startup; use RTC as-is for serial and scheduling.
   Serial.println("Not waiting for HOSTTIME; using RTC value for scheduling if plausible.");
   hostTimeSynced = true; // prevent periodic GETTIME requests
+
+  // BLE on core 0 next to the Bluetooth host; loop() runs on core 1
+  xTaskCreatePinnedToCore(bootBleTask, "bootble", 4096, nullptr, 1, nullptr, 0);
+
+  outputs.commit();
+  parking.onActuated();
+}
+
+// End of tick: tell the power manager whether anything runs (fast tick,
+// 240 MHz, no light sleep) and keep the DS3231 alarm on the next schedule
+// slot, so a parked board wakes for it; deep sleep after the parking timeout
+static void powerTick() {
+  bool busy = !bootTrace.reached(BOOT_DONE) || sequencer.busy() || macroVm.running() || warmEngine.isActive() ||
+              engineOn || doorControl.isAlarmOn() || buttonTombol.busy();
+  for (uint8_t i = 0; i < OUT_COUNT; i++) busy |= outputs.isPulsing((Output)i);
+  // INT/SQW stays low until the alarm flag is cleared
+  if (digitalRead(PIN_RTC_INT) == LOW) rtc.ackAlarm();
+  rtc.setAlarm(scheduler.nextAny());
+  // Only hold PWM is on LEDC while light sleep is possible (patterns run on the CPU)
+  power.endTick(busy, ledc.inUse() > 0, outputs.commitCount());
+
+  // A command counts as activity for the parking timeout
+  static uint32_t commandsSeen = 0;
+  if (commandEngine.dispatched() != commandsSeen) {
+    commandsSeen = commandEngine.dispatched();
+    power.noteActivity();
+  }
+  if (parking.minutes() && power.idleMs() >= parking.minutes() * 60000UL && !parkBlocker()) {
+    Serial.printf("Parking after %u min without activity\n", parking.minutes());
+    parking.sleep(rtc.epoch());
+  }
+}
+
+// Deferred boot stages, from loop(): the RTC once the inputs were polled a
+// first time, then the end-of-boot report when BLE is up as well
+static void bootStep() {
+  if (!bootTrace.reached(BOOT_RTC)) {
+    // Initialize RTC, then the schedule (needs the RTC time)
+    rtc.init(&prefs);
+    rtc.begin();
+    scheduler.begin();
+    parking.onRtc(rtc.epoch());
+    if (hotRestored && restoredState.warmLeftS && restoredState.rtcEpoch) reconcileWarm();
+    bootTrace.mark(BOOT_RTC);
+    return;
+  }
+  if (!bleBootDone) return;
+  bootTrace.mark(BOOT_DONE);
+  Serial.printf("Boot: inputs live after %lu ms, advertising after %lu ms (bootstat)\n",
+                (unsigned long)(bootTrace.us(BOOT_LOOP) / 1000), (unsigned long)(bootTrace.us(BOOT_ADVERTISING) / 1000));
+  // Memory footprint of the selected BLE backend (compare bluedroid vs nimble builds)
+  Serial.printf("BLE backend: %s, free heap after boot: %lu bytes, sketch size: %lu bytes\n",
+                ble.backendName(), (unsigned long)ESP.getFreeHeap(), (unsigned long)ESP.getSketchSize());
+  // From here on every steady-state buffer is static; count what still allocates
+  heapMonitor.arm();
 }
 
 void loop() {
-  // Report connection state only when it changes to avoid flooding the log
-  static unsigned long loopTick = 0;
-  if (millis() - loopTick < 10) return;
-  loopTick = millis();
+  // Sleep until the next tick (10 ms while something runs, longer when idle),
+  // an input edge or a BLE write; never past the next software pattern edge
+  power.waitTick(patterns.msToNextStep());
+  unsigned long loopStartUs = micros();
+  bootTrace.mark(BOOT_LOOP);
 
+  // Report connection state only when it changes to avoid flooding the log
   static bool lastState = false;
   if (isConnected != lastState) {
     lastState = isConnected;
+    // Connection LED (written here, not from the BT task)
+    outputs.request(OUT_LED_CONN, SRC_SEQUENCE, isConnected);
     Serial.print("isConnected: "); Serial.println(isConnected ? "true" : "false");
   }
   
 
-  // Update door control (handles lock/unlock pulses, hazard, pesawat, alarm blinking)
-  doorControl.update();
-  // Update warm engine scheduler and warm starter handling
-  warmEngine.update();
+  // BLE housekeeping, door pulses/hazard/alarm blink, warm-up scheduler,
+  // remote inputs and the physical button
+  uint32_t tickCycles = ESP.getCycleCount();
+  TickModules::update();
+  tickCycles = ESP.getCycleCount() - tickCycles;
+  tickCyclesTotal += tickCycles;
+  if (tickCycles > tickCyclesMax) tickCyclesMax = tickCycles;
 
+  if (!bootTrace.reached(BOOT_DONE)) bootStep();
 
+  // Phone clock read after a connection (BLE Current Time Service)
+  PeerTime peerTime;
+  if (ble.takePeerTime(peerTime)) applyPeerTime(peerTime);
+
+  // Status beacon in advertising data; only rebuilt when a bit changes
+  {
+    uint8_t flags = 0;
+    if (doorControl.isLocked()) flags |= BEACON_LOCKED;
+    if (engineOn) flags |= BEACON_ENGINE;
+    if (warmEngine.isActive()) flags |= BEACON_WARM;
+    if (doorControl.isAlarmOn()) flags |= BEACON_ALARM;
+    if (rtc.status() == RTC_OK) flags |= BEACON_RTC_OK;
+    ble.setBeaconState(flags);
+  }
 
-  // Remote inputs handled by RX500Module
-  rx500.update();
-  // Update physical button module
-  buttonTombol.update();
 
 // Periodically print RTC time for logging (every 10s)
   static unsigned long lastRtc = 0;
@@ -464,13 +1262,14 @@ void loop() {
       char buf[32];
       snprintf(buf, sizeof(buf), "%02u:%02u:%02u", rhour, rmin, rsec);
       Serial.print("WARM: "); Serial.println(buf);
-      std::string notif = std::string("WARM: ") + std::string(buf);
-      bleNotifyChunks(notif);
+      bleTransport.print("WARM: "); bleTransport.println(buf);
     } else {
-      String now = rtc.nowString();
+      static char now[32];
+      rtc.formatNow(now, sizeof(now));
       Serial.print("RTC: "); Serial.println(now);
-      bleNotifyChunks(std::string(now.c_str()));
+      bleTransport.println(now);
     }
+    heapMonitor.sample();
   }
 
   // If host time not yet synced, periodically request it (every 30s)
@@ -481,141 +1280,35 @@ void loop() {
     lastHostRequest = millis();
   }
 
-  // Serial command handling for on-device testing
-  if (Serial.available()) {
-    String cmd = Serial.readStringUntil('\n');
-    cmd.trim();
-    if (cmd.length() > 0) {
-      Serial.print("Serial cmd: "); Serial.println(cmd);
-      if (cmd.startsWith("HOSTTIME")) {
-        String arg = cmd.substring(8);
-        arg.trim();
-        if (arg.length() > 0 && rtc.setNowFromString(arg)) {
-          Serial.println("RTC set from host (serial)");
-          {
-            String now = rtc.nowString();
-            Serial.print("RTC: "); Serial.println(now);
-            bleNotifyChunks(std::string(now.c_str()));
-          }
-        } else {
-          Serial.println("Invalid HOSTTIME format");
-        }
-      }
-      if (cmd.equalsIgnoreCase("rtc")) {
-        Serial.print("RTC: "); Serial.println(rtc.nowString());
-      } else if (cmd.equalsIgnoreCase("i2cscan")) {
-        Serial.println("I2C scan start");
-        Wire.begin();
-        for (uint8_t addr = 1; addr < 127; ++addr) {
-          Wire.beginTransmission(addr);
-          if (Wire.endTransmission() == 0) {
-            Serial.print("Found I2C device at 0x"); Serial.println(addr, HEX);
-          }
-        }
-        Serial.println("I2C scan done");
-      } else if (cmd.equalsIgnoreCase("warm")) {
-        warmEngine.forceWarm();
-      } else if (cmd.equalsIgnoreCase("lock")) {
-        doorControl.lockPulse();
-      } else if (cmd.equalsIgnoreCase("unlock")) {
-        doorControl.unlockPulse();
-      } else if (cmd.startsWith("setrtc")) {
-        // setrtc [now|YYYY-MM-DD HH:MM:SS]
-        String arg = cmd.substring(6);
-        arg.trim();
-        if (arg.length() == 0 || arg.equalsIgnoreCase("now")) {
-          Serial.println("Refusing to set RTC to compile-time or 'now'. Use: setrtc YYYY-MM-DD HH:MM:SS or send HOSTTIME.");
-        } else {
-          if (rtc.setNowFromString(arg)) {
-            Serial.println("RTC set to:");
-            {
-              String now = rtc.nowString();
-              Serial.print("RTC: "); Serial.println(now);
-              ble.notify(std::string("RTC: ") + std::string(now.c_str()));
-            }
-          } else {
-            Serial.println("Invalid datetime format. Use: setrtc YYYY-MM-DD HH:MM:SS or setrtc now");
-          }
-        }
-      } else if (cmd.startsWith("warmlen")) {
-        String arg = cmd.substring(7);
-        arg.trim();
-        if (arg.length() > 0) {
-          int m = arg.toInt();
-          warmEngine.setDurationMinutes(m);
-        } else {
-          Serial.printf("Current warm duration: %d minutes\n", warmEngine.getDurationMinutes());
-        }
-      } else if (cmd.equalsIgnoreCase("help")) {
-        Serial.println("Commands: rtc, i2cscan, warm, warmlen [min], setrtc [now|YYYY-MM-DD HH:MM:SS], lock, unlock, help");
-      } else if (cmd.startsWith("btncd")) {
-        // btncd [ms] -> set ButtonTombol countdown window in milliseconds
-        String arg = cmd.substring(5);
-        arg.trim();
-        if (arg.length() > 0) {
-          unsigned long v = (unsigned long)arg.toInt();
-          if (v >= 5000 && v <= 60000) {
-            buttonTombol.setCountdownMs(v);
-            prefs.putInt("btncd", (int)v);
-            Serial.printf("Button countdown set to %lu ms\n", v);
-          } else {
-            Serial.println("Invalid value. Use 5000-60000 ms (5-60s)");
-          }
-        } else {
-          Serial.println("Usage: btncd [ms]  (e.g. btncd 20000)");
-        }
-      } else {
-        Serial.println("Unknown serial command. Type 'help' for list");
-      }
-    }
-  }
+  // Commands from every transport go through the same engine
+  serialTransport.poll(commandEngine);
+  bleTransport.poll(commandEngine);
+#ifdef ENABLE_SPP
+  if (bleBootDone) sppTransport.poll(commandEngine);
+#endif
 
   // Warm-up scheduling and starter are managed by WarmUpEngine
 
-  // Execute Start_the_Car pending (scheduled by BLE command Start_the_Car)
-  if (startCarPending && millis() >= startCarAt) {
-    // Stage 0 -> turn IG on and schedule starter
-    if (startCarStage == 0) {
-      digitalWrite(PIN_IG, HIGH);
-      igOn = true;
-      startCarStage = 1;
-      startCarAt = millis() + 1000; // schedule starter in 1s
-      ble.notify(std::string("IGNITION ON (START SEQUENCE)"));
-      Serial.println("Start_the_Car: IG ON, starter scheduled in 1s");
-    }
-    // Stage 1 -> engage starter pulse
-    else if (startCarStage == 1) {
-      // finish sequence
-      startCarPending = false;
-      startCarStage = 0;
-      if (!starterActive) {
-        digitalWrite(PIN_STARTER, HIGH);
-        starterActive = true;
-        starterEnd = millis() + 1000; // starter pulse 1s
-        setEngineState(true);
-        ble.notify(std::string("STARTER ON"));
-        Serial.println("Start_the_Car: STARTER pulse started (1s)");
-      }
-    }
-  }
+  // Start, warm-up and reset sequences run in the Sequencer (TickModules)
 
-  // Execute reset pending: ACC off after IG off (500ms)
-  if (resetPending && millis() >= resetAt) {
-    resetPending = false;
-    digitalWrite(PIN_ACC, LOW); accOn = false;
-    digitalWrite(PIN_LAMP, LOW); lampOn = false;
-    // ensure hazard/alarm off as part of full reset
-    digitalWrite(PIN_HAZZARD, LOW);
-    ble.notify(std::string("ALL OFF"));
-    Serial.println("Reset sequence: ACC and other outputs turned off");
-  }
+  // delay(200); // no delay to keep responsiveness
 
-  // Warm-up finish is handled by WarmUpEngine
+  saveHotState();
 
-  // delay(200); // no delay to keep responsiveness
+  // Light sleep stops the LEDC wave clock: blink patterns go to the CPU when it can happen
+  patterns.setOffload(!power.sleepCapable());
 
+  // All output changes of this tick hit the pins together
+  outputs.commit();
 
+  // Tick work time vs. budget (see loopstat)
+  unsigned long loopUs = micros() - loopStartUs;
+  loopTicks++;
+  loopTotalUs += loopUs;
+  if (loopUs > loopMaxUs) loopMaxUs = loopUs;
+  if (loopUs > LOOP_BUDGET_US) loopOverruns++;
 
+  powerTick();
 }
 
 
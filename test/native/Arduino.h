@@ -0,0 +1,61 @@
+#pragma once
+// Host build (env:native): the part of the Arduino core API that the
+// hardware-free sources and their headers use. millis() is a virtual clock
+// that the tests advance themselves (hostMillis).
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+#define HIGH 0x1
+#define LOW  0x0
+
+inline unsigned long hostMillis = 0;
+inline unsigned long millis() { return hostMillis; }
+inline unsigned long micros() { return hostMillis * 1000UL; }
+// Input levels, set by the tests
+inline int hostPins[40] = {};
+inline int digitalRead(uint8_t pin) { return pin < 40 ? hostPins[pin] : LOW; }
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual void flush() {}
+  virtual size_t write(const uint8_t* buf, size_t size) {
+    size_t n = 0;
+    while (size--) n += write(*buf++);
+    return n;
+  }
+  size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+  size_t println(const char* s = "") { return print(s) + print("\r\n"); }
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+    char buf[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    return n > 0 ? print(buf) : 0;
+  }
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+};
+
+// Serial goes to stdout, next to the test runner's output; benchmarks set
+// hostSerialQuiet so the terminal does not dominate the timing
+inline bool hostSerialQuiet = false;
+class HostSerial : public Print {
+public:
+  using Print::write;
+  size_t write(uint8_t c) override { return hostSerialQuiet || fputc(c, stdout) != EOF ? 1 : 0; }
+};
+inline HostSerial Serial;
@@ -0,0 +1,57 @@
+#pragma once
+// Host build: no NVS. Byte keys live in RAM for the lifetime of the object,
+// so a test "reboots" a module by building a new one over the same
+// Preferences; int keys read their default.
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+class Preferences {
+public:
+  int getInt(const char*, int def = 0) { return def; }
+  size_t putInt(const char*, int) { return sizeof(int); }
+
+  bool isKey(const char* key) { return find(key) != nullptr; }
+  size_t getBytesLength(const char* key) {
+    Entry* e = find(key);
+    return e ? e->len : 0;
+  }
+  size_t getBytes(const char* key, void* buf, size_t len) {
+    Entry* e = find(key);
+    if (!e || len < e->len) return 0;
+    memcpy(buf, e->data, e->len);
+    return e->len;
+  }
+  size_t putBytes(const char* key, const void* buf, size_t len) {
+    Entry* e = find(key);
+    if (!e && count < MAX_KEYS && strlen(key) < sizeof(e->key)) {
+      e = &entries[count++];
+      strcpy(e->key, key);
+    }
+    if (!e || len > sizeof(e->data)) return 0;
+    memcpy(e->data, buf, len);
+    e->len = len;
+    return len;
+  }
+  bool clear() {
+    count = 0;
+    return true;
+  }
+
+private:
+  static const uint8_t MAX_KEYS = 8;
+  struct Entry {
+    char key[16];
+    uint8_t data[128];
+    size_t len;
+  };
+  Entry entries[MAX_KEYS];
+  uint8_t count = 0;
+
+  Entry* find(const char* key) {
+    for (uint8_t i = 0; i < count; i++) {
+      if (strcmp(entries[i].key, key) == 0) return &entries[i];
+    }
+    return nullptr;
+  }
+};
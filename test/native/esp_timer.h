@@ -0,0 +1,3 @@
+#pragma once
+// Host build: the handle type OutputArbiter.h declares its pulse timers with
+typedef struct esp_timer* esp_timer_handle_t;
@@ -0,0 +1,71 @@
+// Status beacon payload: rebuilt (and re-sent to the stack) only when the
+// state flags change
+#include <unity.h>
+#include <string.h>
+#include "AdvPayload.h"
+
+static const char* UUID = "12345678-1234-1234-1234-123456789abc";
+// Manufacturer data AD structure: last 7 bytes of the advertising payload
+static const size_t MFG = 21;
+
+static AdvPayload p;
+
+void setUp(void) {
+  p = AdvPayload();
+  p.begin("ESP32-BLE-Mobile", UUID);
+}
+
+void tearDown(void) {}
+
+static void test_layout(void) {
+  TEST_ASSERT_EQUAL(28, p.advLength());
+  const uint8_t* a = p.adv();
+  // UUID goes over the air little endian
+  TEST_ASSERT_EQUAL_HEX8(0xBC, a[5]);
+  TEST_ASSERT_EQUAL_HEX8(0x12, a[20]);
+  const uint8_t mfg[] = {6, 0xFF, 0xFF, 0xFF, 0xB1, 0x00, 0x00};
+  TEST_ASSERT_EQUAL_MEMORY(mfg, a + MFG, sizeof(mfg));
+  TEST_ASSERT_EQUAL(17, p.scan()[0]);
+  TEST_ASSERT_EQUAL_MEMORY("ESP32-BLE-Mobile", p.scan() + 2, 16);
+  TEST_ASSERT_TRUE(p.scanLength() <= AdvPayload::MAX_LEN);
+}
+
+static void test_same_state_does_not_rebuild(void) {
+  uint8_t before[AdvPayload::MAX_LEN];
+  memcpy(before, p.adv(), p.advLength());
+  uint32_t builds = p.builds();
+  for (int i = 0; i < 100; i++) TEST_ASSERT_FALSE(p.setBeacon(0));
+  TEST_ASSERT_EQUAL_UINT32(builds, p.builds());
+  TEST_ASSERT_EQUAL_UINT32(0, p.updates());
+  TEST_ASSERT_EQUAL_MEMORY(before, p.adv(), p.advLength());
+}
+
+static void test_change_rebuilds_once(void) {
+  uint32_t builds = p.builds();
+  TEST_ASSERT_TRUE(p.setBeacon(BEACON_LOCKED | BEACON_RTC_OK));
+  TEST_ASSERT_EQUAL_UINT32(builds + 1, p.builds());
+  TEST_ASSERT_EQUAL_HEX8(0x11, p.adv()[MFG + 5]);
+  TEST_ASSERT_EQUAL_UINT8(1, p.adv()[MFG + 6]);
+  // Same flags from every following tick: nothing to send
+  TEST_ASSERT_FALSE(p.setBeacon(BEACON_LOCKED | BEACON_RTC_OK));
+  TEST_ASSERT_EQUAL_UINT32(builds + 1, p.builds());
+  TEST_ASSERT_TRUE(p.setBeacon(BEACON_RTC_OK));
+  TEST_ASSERT_EQUAL_UINT32(builds + 2, p.builds());
+  TEST_ASSERT_EQUAL_UINT8(2, p.beaconCounter());
+  TEST_ASSERT_EQUAL_UINT32(2, p.updates());
+}
+
+static void test_counter_wraps(void) {
+  for (int i = 0; i < 256; i++) TEST_ASSERT_TRUE(p.setBeacon(i & 1 ? BEACON_ENGINE : BEACON_WARM));
+  TEST_ASSERT_EQUAL_UINT8(0, p.beaconCounter());
+  TEST_ASSERT_EQUAL_UINT8(0, p.adv()[MFG + 6]);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_layout);
+  RUN_TEST(test_same_state_does_not_rebuild);
+  RUN_TEST(test_change_rebuilds_once);
+  RUN_TEST(test_counter_wraps);
+  return UNITY_END();
+}
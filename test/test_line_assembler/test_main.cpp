@@ -0,0 +1,129 @@
+// LineAssembler fed one byte per call, the way StreamTransport::poll()
+// drains the UART: framing, overflow, and the per-tick time bound
+#include <unity.h>
+#include <chrono>
+#include <string.h>
+#include "LineAssembler.h"
+
+// Same values as StreamTransport::RX_BUDGET and main.cpp LOOP_BUDGET_US
+static const size_t TICK_BYTES = 256;
+static const long LOOP_BUDGET_US = 10000;
+
+static LineAssembler a;
+static char lines[8][CMD_LINE_MAX + 1];
+static int lineCount, overflowCount, noneCount;
+
+void setUp(void) {
+  a.reset();
+  lineCount = overflowCount = noneCount = 0;
+}
+
+void tearDown(void) {}
+
+static void feed(const char* s, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    switch (a.feed(s[i])) {
+      case LineAssembler::LINE:
+        if (lineCount < 8) memcpy(lines[lineCount], a.line(), a.length() + 1);
+        lineCount++;
+        break;
+      case LineAssembler::OVERFLOW:
+        overflowCount++;
+        break;
+      default:
+        noneCount++;
+        break;
+    }
+  }
+}
+
+static void feed(const char* s) { feed(s, strlen(s)); }
+
+static void test_lines_split_across_ticks(void) {
+  feed("lo");
+  TEST_ASSERT_EQUAL(0, lineCount);
+  feed("ck\nunl");
+  TEST_ASSERT_EQUAL(1, lineCount);
+  TEST_ASSERT_EQUAL_STRING("lock", lines[0]);
+  feed("ock\n\nstatus\n");
+  TEST_ASSERT_EQUAL(4, lineCount);
+  TEST_ASSERT_EQUAL_STRING("unlock", lines[1]);
+  TEST_ASSERT_EQUAL_STRING("", lines[2]);
+  TEST_ASSERT_EQUAL_STRING("status", lines[3]);
+  TEST_ASSERT_EQUAL(0, overflowCount);
+}
+
+static void test_line_at_max_length(void) {
+  char buf[CMD_LINE_MAX + 1];
+  memset(buf, 'x', CMD_LINE_MAX);
+  buf[CMD_LINE_MAX] = '\n';
+  feed(buf, sizeof(buf));
+  TEST_ASSERT_EQUAL(1, lineCount);
+  TEST_ASSERT_EQUAL(CMD_LINE_MAX, strlen(lines[0]));
+  TEST_ASSERT_EQUAL(0, overflowCount);
+}
+
+static void test_overflow_dropped_once_then_recovers(void) {
+  char buf[CMD_LINE_MAX * 3];
+  memset(buf, 'y', sizeof(buf));
+  feed(buf, sizeof(buf));
+  TEST_ASSERT_EQUAL(0, overflowCount);
+  feed("tail\n");
+  // The whole long line is one overflow, nothing of it is dispatched
+  TEST_ASSERT_EQUAL(1, overflowCount);
+  TEST_ASSERT_EQUAL(0, lineCount);
+  feed("ping\n");
+  TEST_ASSERT_EQUAL(1, lineCount);
+  TEST_ASSERT_EQUAL_STRING("ping", lines[0]);
+}
+
+static void test_one_over_max_overflows(void) {
+  char buf[CMD_LINE_MAX + 2];
+  memset(buf, 'z', CMD_LINE_MAX + 1);
+  buf[CMD_LINE_MAX + 1] = '\n';
+  feed(buf, sizeof(buf));
+  TEST_ASSERT_EQUAL(1, overflowCount);
+  TEST_ASSERT_EQUAL(0, lineCount);
+}
+
+// A stream of partial and complete lines arrives a few bytes per tick; every
+// tick takes at most TICK_BYTES and must return well inside the loop budget
+// (nothing waits for the rest of a line)
+static void test_tick_time_within_budget(void) {
+  static char stream[64 * 1024];
+  size_t n = 0;
+  unsigned seed = 1;
+  while (n < sizeof(stream)) {
+    seed = seed * 1103515245u + 12345u;
+    unsigned len = (seed >> 16) % (CMD_LINE_MAX + 40);
+    for (unsigned i = 0; i < len && n < sizeof(stream); i++) stream[n++] = 'a' + i % 26;
+    if (n < sizeof(stream)) stream[n++] = '\n';
+  }
+  long worstUs = 0;
+  size_t pos = 0;
+  while (pos < n) {
+    seed = seed * 1103515245u + 12345u;
+    size_t avail = 1 + (seed >> 16) % (2 * TICK_BYTES);
+    size_t take = avail < TICK_BYTES ? avail : TICK_BYTES;
+    if (take > n - pos) take = n - pos;
+    auto t0 = std::chrono::steady_clock::now();
+    feed(stream + pos, take);
+    long us = (long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count();
+    if (us > worstUs) worstUs = us;
+    pos += take;
+  }
+  TEST_ASSERT_TRUE(lineCount > 0);
+  TEST_ASSERT_TRUE(overflowCount > 0);
+  TEST_ASSERT_EQUAL((int)n, lineCount + overflowCount + noneCount);
+  TEST_ASSERT_TRUE(worstUs <= LOOP_BUDGET_US);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_lines_split_across_ticks);
+  RUN_TEST(test_line_at_max_length);
+  RUN_TEST(test_overflow_dropped_once_then_recovers);
+  RUN_TEST(test_one_over_max_overflows);
+  RUN_TEST(test_tick_time_within_budget);
+  return UNITY_END();
+}
@@ -0,0 +1,236 @@
+// MacroVM with the real CommandEngine and a table of recording no-op
+// commands: ops and delays run on the virtual millis(), bytecode from a
+// firmware with a different table order, the verifier's rejects, and host
+// ops/s of start() + update()
+#include <unity.h>
+#include <Arduino.h>
+#include <chrono>
+#include "CommandEngine.h"
+#include "MacroVM.h"
+
+static const int BENCH_RUNS = 20000;
+
+struct Call {
+  unsigned long t;
+  char name[12];
+  char arg[16];
+};
+static Call calls[32];
+static int callCount;
+
+static void record(const char* name, const char* arg) {
+  if (callCount < 32) {
+    Call& c = calls[callCount];
+    c.t = millis();
+    snprintf(c.name, sizeof(c.name), "%s", name);
+    snprintf(c.arg, sizeof(c.arg), "%s", arg);
+  }
+  callCount++;
+}
+
+static void cmdLampOn(char* arg, Transport&) { record("lamp_on", arg); }
+static void cmdLock(char* arg, Transport&) { record("lock", arg); }
+static void cmdAlarmOn(char* arg, Transport&) { record("alarm_on", arg); }
+static void cmdMacro(char* arg, Transport&) { record("macro", arg); }
+static void cmdNop(char*, Transport&) {}
+
+static const CommandEngine::Command TABLE[] = {
+  {"lamp_on", cmdLampOn},
+  {"lock", cmdLock},
+  {"alarm_on", cmdAlarmOn},
+  {"macro", cmdMacro},
+};
+// Another firmware: commands added in front and the order changed
+static const CommandEngine::Command NEWER[] = {
+  {"ping", cmdNop},
+  {"alarm_on", cmdAlarmOn},
+  {"hazard", cmdNop},
+  {"lock", cmdLock},
+  {"lamp_on", cmdLampOn},
+  {"macro", cmdMacro},
+};
+// Another firmware without alarm_on
+static const CommandEngine::Command OLDER[] = {
+  {"lamp_on", cmdLampOn},
+  {"lock", cmdLock},
+  {"macro", cmdMacro},
+};
+static const CommandEngine::Command NOPS[] = {
+  {"a", cmdNop}, {"b", cmdNop}, {"c", cmdNop}, {"d", cmdNop},
+};
+
+static CommandEngine engine(TABLE, sizeof(TABLE) / sizeof(TABLE[0]));
+static CommandEngine newer(NEWER, sizeof(NEWER) / sizeof(NEWER[0]));
+static CommandEngine older(OLDER, sizeof(OLDER) / sizeof(OLDER[0]));
+static CommandEngine nops(NOPS, sizeof(NOPS) / sizeof(NOPS[0]));
+
+static MacroVM vm;
+static uint8_t code[MacroVM::MAX_BYTES];
+static size_t codeLen;
+
+static void compile(const char* text) {
+  const char* err = vm.compile(text, code, codeLen);
+  TEST_ASSERT_NULL(err);
+}
+
+static void runUntil(unsigned long t) {
+  while ((long)(hostMillis - t) < 0) {
+    hostMillis += 10;
+    vm.update();
+  }
+}
+
+void setUp(void) {
+  hostMillis = 0;
+  callCount = 0;
+  hostSerialQuiet = true;
+  vm.stop();
+  vm.begin(engine);
+}
+
+void tearDown(void) { hostSerialQuiet = false; }
+
+static void test_runs_ops_with_delays(void) {
+  compile("lamp_on; wait 2000; lock 2; alarm_on");
+  TEST_ASSERT_NULL(vm.start(code, codeLen, 1));
+  runUntil(5000);
+  TEST_ASSERT_FALSE(vm.running());
+  TEST_ASSERT_EQUAL(3, callCount);
+  TEST_ASSERT_EQUAL_STRING("lamp_on", calls[0].name);
+  TEST_ASSERT_EQUAL_UINT32(10, calls[0].t);
+  TEST_ASSERT_EQUAL_STRING("lock", calls[1].name);
+  TEST_ASSERT_EQUAL_STRING("2", calls[1].arg);
+  TEST_ASSERT_EQUAL_UINT32(2010, calls[1].t);
+  TEST_ASSERT_EQUAL_STRING("alarm_on", calls[2].name);
+  TEST_ASSERT_EQUAL_UINT32(2010, calls[2].t);
+}
+
+static void test_waits_fold_into_previous_op(void) {
+  // lamp_on carries the 3000 ms: 2 ops of 5 bytes after the header
+  compile("wait 100; lamp_on; wait 1000; wait 2000; lock");
+  TEST_ASSERT_EQUAL(MacroVM::HEADER + 3 * MacroVM::OP_HEADER, codeLen);
+  TEST_ASSERT_NULL(vm.start(code, codeLen, 1));
+  runUntil(5000);
+  TEST_ASSERT_EQUAL(2, callCount);
+  TEST_ASSERT_EQUAL_UINT32(110, calls[0].t);
+  TEST_ASSERT_EQUAL_UINT32(3110, calls[1].t);
+}
+
+static void test_runs_on_a_reordered_table(void) {
+  compile("alarm_on; lamp_on 1; lock");
+  vm.begin(newer);
+  TEST_ASSERT_NULL(vm.verify(code, codeLen));
+  TEST_ASSERT_NULL(vm.start(code, codeLen, 2));
+  runUntil(100);
+  TEST_ASSERT_EQUAL(3, callCount);
+  TEST_ASSERT_EQUAL_STRING("alarm_on", calls[0].name);
+  TEST_ASSERT_EQUAL_STRING("lamp_on", calls[1].name);
+  TEST_ASSERT_EQUAL_STRING("1", calls[1].arg);
+  TEST_ASSERT_EQUAL_STRING("lock", calls[2].name);
+}
+
+static void test_rejects_a_removed_command_only(void) {
+  compile("alarm_on; lock");
+  vm.begin(older);
+  TEST_ASSERT_EQUAL_STRING("command not in this firmware", vm.verify(code, codeLen));
+  TEST_ASSERT_NOT_NULL(vm.start(code, codeLen, 1));
+  TEST_ASSERT_FALSE(vm.running());
+  TEST_ASSERT_EQUAL(0, callCount);
+
+  vm.begin(engine);
+  compile("lamp_on; lock");
+  vm.begin(older);
+  TEST_ASSERT_NULL(vm.verify(code, codeLen));
+}
+
+static void test_compile_rejects(void) {
+  TEST_ASSERT_EQUAL_STRING("unknown command", vm.compile("lamp_on; horn", code, codeLen));
+  TEST_ASSERT_EQUAL_STRING("macro cannot call macro", vm.compile("macro run 1", code, codeLen));
+  TEST_ASSERT_EQUAL_STRING("wait must be 1-65535 ms", vm.compile("wait 0", code, codeLen));
+  TEST_ASSERT_EQUAL_STRING("wait must be 1-65535 ms", vm.compile("lock; wait 70000", code, codeLen));
+  TEST_ASSERT_EQUAL_STRING("empty macro", vm.compile(" ; ;", code, codeLen));
+  char longText[300];
+  strcpy(longText, "lock");
+  for (int i = 0; i < 30; i++) strcat(longText, "; lock");
+  TEST_ASSERT_EQUAL_STRING("macro too long", vm.compile(longText, code, codeLen));
+}
+
+static void put(uint8_t* p, uint16_t v) {
+  p[0] = v & 0xFF;
+  p[1] = v >> 8;
+}
+
+static void test_verify_rejects(void) {
+  compile("lamp_on 1; lock");
+  uint8_t bad[MacroVM::MAX_BYTES];
+
+  memcpy(bad, code, codeLen);
+  bad[0] = 'X';
+  TEST_ASSERT_EQUAL_STRING("bad magic", vm.verify(bad, codeLen));
+
+  memcpy(bad, code, codeLen);
+  bad[1] = 1;
+  TEST_ASSERT_EQUAL_STRING("unsupported version, save the macro again", vm.verify(bad, codeLen));
+
+  TEST_ASSERT_EQUAL_STRING("bad length", vm.verify(code, MacroVM::HEADER));
+  TEST_ASSERT_EQUAL_STRING("bad length", vm.verify(code, MacroVM::MAX_BYTES + 1));
+  // Last op cut inside its header / inside its argument
+  TEST_ASSERT_EQUAL_STRING("truncated op", vm.verify(code, codeLen - 2));
+  memcpy(bad, code, codeLen);
+  TEST_ASSERT_EQUAL_STRING("truncated argument", vm.verify(bad, MacroVM::HEADER + MacroVM::OP_HEADER));
+
+  memcpy(bad, code, codeLen);
+  put(bad + MacroVM::HEADER, CommandEngine::nameId("horn", 4));
+  TEST_ASSERT_EQUAL_STRING("command not in this firmware", vm.verify(bad, codeLen));
+
+  // Hand-made op calling "macro" (compile() refuses to emit it)
+  memcpy(bad, code, codeLen);
+  put(bad + MacroVM::HEADER, CommandEngine::nameId("macro", 5));
+  TEST_ASSERT_EQUAL_STRING("macro cannot call macro", vm.verify(bad, codeLen));
+
+  memcpy(bad, code, codeLen);
+  put(bad + MacroVM::HEADER, MacroVM::OP_NONE);
+  TEST_ASSERT_EQUAL_STRING("delay op with argument", vm.verify(bad, codeLen));
+
+  memcpy(bad, code, codeLen);
+  bad[MacroVM::HEADER + MacroVM::OP_HEADER] = 0x07;
+  TEST_ASSERT_EQUAL_STRING("argument not printable", vm.verify(bad, codeLen));
+
+  // A rejected start leaves a running macro alone
+  compile("lamp_on; wait 1000; lock");
+  TEST_ASSERT_NULL(vm.start(code, codeLen, 1));
+  bad[0] = 'X';
+  TEST_ASSERT_NOT_NULL(vm.start(bad, codeLen, 2));
+  runUntil(2000);
+  TEST_ASSERT_EQUAL(2, callCount);
+}
+
+/* ===== Host throughput (information only, nothing asserted) ===== */
+
+static void test_bench(void) {
+  vm.begin(nops);
+  compile("a 1; b; c 22; d; a; b 333; c; d 4; a; b; c; d; a; b; c; d");
+  const int opsPerRun = 16;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < BENCH_RUNS; r++) {
+    vm.start(code, codeLen, 1);
+    while (vm.running()) vm.update();
+  }
+  double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  char msg[96];
+  snprintf(msg, sizeof(msg), "start+update: %.0f ops/s (%d runs of %d ops, %u bytes, log formatting incl.)",
+           BENCH_RUNS * opsPerRun / s, BENCH_RUNS, opsPerRun, (unsigned)codeLen);
+  TEST_MESSAGE(msg);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_runs_ops_with_delays);
+  RUN_TEST(test_waits_fold_into_previous_op);
+  RUN_TEST(test_runs_on_a_reordered_table);
+  RUN_TEST(test_rejects_a_removed_command_only);
+  RUN_TEST(test_compile_rejects);
+  RUN_TEST(test_verify_rejects);
+  RUN_TEST(test_bench);
+  return UNITY_END();
+}
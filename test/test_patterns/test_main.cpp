@@ -0,0 +1,218 @@
+// PatternPlayer stepped by update() every 10 ms on the virtual millis():
+// edge times of the hazard flashes and the pesawat heartbeat, and the move
+// between LEDC offload and CPU stepping in setOffload(). OutputArbiter and
+// LedcModulator are replaced by fakes that log edges and wave requests.
+// PatternPlayer.cpp is compiled into this test only (not build_src_filter):
+// it uses the firmware's global `outputs` and `ledc`, which only this test
+// provides.
+#include <unity.h>
+#include <Arduino.h>
+#include <climits>
+#include "PatternPlayer.cpp"
+
+static const unsigned long TICK_MS = 10;
+
+struct Edge {
+  unsigned long t;
+  Output out;
+  bool on;
+};
+static Edge edges[64];
+static int edgeCount;
+
+// Wave requests and free slots of the fake LEDC
+static uint32_t wavePeriodUs, waveHighUs;
+static bool waveActiveHigh;
+static uint8_t ledcSlots;
+// Last setModulation() per output (what commit() would route to LEDC)
+static int8_t modOf[OUT_COUNT];
+
+/* ===== Fakes: output level per claim, LEDC channel bookkeeping ===== */
+
+OutputArbiter::OutputArbiter() : shadow(0) {}
+
+void OutputArbiter::write(Output out, bool on) {
+  if (isOn(out) == on) return;
+  shadow ^= (uint16_t)(1u << out);
+  if (edgeCount < 64) edges[edgeCount] = Edge{millis(), out, on};
+  edgeCount++;
+}
+
+void OutputArbiter::request(Output out, OutputSource, bool on) { write(out, on); }
+void OutputArbiter::release(Output out, OutputSource) { write(out, false); }
+void OutputArbiter::clear(Output out) { write(out, false); }
+void OutputArbiter::setModulation(Output out, int8_t ledcChannel) { modOf[out] = ledcChannel; }
+
+int8_t LedcModulator::acquireWave(uint32_t periodUs, uint32_t highUs, bool activeHigh) {
+  for (uint8_t i = 0; i < ledcSlots; i++) {
+    if (used & (1 << i)) continue;
+    used |= (uint8_t)(1 << i);
+    wavePeriodUs = periodUs;
+    waveHighUs = highUs;
+    waveActiveHigh = activeHigh;
+    return (int8_t)(i * 2);
+  }
+  return NONE;
+}
+
+void LedcModulator::release(int8_t channel) {
+  if (channel != NONE) used &= (uint8_t)~(1 << (channel / 2));
+}
+
+OutputArbiter outputs;
+LedcModulator ledc;
+static PatternPlayer patterns;
+
+static void runUntil(unsigned long t) {
+  while ((long)(hostMillis - t) < 0) {
+    hostMillis += TICK_MS;
+    patterns.update();
+  }
+}
+
+static void expectEdges(const Edge* want, int n) {
+  TEST_ASSERT_EQUAL(n, edgeCount);
+  for (int i = 0; i < n; i++) {
+    TEST_ASSERT_EQUAL_UINT32(want[i].t, edges[i].t);
+    TEST_ASSERT_EQUAL(want[i].out, edges[i].out);
+    TEST_ASSERT_EQUAL(want[i].on, edges[i].on);
+  }
+}
+
+void setUp(void) {
+  hostMillis = 0;
+  for (uint8_t i = 0; i < OUT_COUNT; i++) patterns.stop((Output)i);
+  patterns.setOffload(true);
+  outputs = OutputArbiter();
+  ledc = LedcModulator();
+  ledcSlots = LedcModulator::SLOTS;
+  memset(modOf, LedcModulator::NONE, sizeof(modOf));
+  edgeCount = 0;
+  wavePeriodUs = waveHighUs = 0;
+}
+
+void tearDown(void) {}
+
+static void test_lock_hazard(void) {
+  patterns.play(OUT_HAZARD, SRC_DOOR, PATTERN_LOCK_HAZARD);
+  TEST_ASSERT_EQUAL_UINT32(400, patterns.msToNextStep());
+  runUntil(3000);
+  const Edge want[] = {
+    {0, OUT_HAZARD, true},
+    {400, OUT_HAZARD, false},
+    {600, OUT_HAZARD, true},
+    {1000, OUT_HAZARD, false},
+  };
+  expectEdges(want, 4);
+  TEST_ASSERT_FALSE(patterns.playing(OUT_HAZARD));
+  TEST_ASSERT_EQUAL_UINT32(0, wavePeriodUs);
+}
+
+static void test_unlock_hazard(void) {
+  patterns.play(OUT_HAZARD, SRC_DOOR, PATTERN_UNLOCK_HAZARD);
+  runUntil(3000);
+  const Edge want[] = {
+    {0, OUT_HAZARD, true},
+    {1000, OUT_HAZARD, false},
+  };
+  expectEdges(want, 2);
+  TEST_ASSERT_FALSE(patterns.playing(OUT_HAZARD));
+}
+
+static void test_pesawat_on_ledc(void) {
+  patterns.play(OUT_PESAWAT, SRC_DOOR, PATTERN_PESAWAT);
+  // 100 ms active every 3.1 s, shaped by the peripheral
+  TEST_ASSERT_EQUAL_UINT32(3100000UL, wavePeriodUs);
+  TEST_ASSERT_EQUAL_UINT32(100000UL, waveHighUs);
+  TEST_ASSERT_EQUAL(BOARD.out[OUT_PESAWAT].activeHigh, waveActiveHigh);
+  TEST_ASSERT_TRUE(modOf[OUT_PESAWAT] != LedcModulator::NONE);
+  TEST_ASSERT_EQUAL(1, ledc.inUse());
+  runUntil(10000);
+  // One logical ON claim for the whole pattern, nothing for the CPU to step
+  const Edge want[] = {{0, OUT_PESAWAT, true}};
+  expectEdges(want, 1);
+  TEST_ASSERT_EQUAL_UINT32(ULONG_MAX, patterns.msToNextStep());
+  TEST_ASSERT_TRUE(patterns.playing(OUT_PESAWAT));
+}
+
+static void test_pesawat_on_cpu(void) {
+  patterns.setOffload(false);
+  patterns.play(OUT_PESAWAT, SRC_DOOR, PATTERN_PESAWAT);
+  TEST_ASSERT_EQUAL(0, ledc.inUse());
+  TEST_ASSERT_EQUAL(LedcModulator::NONE, modOf[OUT_PESAWAT]);
+  runUntil(6300);
+  const Edge want[] = {
+    {0, OUT_PESAWAT, true},
+    {100, OUT_PESAWAT, false},
+    {3100, OUT_PESAWAT, true},
+    {3200, OUT_PESAWAT, false},
+    {6200, OUT_PESAWAT, true},
+    {6300, OUT_PESAWAT, false},
+  };
+  expectEdges(want, 6);
+}
+
+static void test_set_offload_moves_patterns(void) {
+  patterns.play(OUT_PESAWAT, SRC_DOOR, PATTERN_PESAWAT);
+  runUntil(1000);
+  patterns.play(OUT_HAZARD, SRC_DOOR, PATTERN_LOCK_HAZARD);
+
+  // Light sleep: the heartbeat leaves LEDC and restarts at its first step
+  patterns.setOffload(false);
+  TEST_ASSERT_EQUAL(0, ledc.inUse());
+  TEST_ASSERT_EQUAL(LedcModulator::NONE, modOf[OUT_PESAWAT]);
+  TEST_ASSERT_EQUAL_UINT32(100, patterns.msToNextStep());
+  runUntil(4500);
+
+  // Back on LEDC, the CPU-only hazard flash was not touched
+  patterns.setOffload(true);
+  TEST_ASSERT_EQUAL(1, ledc.inUse());
+  TEST_ASSERT_TRUE(modOf[OUT_PESAWAT] != LedcModulator::NONE);
+  TEST_ASSERT_EQUAL_UINT32(ULONG_MAX, patterns.msToNextStep());
+  runUntil(8000);
+
+  const Edge want[] = {
+    {0, OUT_PESAWAT, true},
+    {1000, OUT_HAZARD, true},
+    {1000, OUT_PESAWAT, false},
+    {1000, OUT_PESAWAT, true},
+    {1100, OUT_PESAWAT, false},
+    {1400, OUT_HAZARD, false},
+    {1600, OUT_HAZARD, true},
+    {2000, OUT_HAZARD, false},
+    {4100, OUT_PESAWAT, true},
+    {4200, OUT_PESAWAT, false},
+    {4500, OUT_PESAWAT, true},
+  };
+  expectEdges(want, 11);
+}
+
+static void test_no_free_slot_falls_back_to_cpu(void) {
+  ledcSlots = 0;
+  patterns.play(OUT_PESAWAT, SRC_DOOR, PATTERN_PESAWAT);
+  TEST_ASSERT_EQUAL(LedcModulator::NONE, modOf[OUT_PESAWAT]);
+  runUntil(3200);
+  TEST_ASSERT_EQUAL(4, edgeCount);
+}
+
+static void test_forced_off_returns_channel(void) {
+  patterns.play(OUT_PESAWAT, SRC_DOOR, PATTERN_PESAWAT);
+  runUntil(500);
+  outputs.clear(OUT_PESAWAT);
+  runUntil(600);
+  TEST_ASSERT_FALSE(patterns.playing(OUT_PESAWAT));
+  TEST_ASSERT_EQUAL(0, ledc.inUse());
+  TEST_ASSERT_EQUAL(LedcModulator::NONE, modOf[OUT_PESAWAT]);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_lock_hazard);
+  RUN_TEST(test_unlock_hazard);
+  RUN_TEST(test_pesawat_on_ledc);
+  RUN_TEST(test_pesawat_on_cpu);
+  RUN_TEST(test_set_offload_moves_patterns);
+  RUN_TEST(test_no_free_slot_falls_back_to_cpu);
+  RUN_TEST(test_forced_off_returns_channel);
+  return UNITY_END();
+}
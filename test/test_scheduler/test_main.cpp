@@ -0,0 +1,252 @@
+// Scheduler on a virtual RTC: a year of fires for several day masks through
+// update() and simulate(), no second fire after a reboot inside the firing
+// minute (last fire times in Preferences), and the grace skip after a jump
+#include <unity.h>
+#include <Arduino.h>
+#include <chrono>
+#include "Scheduler.h"
+
+// 2026-01-01 00:00:00, a Thursday
+static const uint32_t T2026 = 1767225600UL;
+static const uint16_t YEAR_DAYS = 365;
+// update() is called this often in virtual time (the real tick is faster;
+// every step still crosses each slot's minute)
+static const uint32_t STEP_S = 15;
+
+struct FakeClock {
+  uint32_t now = 0;
+  uint32_t epoch() { return now; }
+};
+
+static FakeClock rtc;
+static Preferences prefs;
+
+struct Fire {
+  uint32_t t;
+  uint8_t action;
+  uint16_t arg;
+};
+static Fire fires[4096];
+static uint32_t fireCount;
+
+static void logFire(uint8_t action, uint16_t arg) {
+  if (fireCount < 4096) fires[fireCount] = Fire{rtc.now, action, arg};
+  fireCount++;
+}
+
+struct Hooks {
+  static void warm(uint16_t minutes) { logFire(SCHED_WARM, minutes); }
+  static void macro(uint8_t slot) { logFire(SCHED_MACRO, slot); }
+};
+
+typedef Scheduler<Hooks, FakeClock> TestScheduler;
+
+// Scheduler::print() into a buffer: Fired=<n> skipped=<n>
+class BufPrint : public Print {
+public:
+  char buf[1024];
+  size_t len = 0;
+  size_t write(uint8_t c) override {
+    if (len + 1 < sizeof(buf)) buf[len++] = (char)c;
+    buf[len] = '\0';
+    return 1;
+  }
+};
+
+static unsigned long counter(const TestScheduler& s, const char* name) {
+  BufPrint p;
+  s.print(p);
+  const char* r = strstr(p.buf, name);
+  return r ? strtoul(r + strlen(name), nullptr, 10) : 0;
+}
+
+static void boot(TestScheduler& s) {
+  s.init(&rtc, &prefs);
+  s.begin();
+}
+
+static void runTo(TestScheduler& s, uint32_t end) {
+  while (rtc.now < end) {
+    rtc.now += STEP_S;
+    s.update();
+  }
+}
+
+// Fires of one (action, arg) pair
+static uint32_t countOf(uint8_t action, uint16_t arg) {
+  uint32_t n = 0;
+  for (uint32_t i = 0; i < fireCount && i < 4096; i++) {
+    if (fires[i].action == action && fires[i].arg == arg) n++;
+  }
+  return n;
+}
+
+// Days in [start, start + days) whose weekday is in mask, counted by hand
+static uint32_t maskDays(uint8_t mask, uint32_t start, uint16_t days) {
+  uint32_t n = 0;
+  for (uint16_t d = 0; d < days; d++) {
+    uint8_t wd = (uint8_t)((start / 86400UL + d + 4) % 7);  // 1970-01-01 = Thursday
+    if (mask & (1 << wd)) n++;
+  }
+  return n;
+}
+
+static const ScheduleSlot DAILY = {0x7F, 6, 30, SCHED_WARM, 10};
+static const ScheduleSlot WEEKDAYS = {0x3E, 7, 15, SCHED_MACRO, 1};
+static const ScheduleSlot WEEKEND = {0x41, 9, 0, SCHED_WARM, 20};
+static const ScheduleSlot WEDNESDAY = {0x08, 23, 59, SCHED_MACRO, 2};
+static const ScheduleSlot MIDNIGHT_MON = {0x02, 0, 0, SCHED_WARM, 5};
+
+static void setYearSlots(TestScheduler& s) {
+  s.setSlot(0, DAILY);
+  s.setSlot(1, WEEKDAYS);
+  s.setSlot(2, WEEKEND);
+  s.setSlot(3, WEDNESDAY);
+  s.setSlot(4, MIDNIGHT_MON);
+}
+
+void setUp(void) {
+  prefs.clear();
+  rtc.now = T2026;
+  fireCount = 0;
+}
+
+void tearDown(void) {}
+
+static void test_year_through_update(void) {
+  TestScheduler s;
+  boot(s);
+  setYearSlots(s);
+  // Default slot 1 (daily 15:31) is overwritten by DAILY
+  auto t0 = std::chrono::steady_clock::now();
+  runTo(s, T2026 + YEAR_DAYS * 86400UL);
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+  TEST_ASSERT_EQUAL(maskDays(0x7F, T2026, YEAR_DAYS), countOf(SCHED_WARM, 10));
+  TEST_ASSERT_EQUAL(maskDays(0x3E, T2026, YEAR_DAYS), countOf(SCHED_MACRO, 1));
+  TEST_ASSERT_EQUAL(maskDays(0x41, T2026, YEAR_DAYS), countOf(SCHED_WARM, 20));
+  TEST_ASSERT_EQUAL(maskDays(0x08, T2026, YEAR_DAYS), countOf(SCHED_MACRO, 2));
+  TEST_ASSERT_EQUAL(maskDays(0x02, T2026, YEAR_DAYS), countOf(SCHED_WARM, 5));
+  TEST_ASSERT_TRUE(fireCount <= 4096);
+  TEST_ASSERT_EQUAL(0, counter(s, "skipped="));
+
+  // Every fire within one update step of its HH:MM, on a mask day, in time order
+  const ScheduleSlot* bySlot[] = {&DAILY, &WEEKDAYS, &WEEKEND, &WEDNESDAY, &MIDNIGHT_MON};
+  for (uint32_t i = 0; i < fireCount; i++) {
+    const Fire& f = fires[i];
+    const ScheduleSlot* s = nullptr;
+    for (const ScheduleSlot* c : bySlot) {
+      if (c->action == f.action && c->arg == f.arg) s = c;
+    }
+    TEST_ASSERT_NOT_NULL(s);
+    uint32_t due = f.t - f.t % 86400UL + s->hour * 3600UL + s->minute * 60UL;
+    TEST_ASSERT_TRUE(f.t >= due && f.t - due < STEP_S);
+    TEST_ASSERT_TRUE(s->days & (1 << TimeCodec::weekday(due)));
+    if (i) TEST_ASSERT_TRUE(fires[i - 1].t <= f.t);
+  }
+
+  char msg[64];
+  snprintf(msg, sizeof(msg), "365 days, %lu fires: %.1f ms", (unsigned long)fireCount, ms);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE(ms < 1000.0);
+}
+
+static void test_year_through_simulate(void) {
+  TestScheduler s;
+  boot(s);
+  setYearSlots(s);
+  uint32_t errors = 99;
+  auto t0 = std::chrono::steady_clock::now();
+  uint32_t n = s.simulate(T2026, YEAR_DAYS, &errors);
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+  uint32_t want = maskDays(0x7F, T2026, YEAR_DAYS) + maskDays(0x3E, T2026, YEAR_DAYS) +
+                  maskDays(0x41, T2026, YEAR_DAYS) + maskDays(0x08, T2026, YEAR_DAYS) +
+                  maskDays(0x02, T2026, YEAR_DAYS);
+  TEST_ASSERT_EQUAL(want, n);
+  TEST_ASSERT_EQUAL(0, errors);
+  TEST_ASSERT_TRUE(ms < 1000.0);
+  // No fire happens in simulate()
+  TEST_ASSERT_EQUAL(0, fireCount);
+}
+
+static void test_reboot_in_firing_minute_does_not_fire_again(void) {
+  uint32_t due = T2026 + 7 * 3600UL;
+  {
+    TestScheduler s;
+    boot(s);
+    s.setSlot(0, ScheduleSlot{0x7F, 7, 0, SCHED_WARM, 0});
+    runTo(s, due + 10);
+    TEST_ASSERT_EQUAL(1, fireCount);
+    TEST_ASSERT_EQUAL_UINT32(due, fires[0].t - fires[0].t % 60);
+  }
+  // Reboot 30 s later, still inside the grace window: last[] from Preferences
+  rtc.now = due + 40;
+  TestScheduler s;
+  boot(s);
+  s.update();
+  TEST_ASSERT_EQUAL(1, fireCount);
+  TEST_ASSERT_EQUAL_UINT32(due + 86400UL, s.nextFire(0));
+  runTo(s, due + 86400UL + 30);
+  TEST_ASSERT_EQUAL(2, fireCount);
+}
+
+static void test_reboot_before_fire_still_fires(void) {
+  uint32_t due = T2026 + 7 * 3600UL;
+  {
+    TestScheduler s;
+    boot(s);
+    s.setSlot(0, ScheduleSlot{0x7F, 7, 0, SCHED_WARM, 0});
+    runTo(s, due - 30);
+  }
+  // Board was off over the fire time and is back 20 s late: inside the grace window
+  rtc.now = due + 20;
+  TestScheduler s;
+  boot(s);
+  s.update();
+  TEST_ASSERT_EQUAL(1, fireCount);
+}
+
+static void test_late_fire_is_skipped(void) {
+  uint32_t due = T2026 + 7 * 3600UL;
+  TestScheduler s;
+  boot(s);
+  s.setSlot(0, ScheduleSlot{0x7F, 7, 0, SCHED_WARM, 0});
+  runTo(s, due - 60);
+  // Clock jumps forward past the grace window (RTC set, long stall)
+  rtc.now = due + SCHEDULE_GRACE_S;
+  s.update();
+  TEST_ASSERT_EQUAL(0, fireCount);
+  TEST_ASSERT_EQUAL(1, counter(s, "skipped="));
+  TEST_ASSERT_EQUAL_UINT32(due + 86400UL, s.nextFire(0));
+
+  // One second less late still fires
+  TestScheduler t;
+  prefs.clear();
+  rtc.now = due - 60;
+  boot(t);
+  t.setSlot(0, ScheduleSlot{0x7F, 7, 0, SCHED_WARM, 0});
+  rtc.now = due + SCHEDULE_GRACE_S - 1;
+  t.update();
+  TEST_ASSERT_EQUAL(1, fireCount);
+  TEST_ASSERT_EQUAL(0, counter(t, "skipped="));
+}
+
+static void test_no_clock_no_fire(void) {
+  rtc.now = 0;
+  TestScheduler s;
+  boot(s);
+  s.update();
+  TEST_ASSERT_EQUAL_UINT32(0, s.nextAny());
+  TEST_ASSERT_EQUAL(0, fireCount);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_year_through_update);
+  RUN_TEST(test_year_through_simulate);
+  RUN_TEST(test_reboot_in_firing_minute_does_not_fire_again);
+  RUN_TEST(test_reboot_before_fire_still_fires);
+  RUN_TEST(test_late_fire_is_skipped);
+  RUN_TEST(test_no_clock_no_fire);
+  return UNITY_END();
+}
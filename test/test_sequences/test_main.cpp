@@ -0,0 +1,255 @@
+// Start (ButtonTombol), warm-up (WarmUpEngine) and reset (ResetSequence)
+// routines on the real Sequencer under a virtual clock, ticked every 10 ms
+// like loop(). OutputArbiter and PatternPlayer are replaced by fakes that
+// log each output edge with its millis() time.
+#include <unity.h>
+#include <Arduino.h>
+#include "Sequencer.h"
+#include "ButtonTombol.h"
+#include "WarmUp_engine.h"
+#include "ResetSequence.h"
+
+static const unsigned long TICK_MS = 10;
+
+struct Edge {
+  unsigned long t;
+  Output out;
+  bool on;
+};
+static Edge edges[32];
+static int edgeCount;
+static unsigned long pulseOffAt[OUT_COUNT];  // 0 = no pulse running
+static int engine;                           // last setEngine(), -1 = never called
+static unsigned long engineAt;
+
+/* ===== Fakes: only when each output switches, not the claim resolution ===== */
+
+OutputArbiter::OutputArbiter() : shadow(0) {}
+
+void OutputArbiter::write(Output out, bool on) {
+  if (isOn(out) == on) return;
+  shadow ^= (uint16_t)(1u << out);
+  if (edgeCount < 32) edges[edgeCount] = Edge{millis(), out, on};
+  edgeCount++;
+}
+
+void OutputArbiter::request(Output out, OutputSource, bool on) { write(out, on); }
+void OutputArbiter::release(Output out, OutputSource) { write(out, false); }
+
+void OutputArbiter::clear(Output out) {
+  pulseOffAt[out] = 0;
+  write(out, false);
+}
+
+bool OutputArbiter::pulse(Output out, OutputSource, unsigned long ms) {
+  // Same interlock as the real arbiter: STARTER only while IG is on
+  if (out == OUT_STARTER && !isOn(OUT_IG)) return false;
+  write(out, true);
+  pulseOffAt[out] = millis() + ms;
+  return true;
+}
+
+void OutputArbiter::update() {
+  for (uint8_t i = 0; i < OUT_COUNT; i++) {
+    if (pulseOffAt[i] && (long)(millis() - pulseOffAt[i]) >= 0) {
+      pulseOffAt[i] = 0;
+      write((Output)i, false);
+    }
+  }
+}
+
+PatternPlayer::PatternPlayer() {}
+void PatternPlayer::play(Output, OutputSource, const Pattern&) {}
+
+OutputArbiter outputs;
+PatternPlayer patterns;
+Sequencer sequencer;
+
+static void setEngine(bool on) {
+  engine = on;
+  engineAt = millis();
+}
+
+struct ButtonHooks {
+  static void onPress() {}
+  static void onReset() {}
+  static void setEngine(bool on) { ::setEngine(on); }
+};
+struct WarmHooks {
+  static void setEngine(bool on) { ::setEngine(on); }
+  static void notify(const char*) {}
+};
+struct ResetHooks {
+  static void notify(const char*) {}
+};
+
+// One loop() tick per TICK_MS, in TickModules order (outputs before sequencer)
+static void runUntil(unsigned long t) {
+  while ((long)(hostMillis - t) < 0) {
+    hostMillis += TICK_MS;
+    outputs.update();
+    sequencer.update();
+  }
+}
+
+static void expectEdges(const Edge* want, int n) {
+  TEST_ASSERT_EQUAL(n, edgeCount);
+  for (int i = 0; i < n; i++) {
+    TEST_ASSERT_EQUAL_UINT32(want[i].t, edges[i].t);
+    TEST_ASSERT_EQUAL(want[i].out, edges[i].out);
+    TEST_ASSERT_EQUAL(want[i].on, edges[i].on);
+  }
+}
+
+// Sequencer::print() into a buffer: resumes=<n>
+class BufPrint : public Print {
+public:
+  char buf[512];
+  size_t len = 0;
+  size_t write(uint8_t c) override {
+    if (len + 1 < sizeof(buf)) buf[len++] = (char)c;
+    buf[len] = '\0';
+    return 1;
+  }
+};
+
+static unsigned long resumes() {
+  BufPrint p;
+  sequencer.print(p);
+  const char* r = strstr(p.buf, "resumes=");
+  return r ? strtoul(r + 8, nullptr, 10) : 0;
+}
+
+void setUp(void) {
+  hostMillis = 0;
+  sequencer = Sequencer();
+  outputs = OutputArbiter();
+  memset(pulseOffAt, 0, sizeof(pulseOffAt));
+  edgeCount = 0;
+  engine = -1;
+  engineAt = 0;
+}
+
+void tearDown(void) {}
+
+static void test_start_sequence(void) {
+  ButtonTombol<ButtonHooks> button;
+  button.setCountdownMs(15000);
+  button.triggerStart();
+  runUntil(20000);
+  const Edge want[] = {
+    {0, OUT_ACC, true},
+    {1000, OUT_IG, true},
+    {2000, OUT_STARTER, true},
+    {3000, OUT_STARTER, false},
+  };
+  expectEdges(want, 4);
+  // Engine counts as running at the end of the countdown
+  TEST_ASSERT_EQUAL(1, engine);
+  TEST_ASSERT_EQUAL_UINT32(15000, engineAt);
+  TEST_ASSERT_FALSE(button.busy());
+  TEST_ASSERT_FALSE(sequencer.busy());
+  // Sleeping routines cost nothing per tick: one resume per SEQ_SLEEP, not per 10 ms
+  TEST_ASSERT_TRUE(resumes() <= 5);
+}
+
+static void test_start_crank_again_extends_countdown(void) {
+  ButtonTombol<ButtonHooks> button;
+  button.setCountdownMs(15000);
+  button.triggerStart();
+  runUntil(5000);
+  button.triggerStart();
+  runUntil(25000);
+  const Edge want[] = {
+    {0, OUT_ACC, true},
+    {1000, OUT_IG, true},
+    {2000, OUT_STARTER, true},
+    {3000, OUT_STARTER, false},
+    {5000, OUT_STARTER, true},
+    {6000, OUT_STARTER, false},
+  };
+  expectEdges(want, 6);
+  TEST_ASSERT_EQUAL_UINT32(20000, engineAt);
+  TEST_ASSERT_EQUAL(1, engine);
+}
+
+static void test_start_cancelled(void) {
+  ButtonTombol<ButtonHooks> button;
+  button.triggerStart();
+  runUntil(1500);
+  button.cancelStart();
+  runUntil(20000);
+  const Edge want[] = {
+    {0, OUT_ACC, true},
+    {1000, OUT_IG, true},
+  };
+  expectEdges(want, 2);
+  TEST_ASSERT_EQUAL(0, engine);
+  TEST_ASSERT_FALSE(sequencer.busy());
+}
+
+static void test_warm_sequence(void) {
+  WarmUpEngine<WarmHooks> warm;
+  warm.scheduledWarm(2);
+  TEST_ASSERT_TRUE(warm.isActive());
+  runUntil(130000);
+  const Edge want[] = {
+    {0, OUT_IG, true},
+    {1000, OUT_STARTER, true},
+    {2000, OUT_STARTER, false},
+    {120000, OUT_IG, false},
+  };
+  expectEdges(want, 4);
+  TEST_ASSERT_FALSE(warm.isActive());
+  TEST_ASSERT_EQUAL(0, engine);
+  TEST_ASSERT_EQUAL_UINT32(120000, engineAt);
+  TEST_ASSERT_TRUE(resumes() <= 3);
+}
+
+static void test_warm_resume_never_cranks(void) {
+  WarmUpEngine<WarmHooks> warm;
+  warm.resume(30000);
+  runUntil(40000);
+  const Edge want[] = {
+    {0, OUT_IG, true},
+    {30000, OUT_IG, false},
+  };
+  expectEdges(want, 2);
+  TEST_ASSERT_FALSE(warm.isActive());
+}
+
+static void test_reset_sequence(void) {
+  ResetSequence<ResetHooks> reset;
+  outputs.request(OUT_ACC, SRC_COMMAND, true);
+  outputs.request(OUT_LAMP, SRC_COMMAND, true);
+  outputs.request(OUT_HAZARD, SRC_COMMAND, true);
+  runUntil(100);
+  reset.start();
+  // A second reset restarts the delay
+  runUntil(400);
+  reset.start();
+  TEST_ASSERT_TRUE(reset.pending());
+  runUntil(2000);
+  const Edge want[] = {
+    {0, OUT_ACC, true},
+    {0, OUT_LAMP, true},
+    {0, OUT_HAZARD, true},
+    {900, OUT_ACC, false},
+    {900, OUT_LAMP, false},
+    {900, OUT_HAZARD, false},
+  };
+  expectEdges(want, 6);
+  TEST_ASSERT_FALSE(reset.pending());
+  TEST_ASSERT_FALSE(sequencer.busy());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_start_sequence);
+  RUN_TEST(test_start_crank_again_extends_countdown);
+  RUN_TEST(test_start_cancelled);
+  RUN_TEST(test_warm_sequence);
+  RUN_TEST(test_warm_resume_never_cranks);
+  RUN_TEST(test_reset_sequence);
+  return UNITY_END();
+}
@@ -0,0 +1,216 @@
+// TimeCodec on the host: every day of 2020-2099 against a naive calendar walk
+// (civil <-> seconds, format -> parse), the strict parser's rejects, and a
+// host throughput figure for each conversion
+#include <unity.h>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include "TimeCodec.h"
+
+using namespace TimeCodec;
+
+// 2020-01-01 00:00:00, a Wednesday
+static const uint32_t T2020 = 1577836800UL;
+static const int BENCH_N = 1000000;
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+// Reference calendar, independent of TimeCodec
+static bool leap(unsigned y) { return (y % 4 == 0 && y % 100 != 0) || y % 400 == 0; }
+
+static unsigned monthDays(unsigned y, unsigned m) {
+  static const uint8_t days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  return m == 2 && leap(y) ? 29 : days[m - 1];
+}
+
+static void checkSecond(uint32_t t, unsigned y, unsigned m, unsigned d, unsigned wd) {
+  unsigned sec = t % 86400UL;
+  CivilTime c = toCivil(t);
+  TEST_ASSERT_EQUAL(y, c.year);
+  TEST_ASSERT_EQUAL(m, c.month);
+  TEST_ASSERT_EQUAL(d, c.day);
+  TEST_ASSERT_EQUAL(sec / 3600, c.hour);
+  TEST_ASSERT_EQUAL(sec / 60 % 60, c.minute);
+  TEST_ASSERT_EQUAL(sec % 60, c.second);
+  TEST_ASSERT_EQUAL(wd, c.weekday);
+  TEST_ASSERT_EQUAL(wd, weekday(t));
+  TEST_ASSERT_EQUAL_UINT32(t, fromCivil(c));
+
+  char buf[ISO_LEN];
+  char want[32];
+  snprintf(want, sizeof(want), "%04u-%02u-%02u %02u:%02u:%02u", y, m, d, sec / 3600, sec / 60 % 60, sec % 60);
+  TEST_ASSERT_EQUAL(ISO_LEN - 1, formatIso(t, buf, sizeof(buf)));
+  TEST_ASSERT_EQUAL_STRING(want, buf);
+  uint32_t back = 0;
+  TEST_ASSERT_TRUE(parseIso(buf, back));
+  TEST_ASSERT_EQUAL_UINT32(t, back);
+}
+
+static void test_every_day_2020_2099(void) {
+  uint32_t t = T2020;
+  unsigned wd = 3;
+  unsigned days = 0;
+  for (unsigned y = 2020; y <= 2099; y++) {
+    TEST_ASSERT_EQUAL(leap(y), isLeap(y));
+    for (unsigned m = 1; m <= 12; m++) {
+      TEST_ASSERT_EQUAL(monthDays(y, m), daysInMonth(y, m));
+      for (unsigned d = 1; d <= monthDays(y, m); d++) {
+        TEST_ASSERT_EQUAL((int32_t)(t / 86400UL), daysFromCivil((int)y, m, d));
+        // Midnight, the last second, and one that moves through the day
+        checkSecond(t, y, m, d, wd);
+        checkSecond(t + 86399, y, m, d, wd);
+        checkSecond(t + days * 7919UL % 86400UL, y, m, d, wd);
+        t += 86400UL;
+        wd = (wd + 1) % 7;
+        days++;
+      }
+    }
+  }
+  TEST_ASSERT_EQUAL(29220, days);
+}
+
+static void test_every_second_of_a_leap_day(void) {
+  // 2024-02-29
+  uint32_t day = T2020 + (366 + 365 + 365 + 365 + 31 + 28) * 86400UL;
+  for (uint32_t s = 0; s < 86400UL; s++) checkSecond(day + s, 2024, 2, 29, 4);
+}
+
+static void test_range_ends(void) {
+  uint32_t t;
+  TEST_ASSERT_TRUE(parseIso("1970-01-01 00:00:00", t));
+  TEST_ASSERT_EQUAL_UINT32(0, t);
+  TEST_ASSERT_TRUE(parseIso("2105-12-31 23:59:59", t));
+  TEST_ASSERT_EQUAL_UINT32(4291747199UL, t);
+  TEST_ASSERT_FALSE(parseIso("1969-12-31 23:59:59", t));
+  TEST_ASSERT_FALSE(parseIso("2106-01-01 00:00:00", t));
+}
+
+static void test_parse_rejects(void) {
+  static const char* const bad[] = {
+    "2025-02-29 00:00:00",   // not a leap year
+    "2024-02-30 00:00:00",
+    "2025-02-31 12:00:00",
+    "2025-04-31 12:00:00",
+    "2025-00-10 12:00:00",
+    "2025-13-10 12:00:00",
+    "2025-01-00 12:00:00",
+    "2025-01-10 24:00:00",
+    "2025-01-10 12:60:00",
+    "2025-01-10 12:00:60",
+    "2025-1-10 12:00:00",    // digit counts
+    "2025-01-1 12:00:00",
+    "2025-01-10 1:00:00",
+    "2025-01-10 12:00:0",
+    "25-01-10 12:00:00",
+    "2025-01-10 12:00:00Z",  // trailing characters
+    "2025-01-10 12:00:00 ",
+    "2025-01-10 12:00",
+    "2025/01/10 12:00:00",   // separators
+    "2025-01-10_12:00:00",
+    "2025-01-10 12-00-00",
+    "2025-01-10 +2:00:00",
+    "",
+  };
+  uint32_t t = 12345;
+  for (const char* s : bad) {
+    TEST_ASSERT_FALSE_MESSAGE(parseIso(s, t), s);
+    TEST_ASSERT_FALSE_MESSAGE(parse(s, t), s);
+  }
+  // Rejects leave the output alone
+  TEST_ASSERT_EQUAL_UINT32(12345, t);
+}
+
+static void test_parse_forms(void) {
+  uint32_t t;
+  uint16_t ms;
+  TEST_ASSERT_TRUE(parseIso("2026-01-01T00:00:00", t));
+  TEST_ASSERT_EQUAL_UINT32(1767225600UL, t);
+  TEST_ASSERT_TRUE(parse("@1767225600", t));
+  TEST_ASSERT_EQUAL_UINT32(1767225600UL, t);
+  TEST_ASSERT_TRUE(parse("@4294967295", t));
+  TEST_ASSERT_EQUAL_UINT32(4294967295UL, t);
+  TEST_ASSERT_FALSE(parse("@4294967296", t));
+  TEST_ASSERT_FALSE(parse("@", t));
+  TEST_ASSERT_FALSE(parse("@12a", t));
+  TEST_ASSERT_FALSE(parse("@-1", t));
+  TEST_ASSERT_FALSE(parse("1767225600", t));
+  TEST_ASSERT_FALSE(parseEpoch("00000000001", t));
+
+  TEST_ASSERT_TRUE(parse("2026-01-01 00:00:01.5", t, ms));
+  TEST_ASSERT_EQUAL_UINT32(1767225601UL, t);
+  TEST_ASSERT_EQUAL(500, ms);
+  TEST_ASSERT_TRUE(parse("2026-01-01 00:00:01.05", t, ms));
+  TEST_ASSERT_EQUAL(50, ms);
+  TEST_ASSERT_TRUE(parse("@1767225600.123", t, ms));
+  TEST_ASSERT_EQUAL(123, ms);
+  TEST_ASSERT_TRUE(parse("2026-01-01 00:00:01", t, ms));
+  TEST_ASSERT_EQUAL(0, ms);
+  TEST_ASSERT_FALSE(parse("2026-01-01 00:00:01.", t, ms));
+  TEST_ASSERT_FALSE(parse("2026-01-01 00:00:01.1234", t, ms));
+  TEST_ASSERT_FALSE(parse("2026-01-01 00:00:01.1x", t, ms));
+  TEST_ASSERT_FALSE(parse("2026-02-31 00:00:01.1", t, ms));
+}
+
+static void test_format_small_buffer(void) {
+  char buf[ISO_LEN];
+  memset(buf, 'x', sizeof(buf));
+  TEST_ASSERT_EQUAL(0, formatIso(T2020, buf, ISO_LEN - 1));
+  TEST_ASSERT_EQUAL('\0', buf[0]);
+  TEST_ASSERT_EQUAL(0, formatIso(T2020, buf, 0));
+}
+
+/* ===== Host throughput (information only, nothing asserted) ===== */
+
+static void report(const char* what, std::chrono::steady_clock::time_point t0, unsigned long sink) {
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / BENCH_N;
+  char msg[96];
+  snprintf(msg, sizeof(msg), "%-10s %7.1f ns/op (sink %lu)", what, ns, sink);
+  TEST_MESSAGE(msg);
+}
+
+static void test_bench(void) {
+  char buf[ISO_LEN];
+  unsigned long sink = 0;
+  // ~1 day apart so every field changes
+  const uint32_t step = 86413UL;
+
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < BENCH_N; i++) sink += toCivil(T2020 + i * step).day;
+  report("toCivil", t0, sink);
+
+  CivilTime c = toCivil(T2020);
+  t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < BENCH_N; i++) {
+    c.second = (uint8_t)(i % 60);
+    c.day = (uint8_t)(1 + i % 28);
+    sink += fromCivil(c);
+  }
+  report("fromCivil", t0, sink);
+
+  t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < BENCH_N; i++) sink += formatIso(T2020 + i * step, buf, sizeof(buf)) + buf[9];
+  report("formatIso", t0, sink);
+
+  uint32_t t = 0;
+  t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < BENCH_N; i++) {
+    buf[18] = (char)('0' + i % 10);
+    parseIso(buf, t);
+    sink += t;
+  }
+  report("parseIso", t0, sink);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_every_day_2020_2099);
+  RUN_TEST(test_every_second_of_a_leap_day);
+  RUN_TEST(test_range_ends);
+  RUN_TEST(test_parse_rejects);
+  RUN_TEST(test_parse_forms);
+  RUN_TEST(test_format_small_buffer);
+  RUN_TEST(test_bench);
+  return UNITY_END();
+}